@@ -0,0 +1,61 @@
+#include "render_queue.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <fmt/format.h>
+DISABLE_WARNINGS_POP()
+#include <framework/shader.h>
+#include <random>
+#include <vector>
+
+// Fills the queue with opaque draws of random state and depth, like a frame with many small meshes. Items only need
+// distinct shader addresses; the sort never touches the GL objects.
+static void fillQueue(RenderQueue& queue, const std::vector<Shader>& shaders, size_t numItems)
+{
+    std::mt19937 random { 42 };
+    std::uniform_int_distribution<size_t> shaderDistribution { 0, shaders.size() - 1 };
+    std::uniform_int_distribution<uint32_t> materialDistribution { 0, 1023 };
+    std::uniform_real_distribution<float> depthDistribution { 0.0f, 1.0f };
+
+    queue.clear();
+    for (size_t i = 0; i < numItems; ++i) {
+        const DrawItem item {
+            .pShader = &shaders[shaderDistribution(random)],
+            .materialIndex = materialDistribution(random)
+        };
+        queue.push(RenderPass::Opaque, item, depthDistribution(random));
+    }
+}
+
+TEST_CASE("RenderQueue::sort", "[render_queue]")
+{
+    const size_t numItems = GENERATE(size_t(1000), size_t(10000), size_t(100000));
+    const std::vector<Shader> shaders(16);
+    RenderQueue queue;
+    fillQueue(queue, shaders, numItems);
+
+    queue.sort();
+    REQUIRE(queue.size() == numItems);
+    for (size_t i = 1; i < queue.size(); ++i)
+        REQUIRE(queue.sortedKey(i - 1) <= queue.sortedKey(i));
+
+    // Every run sorts its own copy of the unsorted queue; sorting sorted keys would touch memory more coherently.
+    BENCHMARK_ADVANCED(fmt::format("sort {} items", numItems))(Catch::Benchmark::Chronometer meter)
+    {
+        fillQueue(queue, shaders, numItems);
+        std::vector<RenderQueue> queues(static_cast<size_t>(meter.runs()), queue);
+        meter.measure([&](int run) {
+            RenderQueue& runQueue = queues[static_cast<size_t>(run)];
+            runQueue.sort();
+            return runQueue.sortedKey(0);
+        });
+    };
+    BENCHMARK(fmt::format("push and sort {} items", numItems))
+    {
+        fillQueue(queue, shaders, numItems);
+        queue.sort();
+        return queue.sortedKey(0);
+    };
+}
@@ -0,0 +1,117 @@
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <fmt/format.h>
+DISABLE_WARNINGS_POP()
+#include <framework/frame_allocator.h>
+#include <framework/jobs.h>
+#include <atomic>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Counts the heap calls of containers that would otherwise use the default allocator.
+class CountingResource final : public std::pmr::memory_resource {
+public:
+    std::atomic<uint64_t> numAllocations { 0 };
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        numAllocations.fetch_add(1, std::memory_order_relaxed);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* pMemory, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(pMemory, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+// Transient lists like those of the culling code: built from scratch with push_back every frame.
+static uint64_t buildList(std::pmr::memory_resource* pResource, size_t listIndex, size_t numElements)
+{
+    std::pmr::vector<uint32_t> list { pResource };
+    for (size_t i = 0; i < numElements; ++i)
+        list.push_back(uint32_t(listIndex + i));
+    uint64_t sum = 0;
+    for (const uint32_t value : list)
+        sum += value;
+    return sum;
+}
+
+static uint64_t simulateFrame(std::pmr::memory_resource* pResource, size_t numLists)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < numLists; ++i)
+        sum += buildList(pResource, i, 100 + i % 200);
+    FrameAllocator::get().nextFrame();
+    return sum;
+}
+
+TEST_CASE("FrameAllocator heap calls per frame", "[frame_allocator]")
+{
+    const size_t numLists = GENERATE(size_t(64), size_t(1024));
+    constexpr uint32_t numWarmupFrames = 4; // Both buffers need a frame to grow and another to merge their blocks.
+    constexpr uint32_t numFrames = 100;
+
+    CountingResource heap;
+    uint64_t expectedSum = 0;
+    for (uint32_t frame = 0; frame < numWarmupFrames; ++frame)
+        expectedSum = simulateFrame(&heap, numLists);
+    heap.numAllocations = 0;
+    for (uint32_t frame = 0; frame < numFrames; ++frame)
+        REQUIRE(simulateFrame(&heap, numLists) == expectedSum);
+    const uint64_t heapCallsPerFrame = heap.numAllocations / numFrames;
+
+    for (uint32_t frame = 0; frame < numWarmupFrames; ++frame)
+        REQUIRE(simulateFrame(FrameAllocator::resource(), numLists) == expectedSum);
+    const uint64_t numHeapAllocationsBefore = FrameAllocator::get().stats().numHeapAllocations;
+    for (uint32_t frame = 0; frame < numFrames; ++frame)
+        REQUIRE(simulateFrame(FrameAllocator::resource(), numLists) == expectedSum);
+    const FrameAllocatorStats stats = FrameAllocator::get().stats();
+
+    // Once every buffer has reached its steady-state size, frames do not touch the heap anymore.
+    REQUIRE(heapCallsPerFrame >= numLists);
+    REQUIRE(stats.numHeapAllocations == numHeapAllocationsBefore);
+    REQUIRE(stats.lastFrameNumAllocations == heapCallsPerFrame);
+    REQUIRE(stats.peakFrameBytes >= stats.lastFrameBytes);
+
+    BENCHMARK(fmt::format("{} lists per frame, {} heap calls, default allocator", numLists, heapCallsPerFrame))
+    {
+        return simulateFrame(std::pmr::new_delete_resource(), numLists);
+    };
+    BENCHMARK(fmt::format("{} lists per frame, 0 heap calls, frame allocator", numLists))
+    {
+        return simulateFrame(FrameAllocator::resource(), numLists);
+    };
+}
+
+TEST_CASE("FrameAllocator from jobs", "[frame_allocator]")
+{
+    // Every thread allocates from its own arena; a thread only needs new blocks until its buffers have grown large enough.
+    JobSystem jobSystem { 3 };
+    constexpr size_t numLists = 128;
+    std::vector<uint64_t> sums(numLists);
+    const auto buildLists = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            sums[i] = buildList(FrameAllocator::resource(), i, 100 + i % 200);
+    };
+
+    const uint64_t numHeapAllocationsBefore = FrameAllocator::get().stats().numHeapAllocations;
+    BENCHMARK(fmt::format("{} lists per frame on {} threads, frame allocator", numLists, jobSystem.numThreads()))
+    {
+        jobSystem.parallelFor(0, numLists, 16, buildLists);
+        FrameAllocator::get().nextFrame();
+        return sums.back();
+    };
+    for (size_t i = 0; i < numLists; ++i)
+        REQUIRE(sums[i] == buildList(std::pmr::new_delete_resource(), i, 100 + i % 200));
+    // All lists of a frame fit into the first block, so each thread needs at most one block per buffer.
+    REQUIRE(FrameAllocator::get().stats().numHeapAllocations - numHeapAllocationsBefore <= 2 * jobSystem.numThreads());
+}
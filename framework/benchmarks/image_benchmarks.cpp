@@ -0,0 +1,21 @@
+#include "synthetic_data.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <fmt/format.h>
+DISABLE_WARNINGS_POP()
+#include <framework/image.h>
+
+TEST_CASE("Image decode", "[image]")
+{
+    const int size = GENERATE(256, 1024, 2048);
+    const int channels = GENERATE(3, 4);
+    const std::filesystem::path pngFile = makePngFile(size, channels);
+
+    BENCHMARK(fmt::format("Image PNG {0}x{0}x{1}", size, channels))
+    {
+        return Image(pngFile);
+    };
+}
@@ -0,0 +1,89 @@
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <fmt/format.h>
+DISABLE_WARNINGS_POP()
+#include <framework/jobs.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+// Worker counts include 0 (everything on the calling thread) to show the overhead of the scheduler itself. The results
+// are checked as well, so that a run with ENABLE_SANITIZER_THREAD covers the scheduler under ThreadSanitizer.
+
+TEST_CASE("JobSystem::parallelFor", "[jobs]")
+{
+    const uint32_t numWorkers = GENERATE(0u, 1u, 3u, 7u);
+    JobSystem jobSystem { numWorkers };
+
+    std::vector<float> values(1 << 20);
+    std::iota(std::begin(values), std::end(values), 0.0f);
+    std::vector<float> results(values.size());
+    const auto squareRoots = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            results[i] = std::sqrt(values[i]);
+    };
+
+    const size_t grainSize = GENERATE(size_t(1024), size_t(16384));
+    BENCHMARK(fmt::format("parallelFor sqrt 1M grain {} on {} threads", grainSize, jobSystem.numThreads()))
+    {
+        jobSystem.parallelFor(0, values.size(), grainSize, squareRoots);
+        return results.back();
+    };
+    for (size_t i = 0; i < values.size(); i += 4099)
+        REQUIRE(results[i] == std::sqrt(values[i]));
+}
+
+TEST_CASE("JobSystem nested parallelFor", "[jobs]")
+{
+    // Jobs that wait for jobs of their own; the waiting workers execute the inner jobs instead of blocking.
+    const uint32_t numWorkers = GENERATE(0u, 3u);
+    JobSystem jobSystem { numWorkers };
+
+    std::atomic<uint64_t> sum { 0 };
+    BENCHMARK(fmt::format("nested parallelFor 64x64 on {} threads", jobSystem.numThreads()))
+    {
+        sum = 0;
+        jobSystem.parallelFor(0, 64, 1, [&](size_t outerBegin, size_t) {
+            jobSystem.parallelFor(0, 64, 1, [&](size_t innerBegin, size_t) { sum += outerBegin * 64 + innerBegin; });
+        });
+        return sum.load();
+    };
+    REQUIRE(sum == 4096 * 4095 / 2);
+}
+
+TEST_CASE("JobSystem::run", "[jobs]")
+{
+    const uint32_t numWorkers = GENERATE(0u, 3u);
+    JobSystem jobSystem { numWorkers };
+
+    // Cost of scheduling tiny jobs: allocation, queueing, stealing and the counter.
+    std::atomic<uint32_t> numExecuted { 0 };
+    BENCHMARK(fmt::format("run+wait 1000 empty jobs on {} threads", jobSystem.numThreads()))
+    {
+        JobCounter counter;
+        for (int i = 0; i < 1000; ++i)
+            jobSystem.run([&]() { numExecuted.fetch_add(1, std::memory_order_relaxed); }, &counter);
+        jobSystem.wait(counter);
+        return numExecuted.load();
+    };
+    REQUIRE(numExecuted % 1000 == 0);
+
+    // Continuations only start when their dependency finished.
+    std::vector<JobCounter> counters(100);
+    std::vector<uint32_t> order;
+    BENCHMARK(fmt::format("chain of 100 continuations on {} threads", jobSystem.numThreads()))
+    {
+        order.clear();
+        for (size_t i = 0; i < counters.size(); ++i)
+            jobSystem.run([&order, i]() { order.push_back(uint32_t(i)); }, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+        jobSystem.wait(counters.back());
+        return order.size();
+    };
+    REQUIRE(order.size() == counters.size());
+    REQUIRE(std::is_sorted(std::begin(order), std::end(order)));
+}
@@ -0,0 +1,75 @@
+#include "synthetic_data.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <fmt/format.h>
+DISABLE_WARNINGS_POP()
+#include <framework/mesh.h>
+#include <vector>
+
+TEST_CASE("loadMesh", "[mesh]")
+{
+    // 32x32 quads ~ 2K triangles, 256x256 quads ~ 130K triangles.
+    const unsigned gridSize = GENERATE(32u, 128u, 256u);
+    const std::filesystem::path objFile = makeGridObjFile(gridSize);
+
+    BENCHMARK(fmt::format("loadMesh {0}x{0} cacheVertices=on", gridSize))
+    {
+        return loadMesh(objFile, { .cacheVertices = true });
+    };
+    BENCHMARK(fmt::format("loadMesh {0}x{0} cacheVertices=off", gridSize))
+    {
+        return loadMesh(objFile, { .cacheVertices = false });
+    };
+    BENCHMARK(fmt::format("loadMesh {0}x{0} normalizeVertexPositions=on", gridSize))
+    {
+        return loadMesh(objFile, { .normalizeVertexPositions = true });
+    };
+}
+
+TEST_CASE("mergeMeshes", "[mesh]")
+{
+    const unsigned numMeshes = GENERATE(4u, 64u);
+    const std::vector<Mesh> meshes(numMeshes, makeGridMesh(64));
+
+    BENCHMARK(fmt::format("mergeMeshes {} x 64x64", numMeshes))
+    {
+        return mergeMeshes(meshes);
+    };
+}
+
+TEST_CASE("meshFlip", "[mesh]")
+{
+    // Flipping is done in place; applying it repeatedly costs the same every time.
+    Mesh mesh = makeGridMesh(256);
+
+    BENCHMARK("meshFlipX 256x256")
+    {
+        meshFlipX(mesh);
+        return mesh.vertices.front();
+    };
+    BENCHMARK("meshFlipY 256x256")
+    {
+        meshFlipY(mesh);
+        return mesh.vertices.front();
+    };
+    BENCHMARK("meshFlipZ 256x256")
+    {
+        meshFlipZ(mesh);
+        return mesh.vertices.front();
+    };
+}
+
+TEST_CASE("centerAndScaleToUnitMesh", "[mesh]")
+{
+    const unsigned gridSize = GENERATE(64u, 256u);
+    std::vector<Mesh> meshes(4, makeGridMesh(gridSize));
+
+    BENCHMARK(fmt::format("centerAndScaleToUnitMesh 4 x {0}x{0}", gridSize))
+    {
+        centerAndScaleToUnitMesh(meshes);
+        return meshes.front().vertices.front();
+    };
+}
@@ -0,0 +1,102 @@
+#include "synthetic_data.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+#include <glm/geometric.hpp>
+#include <stb/stb_image_write.h>
+DISABLE_WARNINGS_POP()
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+static std::filesystem::path dataDirectory()
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "framework_benchmarks";
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+static Vertex gridVertex(unsigned x, unsigned z, unsigned gridSize)
+{
+    const glm::vec2 uv = glm::vec2(float(x), float(z)) / float(gridSize);
+    const float height = 0.1f * std::sin(uv.x * 20.0f) * std::cos(uv.y * 20.0f);
+    const float dHeightDx = 2.0f * std::cos(uv.x * 20.0f) * std::cos(uv.y * 20.0f);
+    const float dHeightDz = -2.0f * std::sin(uv.x * 20.0f) * std::sin(uv.y * 20.0f);
+    return Vertex {
+        .position = glm::vec3(uv.x, height, uv.y),
+        .normal = glm::normalize(glm::vec3(-dHeightDx, 1.0f, -dHeightDz)),
+        .texCoord = uv
+    };
+}
+
+Mesh makeGridMesh(unsigned gridSize)
+{
+    Mesh mesh;
+    mesh.material.kd = glm::vec3(0.8f);
+    mesh.vertices.reserve((gridSize + 1) * (gridSize + 1));
+    for (unsigned z = 0; z <= gridSize; ++z) {
+        for (unsigned x = 0; x <= gridSize; ++x)
+            mesh.vertices.push_back(gridVertex(x, z, gridSize));
+    }
+
+    mesh.triangles.reserve(2 * gridSize * gridSize);
+    for (unsigned z = 0; z < gridSize; ++z) {
+        for (unsigned x = 0; x < gridSize; ++x) {
+            const unsigned v00 = z * (gridSize + 1) + x;
+            const unsigned v10 = v00 + 1;
+            const unsigned v01 = v00 + gridSize + 1;
+            const unsigned v11 = v01 + 1;
+            mesh.triangles.emplace_back(v00, v01, v10);
+            mesh.triangles.emplace_back(v10, v01, v11);
+        }
+    }
+    return mesh;
+}
+
+std::filesystem::path makeGridObjFile(unsigned gridSize)
+{
+    const std::filesystem::path filePath = dataDirectory() / fmt::format("grid_{}.obj", gridSize);
+    if (std::filesystem::exists(filePath))
+        return filePath;
+
+    const Mesh mesh = makeGridMesh(gridSize);
+    std::ofstream file { filePath };
+    for (const Vertex& vertex : mesh.vertices)
+        file << fmt::format("v {} {} {}\n", vertex.position.x, vertex.position.y, vertex.position.z);
+    for (const Vertex& vertex : mesh.vertices)
+        file << fmt::format("vn {} {} {}\n", vertex.normal.x, vertex.normal.y, vertex.normal.z);
+    for (const Vertex& vertex : mesh.vertices)
+        file << fmt::format("vt {} {}\n", vertex.texCoord.x, vertex.texCoord.y);
+    // OBJ indices start at 1.
+    for (const glm::uvec3& triangle : mesh.triangles)
+        file << fmt::format("f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n", triangle.x + 1, triangle.y + 1, triangle.z + 1);
+    if (!file)
+        throw std::runtime_error(fmt::format("Could not write {}", filePath.string()));
+    return filePath;
+}
+
+std::filesystem::path makePngFile(int size, int channels)
+{
+    const std::filesystem::path filePath = dataDirectory() / fmt::format("image_{}_{}.png", size, channels);
+    if (std::filesystem::exists(filePath))
+        return filePath;
+
+    // Fixed seed: every run decodes exactly the same data.
+    uint32_t random = 12345;
+    std::vector<uint8_t> pixels(size_t(size) * size_t(size) * size_t(channels));
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            for (int channel = 0; channel < channels; ++channel) {
+                random = random * 1664525u + 1013904223u;
+                const int gradient = ((x + channel * y) * 255) / size;
+                pixels[(size_t(y) * size_t(size) + size_t(x)) * size_t(channels) + size_t(channel)] = uint8_t((gradient + int(random >> 28)) & 0xFF);
+            }
+        }
+    }
+    const std::string filePathString = filePath.string();
+    if (!stbi_write_png(filePathString.c_str(), size, size, channels, pixels.data(), size * channels))
+        throw std::runtime_error(fmt::format("Could not write {}", filePathString));
+    return filePath;
+}
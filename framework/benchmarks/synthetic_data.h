@@ -0,0 +1,13 @@
+#pragma once
+#include <filesystem>
+#include <framework/mesh.h>
+
+// Generators for the inputs of the benchmarks, so that they do not depend on (large) assets being checked in.
+// Files are written to a directory in the system temp directory and reused by later calls with the same arguments.
+
+// Wavy grid of gridSize x gridSize quads (two triangles each) in the XZ plane with normals and texture coordinates.
+[[nodiscard]] Mesh makeGridMesh(unsigned gridSize);
+// The same grid as an OBJ file. Vertices are shared between quads so that vertex caching has an effect.
+[[nodiscard]] std::filesystem::path makeGridObjFile(unsigned gridSize);
+// Square image with smooth gradients and noise, so that PNG decoding does not hit a trivial fast path.
+[[nodiscard]] std::filesystem::path makePngFile(int size, int channels);
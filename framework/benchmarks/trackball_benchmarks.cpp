@@ -0,0 +1,27 @@
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <glm/trigonometric.hpp>
+DISABLE_WARNINGS_POP()
+#include <framework/ray.h>
+#include <framework/trackball.h>
+
+TEST_CASE("Trackball::generateRay", "[trackball]")
+{
+    const Trackball trackball { glm::radians(60.0f), 16.0f / 9.0f, glm::vec3(0.0f), 4.0f, 0.3f, 0.8f };
+
+    // One primary ray per pixel of a 640x360 image, as a ray tracer would generate them.
+    constexpr int width = 640, height = 360;
+    BENCHMARK("generateRay 640x360")
+    {
+        glm::vec3 sum { 0.0f };
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const glm::vec2 pixel = glm::vec2(float(x) + 0.5f, float(y) + 0.5f) / glm::vec2(width, height) * 2.0f - 1.0f;
+                sum += trackball.generateRay(pixel).direction;
+            }
+        }
+        return sum;
+    };
+}
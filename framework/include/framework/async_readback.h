@@ -0,0 +1,59 @@
+#pragma once
+#include "disable_all_warnings.h"
+#include "memory_tracker.h"
+#include "opengl_includes.h"
+DISABLE_WARNINGS_PUSH()
+#include <glm/vec2.hpp>
+DISABLE_WARNINGS_POP()
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Pixels read back from a framebuffer; RGBA8, tightly packed, bottom row first (OpenGL convention).
+struct CapturedImage {
+    glm::ivec2 size;
+    std::vector<uint8_t> pixels;
+};
+
+// Reads framebuffers back without stalling the pipeline.
+//
+// capture() copies the pixels into one of a ring of pixel pack buffers (PBOs); the copy runs asynchronously on the GPU
+// and is guarded by a fence. poll() hands the pixels of all finished captures to their callbacks, in capture order, by
+// mapping the buffer. Waiting only happens when all buffers are still in flight (so at most numBuffers captures are
+// outstanding) or in finish().
+class AsyncReadback {
+public:
+    using Callback = std::function<void(CapturedImage&&)>;
+
+    explicit AsyncReadback(uint32_t numBuffers = 3);
+    AsyncReadback(const AsyncReadback&) = delete;
+    ~AsyncReadback();
+
+    AsyncReadback& operator=(const AsyncReadback&) = delete;
+
+    // Start reading the given region of the current read framebuffer.
+    void capture(const glm::ivec2& offset, const glm::ivec2& size, Callback&& callback);
+    // Invoke the callbacks of all captures that the GPU has completed; call once per frame.
+    void poll();
+    // Wait for all outstanding captures and invoke their callbacks.
+    void finish();
+
+    [[nodiscard]] uint32_t numPending() const;
+
+private:
+    struct Slot {
+        GLuint buffer { 0 };
+        size_t capacity { 0 };
+        GLsync fence { nullptr };
+        glm::ivec2 size { 0 };
+        Callback callback;
+        TrackedMemory memory {};
+    };
+
+    void complete(Slot& slot, bool wait);
+
+private:
+    std::vector<Slot> m_slots;
+    uint32_t m_oldest { 0 }; // Slot of the oldest outstanding capture (if any).
+    uint32_t m_numPending { 0 };
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// Reports modifications of a set of files.
+// Uses inotify on Linux; other platforms (or when inotify is unavailable) fall back to polling the modification times.
+// Directories are watched instead of files so that editors that save by writing a new file and renaming it over the
+// old one are detected as well.
+class FileWatcher {
+public:
+    FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    ~FileWatcher();
+
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Adding a file that is already watched has no effect.
+    void addFile(const std::filesystem::path& file);
+
+    // Files that were modified since the previous call. Never blocks.
+    [[nodiscard]] std::vector<std::filesystem::path> poll();
+
+    [[nodiscard]] bool usesNotifications() const;
+
+    // Minimum time between two checks of the modification times on the polling path.
+    static constexpr std::chrono::milliseconds pollInterval { 250 };
+
+private:
+    std::vector<std::filesystem::path> pollModificationTimes();
+    std::vector<std::filesystem::path> readNotifications();
+
+private:
+    // Canonical path => last seen modification time (only used when polling).
+    std::map<std::filesystem::path, std::filesystem::file_time_type> m_files;
+    std::chrono::steady_clock::time_point m_lastPoll;
+
+    int m_inotifyFd { -1 };
+    std::unordered_map<int, std::filesystem::path> m_watchedDirectories; // inotify watch descriptor => directory
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+struct FrameAllocatorStats {
+    size_t lastFrameBytes { 0 }; // Allocated by all threads during the last completed frame.
+    size_t peakFrameBytes { 0 };
+    uint64_t lastFrameNumAllocations { 0 };
+    size_t reservedBytes { 0 }; // Size of all blocks of all threads.
+    uint64_t numHeapAllocations { 0 }; // Blocks requested from the heap since the start of the program.
+    uint32_t numThreads { 0 }; // Threads that own an arena.
+};
+
+// Linear (bump) allocator for data that only lives for a frame, such as the temporary arrays of culling and rendering.
+//
+// Every thread allocates from its own arena, so an allocation is a pointer increment without any locking. Memory is
+// never freed individually; nextFrame(), called by Window::present(), recycles all of it at once. The arenas are double
+// buffered so that memory allocated in frame N stays valid until the end of frame N+1 and may be handed to the render
+// thread. A thread switches buffers on its first allocation in a new frame, so nextFrame() never touches memory that
+// another thread is still using.
+//
+// When a frame needed more than one block, the blocks of that buffer are merged into a single block the next time it is
+// recycled, so in steady state a frame makes no heap allocations.
+//
+// std::pmr containers use the arena of the thread that allocates through resource():
+//   std::pmr::vector<glm::vec4> positions { FrameAllocator::resource() };
+// Such containers must not be kept beyond the next frame.
+class FrameAllocator {
+public:
+    static constexpr size_t blockSize = 1024 * 1024;
+
+    static FrameAllocator& get();
+    // Allocates from FrameAllocator::get(); deallocation is a no-op.
+    [[nodiscard]] static std::pmr::memory_resource* resource();
+
+    [[nodiscard]] void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+    // Start a new frame and update the statistics; call once per frame.
+    void nextFrame();
+
+    [[nodiscard]] FrameAllocatorStats stats() const;
+    void drawImGui();
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> pMemory;
+        size_t size;
+    };
+    struct Buffer {
+        std::vector<Block> blocks;
+        size_t offset { 0 }; // Into the last block.
+        // Written by the owning thread and read by nextFrame().
+        std::atomic<uint64_t> frameIndex { 0 };
+        std::atomic<size_t> numBytes { 0 };
+        std::atomic<uint64_t> numAllocations { 0 };
+    };
+    struct ThreadArena {
+        std::array<Buffer, 2> buffers;
+        uint32_t currentBuffer { 0 };
+        std::atomic<size_t> reservedBytes { 0 };
+        std::atomic<bool> inUse { true };
+    };
+    // Releases the arena of a thread when the thread exits so that the next new thread can take it over.
+    struct ThreadArenaHandle {
+        ThreadArena* pArena { nullptr };
+        ~ThreadArenaHandle();
+    };
+
+    FrameAllocator() = default;
+    ThreadArena& threadArena();
+    void recycle(ThreadArena& arena, Buffer& buffer);
+    void addBlock(ThreadArena& arena, Buffer& buffer, size_t minSize);
+
+private:
+    std::atomic<uint64_t> m_frameIndex { 0 };
+    std::atomic<uint64_t> m_numHeapAllocations { 0 };
+
+    mutable std::mutex m_mutex; // Protects the list of arenas and the statistics below.
+    std::vector<std::unique_ptr<ThreadArena>> m_arenas;
+    size_t m_lastFrameBytes { 0 };
+    size_t m_peakFrameBytes { 0 };
+    uint64_t m_lastFrameNumAllocations { 0 };
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include "async_readback.h"
+#include "disable_all_warnings.h"
+#include "image_writer.h"
+DISABLE_WARNINGS_PUSH()
+#include <glm/vec2.hpp>
+DISABLE_WARNINGS_POP()
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Records every rendered frame to disk, for example to make videos of a fixed camera path.
+//
+// Frames are read back asynchronously (see AsyncReadback). When outputPath has a video extension (.mp4, .mkv, .mov,
+// .webm) and ffmpeg is on the PATH, the raw frames are piped to ffmpeg from a writer thread; otherwise they are encoded
+// in parallel as an image sequence outputPath/frame_00000.png (or .qoi). The encoders can hold at most maxQueuedBytes
+// of frames; beyond that captureFrame() blocks until they catch up, so recording slows down instead of running out of
+// memory. Throws std::runtime_error when the output can not be created.
+class FrameRecorder {
+public:
+    enum class ImageFormat {
+        Png,
+        Qoi
+    };
+
+    FrameRecorder(const std::filesystem::path& outputPath, const glm::ivec2& size, uint32_t frameRate,
+        ImageFormat imageFormat = ImageFormat::Png, size_t maxQueuedBytes = 512 * 1024 * 1024);
+    FrameRecorder(const FrameRecorder&) = delete;
+    ~FrameRecorder(); // Calls finish().
+
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // Capture the bottom left size pixels of the current read framebuffer as the next frame.
+    void captureFrame();
+    // Hand finished readbacks to the encoders; call once per frame.
+    void poll();
+    // Wait until all captured frames have been written and close the video.
+    void finish();
+
+    [[nodiscard]] bool isRecordingVideo() const;
+    [[nodiscard]] uint32_t numFramesCaptured() const;
+    // Time that captureFrame()/poll() were blocked because the encoders could not keep up.
+    [[nodiscard]] float backpressureMs() const;
+
+    [[nodiscard]] static bool isFfmpegAvailable();
+
+private:
+    void submit(CapturedImage&& image);
+    void pipeLoop();
+
+private:
+    glm::ivec2 m_size;
+    std::filesystem::path m_outputPath;
+    ImageFormat m_imageFormat;
+    const size_t m_maxQueuedBytes;
+
+    AsyncReadback m_readback { 4 };
+    uint32_t m_numFramesCaptured { 0 };
+    uint32_t m_numFramesSubmitted { 0 };
+    float m_backpressureMs { 0.0f };
+    bool m_finished { false };
+
+    // Image sequence.
+    std::unique_ptr<ImageWriter> m_pImageWriter;
+
+    // Video: frames are written to ffmpeg's stdin in order by a single thread.
+    std::FILE* m_pPipe { nullptr };
+    std::thread m_pipeThread;
+    std::mutex m_pipeMutex;
+    std::condition_variable m_pipeFrameAvailable;
+    std::condition_variable m_pipeFrameWritten;
+    std::deque<std::vector<uint8_t>> m_pipeFrames;
+    size_t m_pipeQueuedBytes { 0 };
+    bool m_pipeStop { false };
+    bool m_pipeFailed { false };
+};
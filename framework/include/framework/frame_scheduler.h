@@ -0,0 +1,81 @@
+#pragma once
+#include "window.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+struct FrameTimeStatistics {
+    float meanMs { 0.0f };
+    float jitterMs { 0.0f }; // Standard deviation of the frame time.
+    float minMs { 0.0f };
+    float maxMs { 0.0f };
+    float p99Ms { 0.0f };
+    uint32_t numLateFrames { 0 }; // Frames that took more than 1.5x the frame rate limit.
+};
+
+// Paces the main loop and decouples simulation from rendering.
+//
+//  while (!window.shouldClose()) {
+//      const uint32_t numSteps = scheduler.beginFrame();
+//      window.updateInput();
+//      for (uint32_t i = 0; i < numSteps; ++i)
+//          simulate(scheduler.fixedTimestep());
+//      render(interpolate(previousState, currentState, scheduler.interpolationAlpha()));
+//      window.swapBuffers();
+//  }
+//
+// The simulation advances in fixed steps, so animations behave identically at any frame rate; rendering interpolates
+// between the last two simulation states. The optional frame rate limiter sleeps until shortly before the deadline and
+// spins for the remainder, since sleeping alone is only accurate to about a millisecond. Waiting happens before input is
+// polled, so limiting the frame rate also shortens the time between input and the frame that shows it.
+class FrameScheduler {
+public:
+    explicit FrameScheduler(Window* pWindow, double fixedTimestep = 1.0 / 60.0);
+
+    // Wait for the frame rate limit (if any) and advance the clocks. Returns the number of simulation steps to run.
+    uint32_t beginFrame();
+
+    // Wall clock time between the start of the previous and the current frame, in seconds (clamped to 0.25).
+    [[nodiscard]] double deltaTime() const;
+    [[nodiscard]] double fixedTimestep() const;
+    // Time of the latest simulation step in seconds.
+    [[nodiscard]] double simulationTime() const;
+    // How far the current frame is past the latest simulation step, as a fraction of the timestep (0 to 1).
+    [[nodiscard]] float interpolationAlpha() const;
+
+    void setFixedTimestep(double seconds);
+    // Maximum number of frames per second; 0 disables the limiter.
+    void setFrameRateLimit(double framesPerSecond);
+    [[nodiscard]] double frameRateLimit() const;
+    // The limiter sleeps until this many seconds before the deadline and spins for the rest (default 2ms).
+    void setSpinThreshold(double seconds);
+    void setVsyncMode(VsyncMode mode);
+
+    // Over the last numHistoryFrames frames.
+    [[nodiscard]] FrameTimeStatistics statistics() const;
+    // Vsync/limiter/timestep controls and a frame time graph.
+    void drawImGui();
+
+    static constexpr uint32_t numHistoryFrames = 240;
+    // After a long hitch the simulation skips ahead instead of running many steps at once (which would cause another hitch).
+    static constexpr uint32_t maxStepsPerFrame = 8;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    void waitForFrameRateLimit();
+
+private:
+    Window* m_pWindow;
+    double m_fixedTimestep;
+    double m_frameRateLimit { 0.0 };
+    double m_spinThreshold { 0.002 };
+
+    bool m_firstFrame { true };
+    Clock::time_point m_frameStart;
+    double m_deltaTime { 0.0 };
+    double m_accumulator { 0.0 };
+    double m_simulationTime { 0.0 };
+
+    std::array<float, numHistoryFrames> m_frameTimesMs {};
+    uint64_t m_numFrames { 0 };
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include "opengl_includes.h"
+#include "profiler.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// GPU counterpart of PROFILE_SCOPE(); measures the GPU time of the commands issued inside the scope.
+#ifdef FRAMEWORK_ENABLE_PROFILER
+#define GPU_PROFILE_SCOPE(name) const GpuProfileZone PROFILE_CONCAT(gpuProfileZone, __LINE__)(name)
+#else
+#define GPU_PROFILE_SCOPE(name) ((void)0)
+#endif
+
+// Measures GPU time per render pass with GL_TIMESTAMP queries (glQueryCounter).
+//
+// Every frame uses its own set of queries; the results of a set are read back numFrameSets frames later, when the GPU
+// has (almost always) finished them, so reading them never stalls. If a set is still not available it is skipped.
+// Results are shown as rolling averages (drawImGui()), optionally appended to a CSV file and forwarded to the CPU
+// Profiler so that they appear in its Chrome trace.
+//
+// Timer queries are core since OpenGL 3.3 and are also implemented by software rasterizers such as llvmpipe. Query
+// objects are never deleted: the profiler lives until the end of the program, when the GL context is already gone.
+// Zones and endFrame() belong to the thread that owns the GL context; the other functions may be called from any thread.
+class GpuProfiler {
+public:
+    static GpuProfiler& get();
+
+    // Close the current frame, read back the oldest finished frame and start recording a new frame. Call once per frame,
+    // before Profiler::endFrame() so that the read back zones end up in the same capture.
+    void endFrame();
+
+    // Called by GpuProfileZone; zones must be properly nested.
+    void beginZone(const char* name);
+    void endZone();
+
+    // Append "frame,zone,depth,start_ms,duration_ms" lines to the given file; disabled when empty.
+    void setCsvLog(const std::filesystem::path& filePath);
+
+    // Table of the last and average time of every zone.
+    void drawImGui();
+
+    [[nodiscard]] bool isSupported() const;
+    // Frame whose zones are currently recorded and the last frame whose results have been read back; the results lag
+    // behind by about numFrameSets frames.
+    [[nodiscard]] uint64_t currentFrame() const;
+    [[nodiscard]] uint64_t lastCompletedFrame() const;
+    // Duration of a zone in lastCompletedFrame(), or nothing if that frame did not contain the zone.
+    [[nodiscard]] std::optional<float> lastZoneMs(std::string_view name) const;
+    // Number of frames whose results were not available yet when their queries had to be reused.
+    [[nodiscard]] uint64_t numSkippedFrames() const;
+
+    static constexpr uint32_t numFrameSets = 3;
+    static constexpr uint32_t numAverageFrames = 64;
+
+private:
+    struct Zone {
+        const char* name;
+        uint32_t depth;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+    struct FrameSet {
+        std::vector<GLuint> queries;
+        uint32_t numUsedQueries { 0 };
+        std::vector<Zone> zones;
+        uint64_t frameIndex { 0 };
+        bool pending { false };
+        // CPU profiler time minus GPU time at the start of the frame, to move the GPU zones onto the CPU timeline.
+        int64_t cpuMinusGpuTime { 0 };
+    };
+    struct ZoneStatistics {
+        std::string name;
+        std::array<float, numAverageFrames> durationsMs {};
+        uint32_t numSamples { 0 };
+        uint64_t lastFrameIndex { 0 };
+    };
+
+    GpuProfiler() = default;
+    // Queries need a GL context, so the profiler initializes itself on first use.
+    void initialize();
+    uint32_t allocateQuery(FrameSet& frameSet);
+    void readBack(FrameSet& frameSet);
+    void startFrame(FrameSet& frameSet);
+
+private:
+    // Protects the results (statistics, counters, CSV log) that are shown on another thread than the GL thread.
+    mutable std::mutex m_mutex;
+    bool m_supported { false };
+    bool m_initialized { false };
+    std::array<FrameSet, numFrameSets> m_frameSets;
+    uint64_t m_frameIndex { 0 };
+    std::vector<uint32_t> m_openZones; // Indices into the zones of the current frame set.
+
+    std::vector<ZoneStatistics> m_statistics;
+    uint64_t m_numSkippedFrames { 0 };
+    uint64_t m_lastCompletedFrame { 0 };
+    std::ofstream m_csvLog;
+    bool m_csvLogging { false };
+};
+
+class GpuProfileZone {
+public:
+    explicit GpuProfileZone(const char* name)
+    {
+        GpuProfiler::get().beginZone(name);
+    }
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    ~GpuProfileZone()
+    {
+        GpuProfiler::get().endZone();
+    }
+
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+};
@@ -7,6 +7,7 @@ DISABLE_WARNINGS_PUSH()
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 DISABLE_WARNINGS_POP()
+#include "memory_tracker.h"
 #include <filesystem>
 #include <vector>
 
@@ -47,4 +48,5 @@ public:
 
 private:
     std::vector<uint8_t> pixels;
+    TrackedMemory m_memory; // Accounts the pixels to MemoryCategory::ImageData.
 };
@@ -0,0 +1,59 @@
+#pragma once
+#include "disable_all_warnings.h"
+DISABLE_WARNINGS_PUSH()
+#include <glm/vec2.hpp>
+DISABLE_WARNINGS_POP()
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Flips and encodes images on worker threads so that saving a screenshot does not stall the render thread.
+// The file format follows from the extension (.png, .bmp or .qoi). QOI encodes roughly an order of magnitude faster than
+// PNG at a similar size, which matters when recording every frame.
+class ImageWriter {
+public:
+    // write() blocks while more than maxQueuedBytes of pixels are waiting to be encoded.
+    explicit ImageWriter(uint32_t numThreads = 1, size_t maxQueuedBytes = 256 * 1024 * 1024);
+    ImageWriter(const ImageWriter&) = delete;
+    ~ImageWriter(); // Finishes all queued writes.
+
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    // Pixels are RGBA8 and tightly packed; flipY swaps the order of the rows before encoding.
+    void write(std::filesystem::path filePath, const glm::ivec2& size, std::vector<uint8_t>&& pixels, bool flipY);
+    // Block until all queued images have been written.
+    void waitIdle();
+
+    [[nodiscard]] size_t numQueued() const;
+    [[nodiscard]] size_t numFailed() const;
+
+private:
+    struct Job {
+        std::filesystem::path filePath;
+        glm::ivec2 size;
+        std::vector<uint8_t> pixels;
+        bool flipY;
+    };
+
+    void workerLoop();
+    static bool encode(Job& job);
+    static bool writeQoi(const std::filesystem::path& filePath, const glm::ivec2& size, const std::vector<uint8_t>& pixels);
+
+private:
+    const size_t m_maxQueuedBytes;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_jobFinished;
+    std::deque<Job> m_jobs;
+    size_t m_queuedBytes { 0 };
+    size_t m_numBusy { 0 };
+    size_t m_numFailed { 0 };
+    bool m_stop { false };
+
+    std::vector<std::thread> m_threads;
+};
@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+// Work-stealing job scheduler.
+//
+// Every worker thread owns a Chase-Lev deque: it pushes and pops its own jobs at the bottom (LIFO, cache friendly)
+// while idle workers steal from the top of other deques (FIFO, oldest and usually largest work first). Jobs queued
+// by threads that are not workers (main thread, render thread) go into a shared queue.
+//
+// There are no fibers: a thread that waits for a JobCounter executes other jobs in the meantime, so waiting inside a
+// job neither blocks a worker nor deadlocks. Follow-up work that should not occupy a waiting thread is expressed as a
+// continuation: run() with a dependency counter starts the job as soon as that counter reaches zero.
+//
+// Jobs must not throw; parallelFor() forwards exceptions of its function to the caller. Without worker threads (a single
+// core machine) run() executes the job immediately.
+class JobSystem {
+public:
+    using Function = std::function<void()>;
+    using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+    // Shared instance with one worker per hardware thread besides the calling thread.
+    static JobSystem& get();
+
+    explicit JobSystem(uint32_t numWorkers);
+    JobSystem(const JobSystem&) = delete;
+    ~JobSystem(); // All counters must have been waited for.
+
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Queue a job. pCounter (if any) is incremented immediately and decremented when the job finished. The job does
+    // not start before pDependency (if any) reached zero.
+    void run(Function&& function, JobCounter* pCounter = nullptr, JobCounter* pDependency = nullptr);
+    // Execute queued jobs until the counter reaches zero.
+    void wait(JobCounter& counter);
+    // Call function for consecutive subranges of [begin, end) of grainSize elements (the last one may be smaller) in
+    // parallel and wait for all of them. Rethrows the first exception thrown by function.
+    void parallelFor(size_t begin, size_t end, size_t grainSize, const RangeFunction& function);
+
+    // Worker threads plus the calling thread, which takes part while it waits.
+    [[nodiscard]] uint32_t numThreads() const;
+
+private:
+    struct Job {
+        Function function;
+        JobCounter* pCounter;
+        JobSystem* pSystem; // To queue continuations when their dependency finishes.
+    };
+    class WorkStealingDeque;
+    struct Worker;
+    friend class JobCounter;
+
+    [[nodiscard]] Job* newJob(Function&& function, JobCounter* pCounter);
+    void enqueue(Job* pJob, bool wake = true);
+    void wakeWorkers(uint32_t count);
+    [[nodiscard]] Job* findJob(Worker* pWorker);
+    void execute(Job* pJob);
+    void workerLoop(Worker& worker);
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // Jobs queued by threads that are not workers of this system.
+    std::mutex m_sharedQueueMutex;
+    std::deque<Job*> m_sharedQueue;
+
+    // Number of jobs in all queues; idle workers sleep while it is zero.
+    std::atomic<int64_t> m_numQueued { 0 };
+    std::atomic<uint32_t> m_numSleeping { 0 };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+    bool m_stop { false };
+};
+
+// Number of unfinished jobs that were started with it (see JobSystem::run()). Can be reused once it reached zero.
+// Wait for it with JobSystem::wait() (or check isDone()) before it is destroyed.
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    ~JobCounter();
+
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    [[nodiscard]] bool isDone() const;
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_numPending { 0 };
+    std::mutex m_mutex; // Protects m_continuations.
+    std::vector<JobSystem::Job*> m_continuations; // Jobs that start when m_numPending reaches zero.
+};
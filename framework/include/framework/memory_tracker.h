@@ -0,0 +1,128 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// Accounts the memory of the CPU and GPU copies of assets.
+//
+// CPU buffers are counted by their allocator (TrackedAllocator) or by their owner (TrackedMemory); GPU resources are
+// counted by the object that creates them, from the sizes passed to glBufferData/glTexImage*, so the numbers are what
+// was requested from the driver and exclude its padding and internal copies.
+//
+// Every category keeps its current and peak (high-water mark) usage and, for allocations with an asset name, a break
+// down per asset. Thread-safe.
+enum class MemoryCategory : uint32_t {
+    MeshData, // Vertices and triangles of Mesh
+    ImageData, // Pixels of Image
+    GpuBuffer,
+    GpuTexture,
+    ShaderProgram, // Size of the program binary; the driver's internal representation may differ.
+};
+inline constexpr size_t numMemoryCategories = 5;
+
+[[nodiscard]] const char* memoryCategoryName(MemoryCategory category);
+// Size of a 2D texture (array) including the full mip chain that glGenerateMipmap() creates.
+[[nodiscard]] size_t mipChainBytes(int width, int height, int numLayers, int bytesPerTexel);
+
+struct MemoryUsage {
+    size_t currentBytes { 0 };
+    size_t peakBytes { 0 };
+    size_t numAllocations { 0 }; // Allocations that are currently alive.
+};
+
+class MemoryTracker {
+public:
+    static MemoryTracker& get();
+
+    // The asset name may be empty; such allocations only count towards their category.
+    void allocate(MemoryCategory category, std::string_view asset, size_t bytes);
+    void free(MemoryCategory category, std::string_view asset, size_t bytes);
+
+    // Categories whose current usage exceeds their budget are highlighted in drawImGui(); 0 means no budget.
+    void setBudget(MemoryCategory category, size_t bytes);
+    [[nodiscard]] size_t budget(MemoryCategory category) const;
+
+    [[nodiscard]] MemoryUsage usage(MemoryCategory category) const;
+    [[nodiscard]] MemoryUsage totalUsage() const;
+    [[nodiscard]] std::map<std::string, MemoryUsage, std::less<>> assetUsage(MemoryCategory category) const;
+
+    // Usage per category with the largest assets.
+    void drawImGui();
+    // Returns false if the file could not be written.
+    bool writeJson(const std::filesystem::path& filePath) const;
+
+private:
+    struct Category {
+        MemoryUsage usage;
+        size_t budget { 0 };
+        std::map<std::string, MemoryUsage, std::less<>> assets;
+    };
+
+    MemoryTracker() = default;
+
+private:
+    mutable std::mutex m_mutex;
+    std::array<Category, numMemoryCategories> m_categories;
+    MemoryUsage m_total;
+};
+
+// Accounts a block of memory for as long as it lives; copies account another block of the same size.
+class TrackedMemory {
+public:
+    TrackedMemory() = default;
+    TrackedMemory(MemoryCategory category, std::string asset, size_t bytes);
+    TrackedMemory(const TrackedMemory&);
+    TrackedMemory(TrackedMemory&&) noexcept;
+    ~TrackedMemory();
+
+    TrackedMemory& operator=(const TrackedMemory&);
+    TrackedMemory& operator=(TrackedMemory&&) noexcept;
+
+    // Change the size, e.g. after a buffer was reallocated.
+    void resize(size_t bytes);
+    [[nodiscard]] size_t bytes() const;
+
+private:
+    void release();
+
+private:
+    MemoryCategory m_category { MemoryCategory::MeshData };
+    std::string m_asset;
+    size_t m_bytes { 0 };
+};
+
+// Standard allocator that accounts all memory of a container to a category.
+template <typename T, MemoryCategory Category>
+struct TrackedAllocator {
+    using value_type = T;
+
+    TrackedAllocator() = default;
+    template <typename U>
+    constexpr TrackedAllocator(const TrackedAllocator<U, Category>&) noexcept { }
+
+    [[nodiscard]] T* allocate(size_t n)
+    {
+        T* pData = std::allocator<T>().allocate(n);
+        MemoryTracker::get().allocate(Category, {}, n * sizeof(T));
+        return pData;
+    }
+    void deallocate(T* pData, size_t n) noexcept
+    {
+        MemoryTracker::get().free(Category, {}, n * sizeof(T));
+        std::allocator<T>().deallocate(pData, n);
+    }
+
+    template <typename U>
+    struct rebind {
+        using other = TrackedAllocator<U, Category>;
+    };
+
+    template <typename U>
+    constexpr bool operator==(const TrackedAllocator<U, Category>&) const noexcept { return true; }
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "image.h"
+#include "memory_tracker.h"
 // Suppress warnings in third-party code.
 #include <framework/disable_all_warnings.h>
 DISABLE_WARNINGS_PUSH()
@@ -33,11 +34,15 @@ struct Material {
 	std::shared_ptr<Image> kdTexture;
 };
 
+// Memory of mesh data is accounted to MemoryCategory::MeshData.
+template <typename T>
+using MeshVector = std::vector<T, TrackedAllocator<T, MemoryCategory::MeshData>>;
+
 struct Mesh {
 	// Vertices contain the vertex positions and normals of the mesh.
-	std::vector<Vertex> vertices;
+	MeshVector<Vertex> vertices;
 	// A triangle contains a triplet of values corresponding to the indices of the 3 vertices in the vertices array.
-	std::vector<glm::uvec3> triangles;
+	MeshVector<glm::uvec3> triangles;
 
 	Material material;
 };
@@ -49,6 +54,8 @@ struct LoadMeshSettings {
 
 [[nodiscard]] std::vector<Mesh> loadMesh(const std::filesystem::path& file, const LoadMeshSettings& settings = {});
 [[nodiscard]] Mesh mergeMeshes(std::span<const Mesh> meshes);
+// Translate and scale all meshes together such that their vertices fit into the unit sphere around the origin.
+void centerAndScaleToUnitMesh(std::span<Mesh> meshes);
 void meshFlipX(Mesh& mesh);
 void meshFlipY(Mesh& mesh);
 void meshFlipZ(Mesh& mesh);
\ No newline at end of file
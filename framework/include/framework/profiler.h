@@ -0,0 +1,189 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#ifdef FRAMEWORK_ENABLE_PROFILER
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#endif
+
+// Scoped CPU profiler.
+//
+//  void Application::update()
+//  {
+//      PROFILE_FUNCTION();
+//      {
+//          PROFILE_SCOPE("Culling");
+//          ...
+//      }
+//  }
+//
+// Every thread writes the zones it completes into its own single-producer ring buffer, so recording a zone never takes a
+// lock. Profiler::endFrame() collects the zones of all threads; they can be shown as a flame graph (drawImGui()) or be
+// captured and written as a Chrome trace (chrome://tracing, https://ui.perfetto.dev).
+//
+// Zone names must be string literals (or otherwise outlive the profiler); only the pointer is stored.
+// When FRAMEWORK_ENABLE_PROFILER is not defined (CMake option of the same name) the macros compile to nothing and
+// Profiler is replaced by an empty inline class with the same interface, so callers need no #ifdefs.
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#ifdef FRAMEWORK_ENABLE_PROFILER
+#define PROFILE_SCOPE(name) const ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#endif
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t start; // Nanoseconds since the profiler was created
+    uint64_t end;
+    uint32_t depth; // Number of enclosing zones on the same thread
+};
+
+#ifdef FRAMEWORK_ENABLE_PROFILER
+class Profiler {
+public:
+    static Profiler& get();
+
+    // Nanoseconds since the profiler was created (std::chrono::steady_clock).
+    [[nodiscard]] uint64_t now() const;
+
+    // Collect the zones recorded by all threads since the previous call; call once per frame.
+    void endFrame();
+
+    // Zones of the previous frame, per thread.
+    struct Lane {
+        uint32_t threadId;
+        std::vector<ProfileEvent> events;
+    };
+    [[nodiscard]] const std::vector<Lane>& lastFrame() const;
+    [[nodiscard]] uint64_t lastFrameStart() const;
+    [[nodiscard]] uint64_t lastFrameEnd() const;
+
+    // While capturing, the zones of all frames are kept until writeChromeTrace() is called.
+    void setCapturing(bool capturing);
+    [[nodiscard]] bool isCapturing() const;
+    // Write (and clear) the captured zones in the Chrome trace event format. Returns false if the file cannot be written.
+    bool writeChromeTrace(const std::filesystem::path& filePath);
+
+    // Flame graph of the last frame and controls for capturing.
+    void drawImGui();
+
+    // Number of zones that were lost because a thread recorded more zones in a frame than its buffer holds.
+    [[nodiscard]] uint64_t numDroppedEvents() const;
+
+    // Zone measured on the GPU (see GpuProfiler), converted to the CPU timeline. GPU zones arrive a few frames late, so
+    // they only appear in captures (as their own thread). May be called from any thread (e.g. a render thread).
+    void recordGpuZone(const ProfileEvent& event);
+    static constexpr uint32_t gpuThreadId = 0xFFFF;
+
+    // Called by ProfileZone.
+    void record(const ProfileEvent& event);
+    uint32_t enterZone();
+
+    static constexpr size_t threadBufferCapacity = 16384;
+    static constexpr size_t maxCapturedEvents = 4 * 1024 * 1024;
+
+private:
+    // Single-producer single-consumer ring buffer; written by its thread, drained by endFrame().
+    struct ThreadBuffer {
+        std::array<ProfileEvent, threadBufferCapacity> events;
+        std::atomic<uint64_t> writeIndex { 0 };
+        std::atomic<uint64_t> readIndex { 0 };
+        std::atomic<uint64_t> numDropped { 0 };
+        std::atomic<bool> inUse { true };
+        uint32_t threadId { 0 }; // Index of the buffer; reused by threads that start after another thread exited.
+        uint32_t depth { 0 };
+    };
+    struct ThreadBufferHandle {
+        ~ThreadBufferHandle();
+        ThreadBuffer* pBuffer { nullptr };
+    };
+    struct CapturedEvent {
+        ProfileEvent event;
+        uint32_t threadId;
+    };
+
+    Profiler();
+    ThreadBuffer& threadBuffer();
+
+private:
+    const std::chrono::steady_clock::time_point m_startTime;
+
+    // Taken when a thread records its first zone and when the buffers are read (once per frame), never per zone.
+    mutable std::mutex m_threadBuffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threadBuffers;
+
+    std::vector<Lane> m_lastFrame;
+    uint64_t m_lastFrameStart { 0 };
+    uint64_t m_lastFrameEnd { 0 };
+
+    std::atomic<bool> m_capturing { false };
+    std::vector<CapturedEvent> m_capturedEvents;
+    std::mutex m_gpuZonesMutex;
+    std::vector<ProfileEvent> m_gpuZones; // Recorded since the last endFrame().
+};
+
+// Records the time between its construction and destruction as a zone of the calling thread.
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name)
+        : m_name(name)
+        , m_depth(Profiler::get().enterZone())
+        , m_start(Profiler::get().now())
+    {
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ~ProfileZone()
+    {
+        Profiler::get().record({ m_name, m_start, Profiler::get().now(), m_depth });
+    }
+
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* m_name;
+    uint32_t m_depth;
+    uint64_t m_start;
+};
+#else
+class Profiler {
+public:
+    static Profiler& get()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    [[nodiscard]] uint64_t now() const { return 0; }
+    void endFrame() { }
+
+    struct Lane {
+        uint32_t threadId;
+        std::vector<ProfileEvent> events;
+    };
+    [[nodiscard]] const std::vector<Lane>& lastFrame() const
+    {
+        static const std::vector<Lane> noLanes;
+        return noLanes;
+    }
+    [[nodiscard]] uint64_t lastFrameStart() const { return 0; }
+    [[nodiscard]] uint64_t lastFrameEnd() const { return 0; }
+
+    void setCapturing(bool) { }
+    [[nodiscard]] bool isCapturing() const { return false; }
+    bool writeChromeTrace(const std::filesystem::path&) { return false; }
+
+    void drawImGui() { }
+
+    [[nodiscard]] uint64_t numDroppedEvents() const { return 0; }
+
+    void recordGpuZone(const ProfileEvent&) { }
+    static constexpr uint32_t gpuThreadId = 0xFFFF;
+};
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+#include "window.h"
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ImDrawList;
+
+// Copy of the ImGui draw data of a frame that stays valid after the next ImGui::NewFrame(), so that the UI can be built
+// on the main thread while a previous frame is still being rendered on another thread.
+class ImGuiDrawSnapshot {
+public:
+    ImGuiDrawSnapshot() = default;
+    ImGuiDrawSnapshot(const ImGuiDrawSnapshot&) = delete;
+    ~ImGuiDrawSnapshot();
+
+    ImGuiDrawSnapshot& operator=(const ImGuiDrawSnapshot&) = delete;
+
+    // Finish the current ImGui frame (ImGui::Render()) and copy its draw lists.
+    void capture();
+    // Null before the first capture(); for Window::renderImGui().
+    [[nodiscard]] ImDrawData* drawData();
+
+private:
+    void clear();
+
+private:
+    std::unique_ptr<ImDrawData> m_pDrawData;
+    std::vector<ImDrawList*> m_drawLists;
+};
+
+// Runs all OpenGL work on a dedicated thread that owns the context of the window.
+//
+// The main thread fills render packets (whatever the application needs to render a frame: draw lists, matrices, UI)
+// while the render thread consumes the previously submitted packet, so simulation and culling of frame N overlap with
+// driver submission and presenting of frame N-1. Packets are double buffered: beginPacket() returns the index of the
+// packet to fill and only blocks while the render thread still reads that packet, which limits the latency to one frame.
+// The render function receives the same index and must present the frame itself (Window::present()).
+//
+// The constructor moves the context of the window to the render thread and the destructor moves it back, so no OpenGL
+// calls may be made on the main thread in between (this includes Window::renderToImage(); call it from the render
+// function instead). Window::updateInput() does not touch the context and stays on the main thread, as GLFW requires.
+class RenderThread {
+public:
+    static constexpr uint32_t numPackets = 2;
+    using RenderFunction = std::function<void(uint32_t packetIndex)>;
+
+    RenderThread(Window& window, RenderFunction&& render);
+    RenderThread(const RenderThread&) = delete;
+    ~RenderThread(); // Renders the outstanding packets.
+
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Index of the packet to fill next; waits until the render thread is done with it. Rethrows exceptions thrown by
+    // the render function.
+    [[nodiscard]] uint32_t beginPacket();
+    // Hand the packet returned by beginPacket() to the render thread.
+    void submitPacket();
+    // Block until all submitted packets have been rendered.
+    void waitIdle();
+
+    // Time the main thread waited in the last beginPacket(): non-zero when rendering is the bottleneck.
+    [[nodiscard]] float mainThreadWaitMs() const;
+    // Time the render thread waited for the last packet: non-zero when the main thread is the bottleneck.
+    [[nodiscard]] float renderThreadWaitMs() const;
+
+private:
+    void threadLoop();
+    void rethrowRenderException();
+
+private:
+    Window& m_window;
+    RenderFunction m_render;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_packetSubmitted;
+    std::condition_variable m_packetRendered;
+    uint64_t m_numSubmitted { 0 };
+    uint64_t m_numRendered { 0 };
+    bool m_stop { false };
+    std::exception_ptr m_pRenderException;
+    float m_mainThreadWaitMs { 0.0f };
+    float m_renderThreadWaitMs { 0.0f };
+
+    std::thread m_thread;
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include "disable_all_warnings.h"
+#include "memory_tracker.h"
 #include "opengl_includes.h"
 DISABLE_WARNINGS_PUSH()
 #include <glm/mat3x3.hpp>
@@ -9,13 +10,33 @@ DISABLE_WARNINGS_PUSH()
 #include <glm/vec4.hpp>
 DISABLE_WARNINGS_POP()
 #include <exception>
+#include <cstdint>
 #include <filesystem>
+#include <string>
 #include <vector>
 
 struct ShaderLoadingException : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
 
+// Member of a uniform block as laid out by a C++ struct; see UniformBlockLayout.
+struct UniformBlockMember {
+    std::string name; // As reported by OpenGL, e.g. "kd", or "materials[0].kd" for an array of structs.
+    size_t offset; // offsetof() in the C++ struct
+    GLenum type; // E.g. GL_FLOAT_VEC3
+};
+
+// The std140 layout of a uniform block as defined by the C++ struct that is uploaded to it.
+// Every program that contains a block with this name is checked against the layout when it is built, so a struct that
+// does not match its GLSL declaration fails at startup instead of silently corrupting the uniform data.
+// Matrices are expected to be column major with 16 byte columns (glm::mat4, glm::mat3x4).
+struct UniformBlockLayout {
+    std::string blockName;
+    size_t size; // sizeof() the C++ struct
+    size_t arraySize { 1 }; // Number of structs if the block contains an array of them (e.g. "materials[0].kd").
+    std::vector<UniformBlockMember> members;
+};
+
 class Shader {
 public:
     Shader();
@@ -27,9 +48,13 @@ public:
 
     // ... Feel free to add more methods here (e.g. for setting uniforms or keeping track of texture units) ...
     void bind() const;
+    // False for default constructed (e.g. because building the program failed) and moved from shaders.
+    [[nodiscard]] bool isValid() const;
 
     // Bind the uniform define by the given name to the given buffer and location in its assigned block, 
     void bindUniformBlock(const std::string& blockName, GLuint bindingLocation, GLuint uniformBlockBuffer) const;
+    // Whether the shader declares (and uses) the given uniform block; unused blocks are removed by the compiler.
+    [[nodiscard]] bool hasUniformBlock(const std::string& blockName) const;
 
     // Query an attribute location by its name in the shader
     GLuint getAttributeLocation(const std::string& name) const;
@@ -39,10 +64,54 @@ public:
 
 private:
     friend class ShaderBuilder;
-    Shader(GLuint program);
+    friend class PendingShader;
+    // The name identifies the program in the MemoryTracker.
+    Shader(GLuint program, std::string name);
 
 private:
     GLuint m_program;
+    TrackedMemory m_memory;
+};
+
+// Maps the lines of a shader with expanded includes back to the files that they came from.
+// Used to rewrite compile logs, because not all drivers report the source string numbers of #line directives.
+struct ShaderSourceMap {
+    struct Segment {
+        uint32_t line; // First line of the segment in the expanded source (1-based)
+        uint32_t fileIndex;
+        uint32_t fileLine; // Corresponding line in the file
+    };
+
+    std::vector<std::filesystem::path> files; // The stage file followed by the files it includes.
+    std::vector<Segment> segments; // Sorted by line; a segment continues until the next one starts.
+};
+
+// A program whose compilation and linking has been started but whose result has not been queried yet.
+// With GL_KHR_parallel_shader_compile the driver compiles on its own threads and isReady() never blocks; without it
+// isReady() always returns true and finish() waits for the compiler.
+class PendingShader {
+public:
+    PendingShader(const PendingShader&) = delete;
+    PendingShader(PendingShader&&);
+    ~PendingShader();
+
+    PendingShader& operator=(const PendingShader&) = delete;
+    PendingShader& operator=(PendingShader&&);
+
+    [[nodiscard]] bool isReady() const;
+    // Wait for the program and check it for errors; throws ShaderLoadingException on failure.
+    // The PendingShader is empty afterwards.
+    Shader finish();
+
+private:
+    friend class ShaderBuilder;
+    PendingShader() = default;
+
+private:
+    GLuint m_program { 0 };
+    std::vector<GLuint> m_shaders;
+    std::vector<ShaderSourceMap> m_sourceMaps; // Per stage, in the same order as m_shaders
+    std::filesystem::path m_binaryCacheFile; // Empty if the program was loaded from the cache or caching is disabled.
 };
 
 class ShaderBuilder {
@@ -50,14 +119,40 @@ public:
     ShaderBuilder() = default;
     ShaderBuilder(const ShaderBuilder&) = delete;
     ShaderBuilder(ShaderBuilder&&) = default;
-    ~ShaderBuilder();
+    ~ShaderBuilder() = default;
 
+    // Shader files may include other files with #include "file" (relative to the including file). Every file is
+    // included at most once per stage. Compile errors refer to the file and line that contain them.
     ShaderBuilder& addStage(GLuint shaderStage, std::filesystem::path shaderFile);
+    // Add "#define name value" to all stages, directly after their #version directive.
+    // Defines affect every stage added before or after this call.
+    ShaderBuilder& addDefine(std::string name, std::string value = "");
     Shader build();
+    // Start compiling without waiting for the driver; see PendingShader.
+    PendingShader buildAsync();
+
+    // All files that the program is built from, including the (transitively) included files.
+    // The program must be rebuilt when any of them changes.
+    [[nodiscard]] std::vector<std::filesystem::path> dependencies() const;
+
+    // Directory in which linked program binaries are cached (glGetProgramBinary). Subsequent launches load the binary
+    // instead of compiling from source as long as the sources and the driver did not change. Disabled when empty.
+    static void setBinaryCacheDirectory(std::filesystem::path directory);
+    // Check all programs that are built from now on against this layout; see UniformBlockLayout.
+    static void registerUniformBlockLayout(UniformBlockLayout layout);
 
 private:
-    void freeShaders();
+    struct Stage {
+        GLuint stage;
+        std::string source; // With all includes expanded.
+        ShaderSourceMap sourceMap;
+    };
+
+    [[nodiscard]] std::string preprocessedSource(const Stage& stage) const;
+    [[nodiscard]] uint64_t computeProgramHash() const;
+    void compileAndLink(PendingShader& pendingShader) const;
 
 private:
-    std::vector<GLuint> m_shaders;
+    std::vector<Stage> m_stages;
+    std::vector<std::pair<std::string, std::string>> m_defines;
 };
@@ -0,0 +1,52 @@
+#pragma once
+#include "file_watcher.h"
+#include "shader.h"
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Rebuilds shaders when one of their source files (or included files) changes on disk.
+//
+// Rebuilds are started with ShaderBuilder::buildAsync() and are only picked up by update() once the driver has finished
+// compiling them, so the render loop does not wait for the compiler. A successfully rebuilt program is move-assigned
+// into the registered Shader object; if it fails to compile the old program is kept and the log is available through
+// errors() until the next successful rebuild.
+class ShaderReloader {
+public:
+    // Describes how to build a shader; it is invoked again for every rebuild so that the sources are read from disk.
+    using BuilderFactory = std::function<ShaderBuilder()>;
+
+    struct Error {
+        std::filesystem::path file; // The first stage of the failed program.
+        std::string log;
+    };
+
+    // The Shader object must stay at the same address until it is removed (or the reloader is destroyed).
+    void add(Shader& shader, BuilderFactory makeBuilder);
+    void remove(const Shader& shader);
+
+    // Check for modified files and swap in programs that have finished compiling. Call once per frame.
+    void update();
+
+    [[nodiscard]] std::vector<Error> errors() const;
+    [[nodiscard]] size_t numReloads() const;
+
+private:
+    struct Entry {
+        Shader* pShader;
+        BuilderFactory makeBuilder;
+        std::vector<std::filesystem::path> dependencies; // Canonical paths
+        std::optional<PendingShader> pendingShader;
+        std::optional<Error> error;
+        bool outdated { false }; // Changed again while a rebuild was in flight.
+    };
+
+    void startRebuild(Entry& entry);
+
+private:
+    FileWatcher m_fileWatcher;
+    std::vector<Entry> m_entries;
+    size_t m_numReloads { 0 };
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include "opengl_includes.h"
+#include "shader.h"
+#include "shader_reloader.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Specializations (permutations) of a single shader program, selected by a bitmask of features.
+// Bit i of the mask adds "#define featureDefines[i]" to every stage, so shaders can use #ifdef instead of branching
+// on uniforms. Variants are compiled on first use, or ahead of time in the background with prefetch().
+class ShaderVariants {
+public:
+    using Stage = std::pair<GLuint, std::filesystem::path>;
+
+    ShaderVariants() = default;
+    ShaderVariants(std::vector<Stage> stages, std::vector<std::string> featureDefines);
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants(ShaderVariants&&);
+    ~ShaderVariants();
+
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(ShaderVariants&&);
+
+    // Register all compiled variants, and any variant compiled later on, for hot reloading.
+    // The reloader must outlive this object.
+    void setReloader(ShaderReloader* pReloader);
+
+    // Start compiling a variant without waiting for it (asynchronous with GL_KHR_parallel_shader_compile).
+    void prefetch(uint32_t features);
+    // Return the variant, compiling it first if necessary. Throws ShaderLoadingException if it fails to compile.
+    const Shader& get(uint32_t features);
+    // Return the variant if it has finished compiling and nullptr otherwise; never waits for the compiler.
+    // Starts compiling the variant if that did not happen yet. Variants that fail to compile are reported once.
+    const Shader* tryGet(uint32_t features);
+
+    [[nodiscard]] size_t numCompiledVariants() const;
+    [[nodiscard]] size_t numPendingVariants() const;
+
+private:
+    static ShaderBuilder makeBuilder(const std::vector<Stage>& stages, const std::vector<std::string>& featureDefines, uint32_t features);
+    const Shader& finish(uint32_t features, PendingShader& pendingShader);
+    void addToReloader(uint32_t features, Shader& shader);
+    void removeFromReloader();
+
+private:
+    std::vector<Stage> m_stages;
+    std::vector<std::string> m_featureDefines;
+
+    // Node based containers; references to compiled variants stay valid when other variants are added.
+    std::unordered_map<uint32_t, Shader> m_variants;
+    std::unordered_map<uint32_t, PendingShader> m_pendingVariants;
+    std::unordered_set<uint32_t> m_failedVariants;
+
+    ShaderReloader* m_pReloader { nullptr };
+};
@@ -16,6 +16,8 @@ public:
     // NOTE(Mathijs): field of view in radians! (use glm::radians(...) to convert from degrees to radians).
     Trackball(Window* pWindow, float fovy, float distanceFromLookAt = 4.0f, float rotationX = 0.0f, float rotationY = 0.0f);
     Trackball(Window* pWindow, float fovy, const glm::vec3& lookAt, float distanceFromLookAt = 4.0f, float rotationX = 0.0f, float rotationY = 0.0f);
+    // Camera without a window (e.g. for offline rendering); it does not respond to mouse input.
+    Trackball(float fovy, float aspectRatio, const glm::vec3& lookAt, float distanceFromLookAt = 4.0f, float rotationX = 0.0f, float rotationY = 0.0f);
     ~Trackball() = default;
 
     static void printHelp();
@@ -45,7 +47,7 @@ private:
     void mouseScrollCallback(const glm::vec2& offset);
 
 private:
-    const Window* m_pWindow;
+    const Window* m_pWindow; // nullptr if the camera is not controlled by a window.
     float m_fovy;
     float m_halfScreenSpaceHeight;
     float m_halfScreenSpaceWidth;
@@ -1,17 +1,26 @@
 #pragma once
+#include "async_readback.h"
 #include "disable_all_warnings.h"
+#include "image_writer.h"
 #include "opengl_includes.h"
 // Suppress warnings in third-party code.
 DISABLE_WARNINGS_PUSH()
 #include <GLFW/glfw3.h>
 #include <glm/vec2.hpp>
 DISABLE_WARNINGS_POP()
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string_view>
 #include <vector>
 #include <filesystem>
 
+struct ImDrawData;
+
 enum class OpenGLVersion {
 	GL2,
 	GL3,
@@ -19,20 +28,53 @@ enum class OpenGLVersion {
 	GL45
 };
 
+enum class VsyncMode {
+	Off,
+	On,
+	// Sync when the frame is on time, tear instead of waiting a whole refresh when it is late. Falls back to On when
+	// the driver does not support EXT_swap_control_tear.
+	Adaptive
+};
+
 class Window {
 public:
+	// A window that is not presentable is headless: on Linux it uses a surfaceless EGL context (e.g. Mesa llvmpipe),
+	// so it needs neither a display server nor a GPU; elsewhere it falls back to a hidden GLFW window. Headless
+	// windows render into a framebuffer object of windowSize (see getFramebuffer()), have no input and no ImGui.
 	Window(std::string_view title, const glm::ivec2& windowSize, OpenGLVersion glVersion, bool presentable=true, bool visible=true);
 	~Window();
 
+	// Use instead of glfwGetProcAddress() to load OpenGL extension functions; also works for headless contexts.
+	static GLFWglproc getProcAddress(const char* name);
+
 	void close(); // Set shouldClose() to true.
 	[[nodiscard]] bool shouldClose(); // Whether window should close (close() was called or user clicked the close button).
 
+	// The OpenGL context is current on the thread that created the window. To render on another thread (see
+	// RenderThread), release it here and make it current there; it can only be current on one thread at a time.
+	void makeContextCurrent();
+	void releaseContext();
+
+	// Poll events, dispatch them to the registered callbacks and start the ImGui frame; does not use the OpenGL context.
 	void updateInput();
-	void swapBuffers(); // Swap the front/back buffer
+	void swapBuffers(); // Render the ImGui frame and swap the front/back buffer.
+	// The two halves of swapBuffers(), for when the ImGui frame is built on another thread than the one that renders.
+	void renderImGui(ImDrawData* pDrawData);
+	void present(); // Also starts a new frame of the FrameAllocator.
+	void setVsync(bool enabled); // Vsync is enabled by default.
+	// Takes effect at the next present(), so it may be called from any thread.
+	void setVsyncMode(VsyncMode mode);
+	[[nodiscard]] VsyncMode getVsyncMode() const;
 
 
-	void renderToImage(const std::filesystem::path& filePath, const bool flipY = false); // renders the output to an image
+	// Saves the contents of getFramebuffer() to a .png/.bmp/.qoi file. The pixels are read back asynchronously and
+	// encoded on a worker thread, so the file appears a few frames later.
+	void renderToImage(const std::filesystem::path& filePath, const bool flipY = false);
+	void waitForImageWrites(); // Block until all renderToImage() files have been written.
 
+	// Events are collected while GLFW polls and dispatched together at the end of updateInput(). Consecutive mouse
+	// moves and window resizes are coalesced into the last one and consecutive scrolls into their sum, so callbacks run
+	// once per frame for continuous input while their order relative to key and button events is kept.
 	using KeyCallback = std::function<void(int key, int scancode, int action, int mods)>;
 	void registerKeyCallback(KeyCallback&&);
 	using CharCallback = std::function<void(unsigned unicodeCodePoint)>;
@@ -46,6 +88,17 @@ public:
 	using WindowResizeCallback = std::function<void(const glm::ivec2& size)>;
 	void registerWindowResizeCallback(WindowResizeCallback&&);
 
+	// Input of the last updateInput(), for code that polls once per frame instead of registering callbacks. Like the
+	// callbacks it excludes input that ImGui captured.
+	struct InputState {
+		glm::vec2 cursorPos { 0.0f }; // Same coordinates as getCursorPos().
+		glm::vec2 cursorDelta { 0.0f }; // Sum of all cursor movements.
+		glm::vec2 scrollDelta { 0.0f };
+		uint32_t numEvents { 0 }; // Received from GLFW.
+		uint32_t numDispatchedEvents { 0 }; // After coalescing.
+	};
+	[[nodiscard]] const InputState& getInputState() const;
+
 	bool isKeyPressed(int key) const;
 	bool isMouseButtonPressed(int button) const;
 
@@ -55,13 +108,33 @@ public:
 	glm::vec2 getCursorPixel() const;
 
 	// Hides mouse and prevents it from going out of the window.
-	// Useful for a first person camera.
+	// Useful for a first person camera. While captured, GLFW reports raw (unaccelerated and unscaled) mouse motion
+	// when the platform supports it.
 	void setMouseCapture(bool capture);
+	[[nodiscard]] bool isMouseCaptured() const;
+	[[nodiscard]] bool usesRawMouseMotion() const;
+
+	// Relative mouse motion for camera control: the sum of all cursor events since the last call, including the moves
+	// that were coalesced for the callbacks. Motion over ImGui only counts while the mouse is captured.
+	struct MouseMotion {
+		glm::vec2 delta { 0.0f }; // Positive is right/up.
+		uint32_t numSamples { 0 };
+		// When GLFW delivered the first and the last event; events are only processed while polling.
+		std::chrono::steady_clock::time_point firstSampleTime;
+		std::chrono::steady_clock::time_point lastSampleTime;
+	};
+	[[nodiscard]] MouseMotion consumeMouseMotion();
+	// Process the events that arrived since updateInput() without dispatching them yet (the next updateInput() does),
+	// so that consumeMouseMotion() and isKeyPressed() right before rendering include input from during the frame.
+	void sampleInput();
 
 	[[nodiscard]] glm::ivec2 getWindowSize() const;
 	[[nodiscard]] glm::ivec2 getFrameBufferSize() const;
 	[[nodiscard]] float getAspectRatio() const;
 	[[nodiscard]] float getDpiScalingFactor() const;
+	[[nodiscard]] bool isHeadless() const;
+	// Framebuffer that stands in for the back buffer: 0, or an offscreen framebuffer object for headless windows.
+	[[nodiscard]] GLuint getFramebuffer() const;
 
 private:
 	static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -71,12 +144,60 @@ private:
 	static void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 	static void windowSizeCallback(GLFWwindow* window, int width, int height);
 
+	struct InputEvent {
+		enum class Type { Key, Char, MouseButton, MouseMove, Scroll, WindowResize };
+		Type type;
+		int key { 0 }; // Key, mouse button or unicode code point.
+		int scancode { 0 };
+		int action { 0 };
+		int mods { 0 };
+		glm::vec2 value { 0.0f }; // Cursor position, scroll offset or window size.
+	};
+	void queueEvent(const InputEvent& event);
+	void dispatchEvents();
+	void dispatchEvent(const InputEvent& event);
+
+	bool createHeadlessContext();
+	void createHeadlessFramebuffer();
+
 private:
-	GLFWwindow* m_pWindow;
+	GLFWwindow* m_pWindow { nullptr }; // Null for headless EGL windows.
 	glm::ivec2 m_windowSize;
 	float m_dpiScalingFactor = 1.0f;
 	const OpenGLVersion m_glVersion;
         bool m_presentable;
+	bool m_shouldClose { false }; // Only used without a GLFW window.
+	std::atomic<VsyncMode> m_vsyncMode { VsyncMode::On };
+	int m_swapInterval { 1 }; // Applied by present() on the thread that owns the context.
+	bool m_adaptiveVsyncSupported { false };
+
+	// Surfaceless EGL context (EGLDisplay/EGLContext) of headless windows, when supported.
+	void* m_eglDisplay { nullptr };
+	void* m_eglContext { nullptr };
+	GLuint m_headlessFramebuffer { 0 };
+	GLuint m_headlessRenderbuffers[2] { 0, 0 }; // Color and depth/stencil.
+
+	// Created on the first call to renderToImage().
+	std::unique_ptr<AsyncReadback> m_pReadback;
+	std::unique_ptr<ImageWriter> m_pImageWriter;
+
+	// GLFW calls the callbacks that fill the queue from glfwPollEvents() on the main thread, which is also the thread that
+	// dispatches, so the queue needs no synchronization. It is dispatched early when it fills up. Double buffered so
+	// that callbacks can queue events while the other queue is being dispatched; m_dispatching keeps nested calls to
+	// dispatchEvents() from swapping back to the queue that is being read. If the queue fills up during dispatch, later
+	// events are appended to m_spilledEvents, which dispatchEvents() drains after the queue to keep them in order.
+	static constexpr size_t maxQueuedEvents = 256;
+	std::array<std::array<InputEvent, maxQueuedEvents>, 2> m_eventQueues;
+	uint32_t m_currentEventQueue { 0 };
+	size_t m_numQueuedEvents { 0 };
+	std::vector<InputEvent> m_spilledEvents;
+	bool m_dispatching { false };
+	InputState m_inputState;
+	InputState m_pendingInputState; // Filled by the callbacks.
+	glm::vec2 m_lastCursorPos { 0.0f };
+	MouseMotion m_mouseMotion;
+	bool m_mouseCaptured { false };
+	bool m_rawMouseMotion { false };
 
 	std::vector<KeyCallback> m_keyCallbacks;
 	std::vector<CharCallback> m_charCallbacks;
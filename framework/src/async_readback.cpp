@@ -0,0 +1,97 @@
+#include "async_readback.h"
+#include "profiler.h"
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+AsyncReadback::AsyncReadback(uint32_t numBuffers)
+    : m_slots(numBuffers)
+{
+    assert(numBuffers > 0);
+    for (Slot& slot : m_slots)
+        glGenBuffers(1, &slot.buffer);
+}
+
+AsyncReadback::~AsyncReadback()
+{
+    finish();
+    for (Slot& slot : m_slots)
+        glDeleteBuffers(1, &slot.buffer);
+}
+
+void AsyncReadback::capture(const glm::ivec2& offset, const glm::ivec2& size, Callback&& callback)
+{
+    PROFILE_FUNCTION();
+    Slot& slot = m_slots[(m_oldest + m_numPending) % m_slots.size()];
+    // All buffers are in flight: the oldest capture has to complete first (this is the only place that may stall).
+    if (slot.fence) {
+        assert(&slot == &m_slots[m_oldest]);
+        complete(slot, true);
+    }
+
+    const size_t numBytes = size_t(size.x) * size_t(size.y) * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (numBytes > slot.capacity) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(numBytes), nullptr, GL_STREAM_READ);
+        slot.capacity = numBytes;
+        slot.memory = TrackedMemory(MemoryCategory::GpuBuffer, "readback buffers", numBytes);
+    }
+    // With a pack buffer bound the pointer argument is an offset into the buffer; the call returns immediately.
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(offset.x, offset.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.size = size;
+    slot.callback = std::move(callback);
+    ++m_numPending;
+}
+
+void AsyncReadback::poll()
+{
+    // Captures complete in order, so stop at the first one that is not done yet.
+    while (m_numPending > 0) {
+        Slot& slot = m_slots[m_oldest];
+        if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            break;
+        complete(slot, false);
+    }
+}
+
+void AsyncReadback::finish()
+{
+    while (m_numPending > 0)
+        complete(m_slots[m_oldest], true);
+}
+
+uint32_t AsyncReadback::numPending() const
+{
+    return m_numPending;
+}
+
+void AsyncReadback::complete(Slot& slot, bool wait)
+{
+    PROFILE_FUNCTION();
+    if (wait) {
+        // Flush on the first wait so that the fence is guaranteed to signal eventually.
+        GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (glClientWaitSync(slot.fence, waitFlags, 1'000'000) == GL_TIMEOUT_EXPIRED)
+            waitFlags = 0;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    CapturedImage image { .size = slot.size, .pixels = std::vector<uint8_t>(size_t(slot.size.x) * size_t(slot.size.y) * 4) };
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(image.pixels.size()), GL_MAP_READ_BIT)) {
+        std::memcpy(image.pixels.data(), pMapped, image.pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_oldest = (m_oldest + 1) % static_cast<uint32_t>(m_slots.size());
+    --m_numPending;
+    // Moved out first: the callback may start a new capture that reuses this slot.
+    Callback callback = std::move(slot.callback);
+    callback(std::move(image));
+}
@@ -0,0 +1,111 @@
+#include "file_watcher.h"
+#include <algorithm>
+#include <array>
+#include <system_error>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static std::filesystem::file_time_type modificationTime(const std::filesystem::path& file)
+{
+    // Files may briefly disappear while an editor replaces them; they are then reported on the next check.
+    std::error_code errorCode;
+    const auto time = std::filesystem::last_write_time(file, errorCode);
+    return errorCode ? std::filesystem::file_time_type::min() : time;
+}
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (m_inotifyFd != -1)
+        close(m_inotifyFd);
+#endif
+}
+
+void FileWatcher::addFile(const std::filesystem::path& file)
+{
+    const std::filesystem::path canonicalFile = std::filesystem::weakly_canonical(file);
+    if (m_files.contains(canonicalFile))
+        return;
+    m_files[canonicalFile] = modificationTime(canonicalFile);
+
+#ifdef __linux__
+    if (m_inotifyFd == -1)
+        return;
+    const std::filesystem::path directory = canonicalFile.parent_path();
+    const int watchDescriptor = inotify_add_watch(m_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watchDescriptor == -1) {
+        // E.g. out of watches (fs.inotify.max_user_watches); switch to polling for all files.
+        close(m_inotifyFd);
+        m_inotifyFd = -1;
+        m_watchedDirectories.clear();
+        return;
+    }
+    // Watching the same directory twice returns the same descriptor.
+    m_watchedDirectories[watchDescriptor] = directory;
+#endif
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll()
+{
+    return usesNotifications() ? readNotifications() : pollModificationTimes();
+}
+
+bool FileWatcher::usesNotifications() const
+{
+    return m_inotifyFd != -1;
+}
+
+std::vector<std::filesystem::path> FileWatcher::pollModificationTimes()
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_lastPoll < pollInterval)
+        return {};
+    m_lastPoll = now;
+
+    std::vector<std::filesystem::path> changedFiles;
+    for (auto& [file, lastModificationTime] : m_files) {
+        if (const auto time = modificationTime(file); time != lastModificationTime) {
+            lastModificationTime = time;
+            changedFiles.push_back(file);
+        }
+    }
+    return changedFiles;
+}
+
+std::vector<std::filesystem::path> FileWatcher::readNotifications()
+{
+    std::vector<std::filesystem::path> changedFiles;
+#ifdef __linux__
+    alignas(inotify_event) std::array<char, 4096> buffer;
+    while (true) {
+        const ssize_t length = read(m_inotifyFd, buffer.data(), buffer.size());
+        if (length <= 0)
+            break; // EAGAIN: no more events.
+
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* pEvent = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + pEvent->len);
+            if (pEvent->len == 0)
+                continue;
+
+            auto directoryIter = m_watchedDirectories.find(pEvent->wd);
+            if (directoryIter == std::end(m_watchedDirectories))
+                continue;
+            // Other files in the same directory are reported as well; only keep the ones that were asked for.
+            const std::filesystem::path file = directoryIter->second / pEvent->name;
+            if (m_files.contains(file) && std::find(std::begin(changedFiles), std::end(changedFiles), file) == std::end(changedFiles))
+                changedFiles.push_back(file);
+        }
+    }
+#endif
+    return changedFiles;
+}
@@ -0,0 +1,174 @@
+#include "frame_allocator.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <imgui/imgui.h>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cassert>
+
+namespace {
+class FrameMemoryResource final : public std::pmr::memory_resource {
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        return FrameAllocator::get().allocate(bytes, alignment);
+    }
+    void do_deallocate(void*, size_t, size_t) override { }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+}
+
+FrameAllocator& FrameAllocator::get()
+{
+    static FrameAllocator allocator;
+    return allocator;
+}
+
+std::pmr::memory_resource* FrameAllocator::resource()
+{
+    static FrameMemoryResource resource;
+    return &resource;
+}
+
+FrameAllocator::ThreadArenaHandle::~ThreadArenaHandle()
+{
+    // The memory stays where it is: a new owner only recycles a buffer once the frame it was used in is over.
+    if (pArena)
+        pArena->inUse.store(false, std::memory_order_release);
+}
+
+FrameAllocator::ThreadArena& FrameAllocator::threadArena()
+{
+    thread_local ThreadArenaHandle handle;
+    if (handle.pArena)
+        return *handle.pArena;
+
+    std::lock_guard lock { m_mutex };
+    for (const auto& pArena : m_arenas) {
+        if (!pArena->inUse.load(std::memory_order_acquire)) {
+            pArena->inUse.store(true, std::memory_order_relaxed);
+            handle.pArena = pArena.get();
+            return *handle.pArena;
+        }
+    }
+    handle.pArena = m_arenas.emplace_back(std::make_unique<ThreadArena>()).get();
+    return *handle.pArena;
+}
+
+void* FrameAllocator::allocate(size_t bytes, size_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    ThreadArena& arena = threadArena();
+
+    const uint64_t frameIndex = m_frameIndex.load(std::memory_order_relaxed);
+    if (arena.buffers[arena.currentBuffer].frameIndex.load(std::memory_order_relaxed) != frameIndex) {
+        // The other buffer was last used two or more frames ago.
+        arena.currentBuffer ^= 1;
+        recycle(arena, arena.buffers[arena.currentBuffer]);
+        arena.buffers[arena.currentBuffer].frameIndex.store(frameIndex, std::memory_order_relaxed);
+    }
+    Buffer& buffer = arena.buffers[arena.currentBuffer];
+
+    const auto tryAllocate = [&]() -> void* {
+        if (buffer.blocks.empty())
+            return nullptr;
+        const Block& block = buffer.blocks.back();
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(block.pMemory.get());
+        const uintptr_t address = (begin + buffer.offset + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (address + bytes > begin + block.size)
+            return nullptr;
+        buffer.offset = address + bytes - begin;
+        return reinterpret_cast<void*>(address);
+    };
+    void* pMemory = tryAllocate();
+    if (!pMemory) {
+        addBlock(arena, buffer, bytes + alignment);
+        pMemory = tryAllocate();
+        assert(pMemory);
+    }
+
+    // Only the owning thread writes these, so no read-modify-write is needed.
+    buffer.numBytes.store(buffer.numBytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    buffer.numAllocations.store(buffer.numAllocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return pMemory;
+}
+
+void FrameAllocator::recycle(ThreadArena& arena, Buffer& buffer)
+{
+    if (buffer.blocks.size() > 1) {
+        size_t totalSize = 0;
+        for (const Block& block : buffer.blocks)
+            totalSize += block.size;
+        buffer.blocks.clear();
+        arena.reservedBytes.store(arena.reservedBytes.load(std::memory_order_relaxed) - totalSize, std::memory_order_relaxed);
+        addBlock(arena, buffer, totalSize);
+    }
+    buffer.offset = 0;
+    buffer.numBytes.store(0, std::memory_order_relaxed);
+    buffer.numAllocations.store(0, std::memory_order_relaxed);
+}
+
+void FrameAllocator::addBlock(ThreadArena& arena, Buffer& buffer, size_t minSize)
+{
+    const size_t size = std::max(blockSize, minSize);
+    buffer.blocks.push_back({ std::unique_ptr<std::byte[]>(new std::byte[size]), size });
+    buffer.offset = 0;
+    arena.reservedBytes.store(arena.reservedBytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+    m_numHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameAllocator::nextFrame()
+{
+    std::lock_guard lock { m_mutex };
+    const uint64_t frameIndex = m_frameIndex.load(std::memory_order_relaxed);
+
+    // Threads that are still allocating (e.g. the main thread while the render thread presents) are counted as far as
+    // they got; the rest of their allocations end up in the next frame.
+    size_t numBytes = 0;
+    uint64_t numAllocations = 0;
+    for (const auto& pArena : m_arenas) {
+        for (const Buffer& buffer : pArena->buffers) {
+            if (buffer.frameIndex.load(std::memory_order_relaxed) == frameIndex) {
+                numBytes += buffer.numBytes.load(std::memory_order_relaxed);
+                numAllocations += buffer.numAllocations.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    m_lastFrameBytes = numBytes;
+    m_peakFrameBytes = std::max(m_peakFrameBytes, numBytes);
+    m_lastFrameNumAllocations = numAllocations;
+
+    m_frameIndex.store(frameIndex + 1, std::memory_order_relaxed);
+}
+
+FrameAllocatorStats FrameAllocator::stats() const
+{
+    std::lock_guard lock { m_mutex };
+    FrameAllocatorStats stats {
+        .lastFrameBytes = m_lastFrameBytes,
+        .peakFrameBytes = m_peakFrameBytes,
+        .lastFrameNumAllocations = m_lastFrameNumAllocations,
+        .numHeapAllocations = m_numHeapAllocations.load(std::memory_order_relaxed),
+        .numThreads = 0
+    };
+    for (const auto& pArena : m_arenas) {
+        stats.reservedBytes += pArena->reservedBytes.load(std::memory_order_relaxed);
+        if (pArena->inUse.load(std::memory_order_relaxed))
+            ++stats.numThreads;
+    }
+    return stats;
+}
+
+void FrameAllocator::drawImGui()
+{
+    const FrameAllocatorStats frameStats = stats();
+    ImGui::Begin("Frame allocator");
+    ImGui::Text("Last frame: %.1f KiB in %llu allocations", double(frameStats.lastFrameBytes) / 1024.0, static_cast<unsigned long long>(frameStats.lastFrameNumAllocations));
+    ImGui::Text("Peak frame: %.1f KiB", double(frameStats.peakFrameBytes) / 1024.0);
+    ImGui::Text("Reserved: %.1f KiB by %u threads", double(frameStats.reservedBytes) / 1024.0, frameStats.numThreads);
+    ImGui::Text("Heap allocations: %llu", static_cast<unsigned long long>(frameStats.numHeapAllocations));
+    ImGui::End();
+}
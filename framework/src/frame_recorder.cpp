@@ -0,0 +1,195 @@
+#include "frame_recorder.h"
+#include "profiler.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+static constexpr const char* nullDevice = "NUL";
+static constexpr const char* pipeMode = "wb";
+#else
+static constexpr const char* nullDevice = "/dev/null";
+static constexpr const char* pipeMode = "w";
+#endif
+
+static bool isVideoFile(const std::filesystem::path& filePath)
+{
+    static constexpr std::array videoExtensions { ".mp4", ".mkv", ".mov", ".webm" };
+    const std::string extension = filePath.extension().string();
+    return std::find(std::begin(videoExtensions), std::end(videoExtensions), extension) != std::end(videoExtensions);
+}
+
+// Quote a path so that the shell passes it to the command as a single argument, whatever characters it contains.
+static std::string quoteShellArgument(const std::filesystem::path& filePath)
+{
+    const std::string argument = filePath.string();
+#ifdef _WIN32
+    // Windows file names can not contain double quotes.
+    return fmt::format("\"{}\"", argument);
+#else
+    // Nothing is special within single quotes; a single quote itself is written as '\'' (close, escaped quote, reopen).
+    std::string quoted = "'";
+    for (const char c : argument) {
+        if (c == '\'')
+            quoted += "'\\''";
+        else
+            quoted += c;
+    }
+    quoted += '\'';
+    return quoted;
+#endif
+}
+
+FrameRecorder::FrameRecorder(const std::filesystem::path& outputPath, const glm::ivec2& size, uint32_t frameRate, ImageFormat imageFormat, size_t maxQueuedBytes)
+    : m_size(size)
+    , m_outputPath(outputPath)
+    , m_imageFormat(imageFormat)
+    , m_maxQueuedBytes(maxQueuedBytes)
+{
+    if (isVideoFile(outputPath)) {
+        if (isFfmpegAvailable()) {
+            // OpenGL stores the bottom row first; let ffmpeg flip the frames instead of doing it on the CPU.
+            const std::string command = fmt::format(
+                "ffmpeg -loglevel error -y -f rawvideo -pix_fmt rgba -s {}x{} -framerate {} -i - -vf vflip -pix_fmt yuv420p {}",
+                size.x, size.y, frameRate, quoteShellArgument(outputPath));
+#ifndef _WIN32
+            // Report a crashed ffmpeg through fwrite() instead of terminating the application.
+            std::signal(SIGPIPE, SIG_IGN);
+#endif
+            m_pPipe = popen(command.c_str(), pipeMode);
+            if (!m_pPipe)
+                throw std::runtime_error(fmt::format("Could not start ffmpeg to record {}", outputPath.string()));
+            m_pipeThread = std::thread([this]() { pipeLoop(); });
+            return;
+        }
+        m_outputPath.replace_extension();
+        std::cerr << "ffmpeg was not found, recording images to " << m_outputPath << " instead" << std::endl;
+    }
+
+    std::filesystem::create_directories(m_outputPath);
+    const uint32_t numThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    m_pImageWriter = std::make_unique<ImageWriter>(numThreads, maxQueuedBytes);
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    finish();
+}
+
+void FrameRecorder::captureFrame()
+{
+    assert(!m_finished);
+    // Waits for the oldest readback when all buffers are in flight; that frame is then submitted to the encoders.
+    const auto start = std::chrono::steady_clock::now();
+    m_readback.capture(glm::ivec2(0), m_size, [this](CapturedImage&& image) { submit(std::move(image)); });
+    m_backpressureMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++m_numFramesCaptured;
+}
+
+void FrameRecorder::poll()
+{
+    const auto start = std::chrono::steady_clock::now();
+    m_readback.poll();
+    m_backpressureMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrameRecorder::finish()
+{
+    if (m_finished)
+        return;
+    m_finished = true;
+
+    m_readback.finish();
+    if (m_pImageWriter) {
+        m_pImageWriter->waitIdle();
+        if (const size_t numFailed = m_pImageWriter->numFailed(); numFailed > 0)
+            std::cerr << numFailed << " recorded frames could not be written to " << m_outputPath << std::endl;
+        return;
+    }
+
+    {
+        std::scoped_lock lock { m_pipeMutex };
+        m_pipeStop = true;
+    }
+    m_pipeFrameAvailable.notify_one();
+    m_pipeThread.join();
+    if (pclose(m_pPipe) != 0 || m_pipeFailed)
+        std::cerr << "ffmpeg failed to record " << m_outputPath << std::endl;
+    m_pPipe = nullptr;
+}
+
+bool FrameRecorder::isRecordingVideo() const
+{
+    return !m_pImageWriter;
+}
+
+uint32_t FrameRecorder::numFramesCaptured() const
+{
+    return m_numFramesCaptured;
+}
+
+float FrameRecorder::backpressureMs() const
+{
+    return m_backpressureMs;
+}
+
+bool FrameRecorder::isFfmpegAvailable()
+{
+    const std::string command = fmt::format("ffmpeg -version > {} 2>&1", nullDevice);
+    return std::system(command.c_str()) == 0;
+}
+
+void FrameRecorder::submit(CapturedImage&& image)
+{
+    PROFILE_FUNCTION();
+    // Readbacks complete in capture order, so the frame number follows from the number of submitted frames.
+    const uint32_t frame = m_numFramesSubmitted++;
+    if (m_pImageWriter) {
+        const char* extension = m_imageFormat == ImageFormat::Qoi ? "qoi" : "png";
+        m_pImageWriter->write(m_outputPath / fmt::format("frame_{:05}.{}", frame, extension), image.size, std::move(image.pixels), true);
+        return;
+    }
+
+    const size_t numBytes = image.pixels.size();
+    {
+        std::unique_lock lock { m_pipeMutex };
+        m_pipeFrameWritten.wait(lock, [&]() { return m_pipeFrames.empty() || m_pipeQueuedBytes + numBytes <= m_maxQueuedBytes; });
+        m_pipeFrames.push_back(std::move(image.pixels));
+        m_pipeQueuedBytes += numBytes;
+    }
+    m_pipeFrameAvailable.notify_one();
+}
+
+void FrameRecorder::pipeLoop()
+{
+    std::unique_lock lock { m_pipeMutex };
+    while (true) {
+        m_pipeFrameAvailable.wait(lock, [&]() { return m_pipeStop || !m_pipeFrames.empty(); });
+        if (m_pipeFrames.empty())
+            return;
+
+        std::vector<uint8_t> pixels = std::move(m_pipeFrames.front());
+        m_pipeFrames.pop_front();
+        lock.unlock();
+
+        // Keep draining the queue after an error so that submit() never blocks forever.
+        const bool success = !m_pipeFailed && std::fwrite(pixels.data(), 1, pixels.size(), m_pPipe) == pixels.size();
+
+        lock.lock();
+        m_pipeFailed = !success;
+        m_pipeQueuedBytes -= pixels.size();
+        m_pipeFrameWritten.notify_all();
+    }
+}
@@ -0,0 +1,165 @@
+#include "frame_scheduler.h"
+#include "profiler.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <imgui/imgui.h>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+FrameScheduler::FrameScheduler(Window* pWindow, double fixedTimestep)
+    : m_pWindow(pWindow)
+    , m_fixedTimestep(fixedTimestep)
+{
+    assert(fixedTimestep > 0.0);
+}
+
+uint32_t FrameScheduler::beginFrame()
+{
+    PROFILE_FUNCTION();
+    if (m_firstFrame) {
+        // Nothing to simulate yet; the first step happens once a full timestep has passed.
+        m_firstFrame = false;
+        m_frameStart = Clock::now();
+        return 0;
+    }
+
+    waitForFrameRateLimit();
+    const Clock::time_point now = Clock::now();
+    const double frameTime = std::chrono::duration<double>(now - m_frameStart).count();
+    m_frameStart = now;
+    m_frameTimesMs[m_numFrames++ % numHistoryFrames] = float(frameTime * 1000.0);
+
+    // Clamped so that breakpoints and window dragging do not make the simulation jump ahead.
+    m_deltaTime = std::min(frameTime, 0.25);
+    m_accumulator += m_deltaTime;
+    uint32_t numSteps = 0;
+    while (m_accumulator >= m_fixedTimestep && numSteps < maxStepsPerFrame) {
+        m_accumulator -= m_fixedTimestep;
+        ++numSteps;
+    }
+    if (numSteps == maxStepsPerFrame)
+        m_accumulator = std::min(m_accumulator, m_fixedTimestep);
+    m_simulationTime += numSteps * m_fixedTimestep;
+    return numSteps;
+}
+
+void FrameScheduler::waitForFrameRateLimit()
+{
+    if (m_frameRateLimit <= 0.0)
+        return;
+
+    PROFILE_FUNCTION();
+    const Clock::time_point deadline = m_frameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_frameRateLimit));
+    const Clock::time_point sleepUntil = deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_spinThreshold));
+    if (Clock::now() < sleepUntil)
+        std::this_thread::sleep_until(sleepUntil);
+    while (Clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+double FrameScheduler::deltaTime() const
+{
+    return m_deltaTime;
+}
+
+double FrameScheduler::fixedTimestep() const
+{
+    return m_fixedTimestep;
+}
+
+double FrameScheduler::simulationTime() const
+{
+    return m_simulationTime;
+}
+
+float FrameScheduler::interpolationAlpha() const
+{
+    return float(std::clamp(m_accumulator / m_fixedTimestep, 0.0, 1.0));
+}
+
+void FrameScheduler::setFixedTimestep(double seconds)
+{
+    assert(seconds > 0.0);
+    // Keep the fraction of a step that has passed, so that interpolation does not jump.
+    m_accumulator = m_accumulator / m_fixedTimestep * seconds;
+    m_fixedTimestep = seconds;
+}
+
+void FrameScheduler::setFrameRateLimit(double framesPerSecond)
+{
+    m_frameRateLimit = std::max(framesPerSecond, 0.0);
+}
+
+double FrameScheduler::frameRateLimit() const
+{
+    return m_frameRateLimit;
+}
+
+void FrameScheduler::setSpinThreshold(double seconds)
+{
+    m_spinThreshold = std::max(seconds, 0.0);
+}
+
+void FrameScheduler::setVsyncMode(VsyncMode mode)
+{
+    if (m_pWindow)
+        m_pWindow->setVsyncMode(mode);
+}
+
+FrameTimeStatistics FrameScheduler::statistics() const
+{
+    const size_t numSamples = std::min<uint64_t>(m_numFrames, numHistoryFrames);
+    if (numSamples == 0)
+        return {};
+
+    std::vector<float> frameTimesMs { std::begin(m_frameTimesMs), std::begin(m_frameTimesMs) + numSamples };
+    std::sort(std::begin(frameTimesMs), std::end(frameTimesMs));
+    FrameTimeStatistics statistics;
+    statistics.meanMs = std::accumulate(std::begin(frameTimesMs), std::end(frameTimesMs), 0.0f) / float(numSamples);
+    float variance = 0.0f;
+    for (float frameTimeMs : frameTimesMs)
+        variance += (frameTimeMs - statistics.meanMs) * (frameTimeMs - statistics.meanMs);
+    statistics.jitterMs = std::sqrt(variance / float(numSamples));
+    statistics.minMs = frameTimesMs.front();
+    statistics.maxMs = frameTimesMs.back();
+    // Nearest-rank percentile.
+    statistics.p99Ms = frameTimesMs[std::min(size_t(std::ceil(0.99 * double(numSamples))), numSamples) - 1];
+    if (m_frameRateLimit > 0.0) {
+        const float lateMs = float(1.5 * 1000.0 / m_frameRateLimit);
+        statistics.numLateFrames = uint32_t(std::count_if(std::begin(frameTimesMs), std::end(frameTimesMs), [=](float frameTimeMs) { return frameTimeMs > lateMs; }));
+    }
+    return statistics;
+}
+
+void FrameScheduler::drawImGui()
+{
+    ImGui::Begin("Frame pacing");
+
+    const char* vsyncModes[] = { "Off", "On", "Adaptive" };
+    int vsyncMode = m_pWindow ? int(m_pWindow->getVsyncMode()) : 0;
+    if (ImGui::Combo("Vsync", &vsyncMode, vsyncModes, IM_ARRAYSIZE(vsyncModes)))
+        setVsyncMode(VsyncMode(vsyncMode));
+
+    float frameRateLimit = float(m_frameRateLimit);
+    if (ImGui::SliderFloat("Frame rate limit", &frameRateLimit, 0.0f, 360.0f, frameRateLimit > 0.0f ? "%.0f fps" : "Uncapped"))
+        setFrameRateLimit(frameRateLimit);
+    float spinThresholdMs = float(m_spinThreshold * 1000.0);
+    if (ImGui::SliderFloat("Spin threshold", &spinThresholdMs, 0.0f, 5.0f, "%.1f ms"))
+        setSpinThreshold(spinThresholdMs / 1000.0);
+    int simulationRate = int(std::round(1.0 / m_fixedTimestep));
+    if (ImGui::SliderInt("Simulation rate", &simulationRate, 10, 240, "%d Hz"))
+        setFixedTimestep(1.0 / std::max(simulationRate, 1));
+
+    const FrameTimeStatistics stats = statistics();
+    ImGui::Text("Frame time: %.2f ms (%.0f fps), jitter %.2f ms", stats.meanMs, stats.meanMs > 0.0f ? 1000.0f / stats.meanMs : 0.0f, stats.jitterMs);
+    ImGui::Text("Min/p99/max: %.2f/%.2f/%.2f ms", stats.minMs, stats.p99Ms, stats.maxMs);
+    if (m_frameRateLimit > 0.0)
+        ImGui::Text("Late frames: %u of the last %u", stats.numLateFrames, numHistoryFrames);
+    ImGui::PlotLines("##FrameTimes", m_frameTimesMs.data(), int(numHistoryFrames), int(m_numFrames % numHistoryFrames), "Frame time (ms)", 0.0f, std::max(stats.maxMs, 1.0f), ImVec2(0, 80));
+    ImGui::End();
+}
@@ -0,0 +1,222 @@
+#include "gpu_profiler.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+#include <imgui/imgui.h>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+GpuProfiler& GpuProfiler::get()
+{
+    static GpuProfiler profiler;
+    return profiler;
+}
+
+void GpuProfiler::initialize()
+{
+    m_initialized = true;
+    // An implementation may report 0 bits to indicate that it has no GPU timer.
+    GLint timestampBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+    std::scoped_lock lock { m_mutex };
+    m_supported = timestampBits > 0;
+    if (m_supported)
+        startFrame(m_frameSets[0]);
+}
+
+bool GpuProfiler::isSupported() const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_supported;
+}
+
+uint64_t GpuProfiler::numSkippedFrames() const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_numSkippedFrames;
+}
+
+uint64_t GpuProfiler::currentFrame() const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_frameIndex;
+}
+
+uint64_t GpuProfiler::lastCompletedFrame() const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_lastCompletedFrame;
+}
+
+std::optional<float> GpuProfiler::lastZoneMs(std::string_view name) const
+{
+    std::scoped_lock lock { m_mutex };
+    const auto iter = std::find_if(std::begin(m_statistics), std::end(m_statistics), [&](const ZoneStatistics& statistics) { return statistics.name == name; });
+    if (iter == std::end(m_statistics) || iter->numSamples == 0 || iter->lastFrameIndex != m_lastCompletedFrame)
+        return {};
+    return iter->durationsMs[(iter->numSamples - 1) % numAverageFrames];
+}
+
+uint32_t GpuProfiler::allocateQuery(FrameSet& frameSet)
+{
+    if (frameSet.numUsedQueries == frameSet.queries.size()) {
+        // Grow in chunks; a frame usually has the same zones as the previous one, so this only happens at the start.
+        const size_t oldSize = frameSet.queries.size();
+        frameSet.queries.resize(oldSize + 32);
+        glGenQueries(32, frameSet.queries.data() + oldSize);
+    }
+    return frameSet.numUsedQueries++;
+}
+
+void GpuProfiler::startFrame(FrameSet& frameSet)
+{
+    frameSet.numUsedQueries = 0;
+    frameSet.zones.clear();
+    frameSet.frameIndex = m_frameIndex;
+    frameSet.pending = false;
+
+    // Reading GL_TIMESTAMP does not wait for the GPU; it returns the time at which all previous commands have been
+    // processed by the driver, which is close enough to align the GPU zones with the CPU zones.
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    frameSet.cpuMinusGpuTime = static_cast<int64_t>(Profiler::get().now()) - gpuTime;
+}
+
+void GpuProfiler::endFrame()
+{
+    if (!m_initialized)
+        initialize();
+    if (!m_supported)
+        return;
+    assert(m_openZones.empty());
+
+    std::scoped_lock lock { m_mutex };
+    m_frameSets[m_frameIndex % numFrameSets].pending = true;
+    ++m_frameIndex;
+
+    // The set that is about to be reused was recorded numFrameSets frames ago.
+    FrameSet& frameSet = m_frameSets[m_frameIndex % numFrameSets];
+    if (frameSet.pending && !frameSet.zones.empty()) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frameSet.queries[frameSet.numUsedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+            readBack(frameSet);
+        else
+            ++m_numSkippedFrames;
+    }
+    startFrame(frameSet);
+}
+
+void GpuProfiler::readBack(FrameSet& frameSet)
+{
+    std::vector<GLuint64> timestamps(frameSet.numUsedQueries);
+    for (uint32_t i = 0; i < frameSet.numUsedQueries; ++i)
+        glGetQueryObjectui64v(frameSet.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+
+    for (const Zone& zone : frameSet.zones) {
+        const GLuint64 begin = timestamps[zone.beginQuery];
+        const GLuint64 end = std::max(timestamps[zone.endQuery], begin);
+        const float durationMs = float(end - begin) * 1e-6f;
+
+        auto iter = std::find_if(std::begin(m_statistics), std::end(m_statistics), [&](const ZoneStatistics& statistics) { return statistics.name == zone.name; });
+        if (iter == std::end(m_statistics))
+            iter = m_statistics.insert(std::end(m_statistics), ZoneStatistics { .name = zone.name });
+        iter->durationsMs[iter->numSamples++ % numAverageFrames] = durationMs;
+        iter->lastFrameIndex = frameSet.frameIndex;
+
+        const uint64_t cpuBegin = static_cast<uint64_t>(std::max<int64_t>(0, static_cast<int64_t>(begin) + frameSet.cpuMinusGpuTime));
+        Profiler::get().recordGpuZone({ zone.name, cpuBegin, cpuBegin + (end - begin), zone.depth });
+
+        if (m_csvLogging) {
+            const uint64_t frameBegin = timestamps[frameSet.zones.front().beginQuery];
+            m_csvLog << fmt::format("{},{},{},{:.4f},{:.4f}\n", frameSet.frameIndex, zone.name, zone.depth, double(int64_t(begin - frameBegin)) * 1e-6, durationMs);
+        }
+    }
+    m_lastCompletedFrame = frameSet.frameIndex;
+}
+
+void GpuProfiler::beginZone(const char* name)
+{
+    if (!m_initialized)
+        initialize();
+    if (!m_supported)
+        return;
+
+    FrameSet& frameSet = m_frameSets[m_frameIndex % numFrameSets];
+    const uint32_t beginQuery = allocateQuery(frameSet);
+    glQueryCounter(frameSet.queries[beginQuery], GL_TIMESTAMP);
+    m_openZones.push_back(static_cast<uint32_t>(frameSet.zones.size()));
+    frameSet.zones.push_back({ name, static_cast<uint32_t>(m_openZones.size() - 1), beginQuery, 0 });
+}
+
+void GpuProfiler::endZone()
+{
+    if (!m_supported)
+        return;
+
+    assert(!m_openZones.empty());
+    FrameSet& frameSet = m_frameSets[m_frameIndex % numFrameSets];
+    const uint32_t endQuery = allocateQuery(frameSet);
+    glQueryCounter(frameSet.queries[endQuery], GL_TIMESTAMP);
+    frameSet.zones[m_openZones.back()].endQuery = endQuery;
+    m_openZones.pop_back();
+}
+
+void GpuProfiler::setCsvLog(const std::filesystem::path& filePath)
+{
+    std::scoped_lock lock { m_mutex };
+    m_csvLog.close();
+    m_csvLogging = false;
+    if (filePath.empty())
+        return;
+
+    m_csvLog.open(filePath);
+    m_csvLogging = m_csvLog.is_open();
+    if (m_csvLogging)
+        m_csvLog << "frame,zone,depth,start_ms,duration_ms\n";
+}
+
+void GpuProfiler::drawImGui()
+{
+    ImGui::Begin("GPU Profiler");
+    bool csvLogging;
+    {
+        std::scoped_lock lock { m_mutex };
+        if (!m_supported) {
+            ImGui::Text("GPU timer queries are not supported");
+            ImGui::End();
+            return;
+        }
+        csvLogging = m_csvLogging;
+    }
+    if (ImGui::Checkbox("Log to gpu_timings.csv", &csvLogging))
+        setCsvLog(csvLogging ? "gpu_timings.csv" : "");
+
+    std::scoped_lock lock { m_mutex };
+    ImGui::Text("Results are %llu frames old; %llu frames skipped", static_cast<unsigned long long>(m_frameIndex - m_lastCompletedFrame), static_cast<unsigned long long>(m_numSkippedFrames));
+
+    if (ImGui::BeginTable("GpuZones", 3)) {
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("Last (ms)");
+        ImGui::TableSetupColumn("Average (ms)");
+        ImGui::TableHeadersRow();
+        for (const ZoneStatistics& statistics : m_statistics) {
+            // Zones that stopped being recorded (e.g. a disabled pass) are hidden.
+            if (statistics.lastFrameIndex != m_lastCompletedFrame)
+                continue;
+            const uint32_t numSamples = std::min(statistics.numSamples, numAverageFrames);
+            const float sum = std::accumulate(std::begin(statistics.durationsMs), std::begin(statistics.durationsMs) + numSamples, 0.0f);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(statistics.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", double(statistics.durationsMs[(statistics.numSamples - 1) % numAverageFrames]));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", double(sum / float(numSamples)));
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
@@ -0,0 +1,183 @@
+#include "image_writer.h"
+#include "profiler.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <stb/stb_image_write.h>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+
+ImageWriter::ImageWriter(uint32_t numThreads, size_t maxQueuedBytes)
+    : m_maxQueuedBytes(maxQueuedBytes)
+{
+    assert(numThreads > 0);
+    for (uint32_t i = 0; i < numThreads; ++i)
+        m_threads.emplace_back([this]() { workerLoop(); });
+}
+
+ImageWriter::~ImageWriter()
+{
+    {
+        std::scoped_lock lock { m_mutex };
+        m_stop = true;
+    }
+    m_jobAvailable.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+void ImageWriter::write(std::filesystem::path filePath, const glm::ivec2& size, std::vector<uint8_t>&& pixels, bool flipY)
+{
+    assert(pixels.size() == size_t(size.x) * size_t(size.y) * 4);
+    const size_t numBytes = pixels.size();
+    {
+        std::unique_lock lock { m_mutex };
+        // Always accept a job when the queue is empty, even if it alone exceeds the limit.
+        m_jobFinished.wait(lock, [&]() { return m_jobs.empty() || m_queuedBytes + numBytes <= m_maxQueuedBytes; });
+        m_jobs.push_back(Job { .filePath = std::move(filePath), .size = size, .pixels = std::move(pixels), .flipY = flipY });
+        m_queuedBytes += numBytes;
+    }
+    m_jobAvailable.notify_one();
+}
+
+void ImageWriter::waitIdle()
+{
+    std::unique_lock lock { m_mutex };
+    m_jobFinished.wait(lock, [&]() { return m_jobs.empty() && m_numBusy == 0; });
+}
+
+size_t ImageWriter::numQueued() const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_jobs.size() + m_numBusy;
+}
+
+size_t ImageWriter::numFailed() const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_numFailed;
+}
+
+void ImageWriter::workerLoop()
+{
+    std::unique_lock lock { m_mutex };
+    while (true) {
+        m_jobAvailable.wait(lock, [&]() { return m_stop || !m_jobs.empty(); });
+        // Drain the queue before stopping so that no screenshot is lost at shutdown.
+        if (m_jobs.empty())
+            return;
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        ++m_numBusy;
+        lock.unlock();
+
+        const size_t numBytes = job.pixels.size();
+        const bool success = encode(job);
+        if (!success)
+            std::cerr << "Could not write image " << job.filePath << std::endl;
+
+        lock.lock();
+        --m_numBusy;
+        m_queuedBytes -= numBytes;
+        if (!success)
+            ++m_numFailed;
+        m_jobFinished.notify_all();
+    }
+}
+
+bool ImageWriter::encode(Job& job)
+{
+    PROFILE_FUNCTION();
+    const std::ptrdiff_t rowBytes = std::ptrdiff_t(job.size.x) * 4;
+    if (job.flipY) {
+        // Swap entire lines (if height is odd will not touch middle line).
+        for (int line = 0; line < job.size.y / 2; ++line) {
+            std::swap_ranges(std::begin(job.pixels) + rowBytes * line,
+                std::begin(job.pixels) + rowBytes * (line + 1),
+                std::begin(job.pixels) + rowBytes * (job.size.y - line - 1));
+        }
+    }
+
+    const std::string filePathString = job.filePath.string();
+    const std::filesystem::path extension = job.filePath.extension();
+    if (extension == ".bmp")
+        return stbi_write_bmp(filePathString.c_str(), job.size.x, job.size.y, 4, job.pixels.data()) != 0;
+    if (extension == ".png")
+        return stbi_write_png(filePathString.c_str(), job.size.x, job.size.y, 4, job.pixels.data(), static_cast<int>(rowBytes)) != 0;
+    if (extension == ".qoi")
+        return writeQoi(job.filePath, job.size, job.pixels);
+    return false;
+}
+
+// Encoder for the "Quite OK Image" format, see https://qoiformat.org/qoi-specification.pdf
+bool ImageWriter::writeQoi(const std::filesystem::path& filePath, const glm::ivec2& size, const std::vector<uint8_t>& pixels)
+{
+    constexpr uint8_t QOI_OP_INDEX = 0x00, QOI_OP_DIFF = 0x40, QOI_OP_LUMA = 0x80, QOI_OP_RUN = 0xc0, QOI_OP_RGB = 0xfe, QOI_OP_RGBA = 0xff;
+    using Pixel = std::array<uint8_t, 4>;
+
+    std::vector<uint8_t> bytes;
+    // Worst case is QOI_OP_RGBA for every pixel.
+    bytes.reserve(14 + pixels.size() / 4 * 5 + 8);
+    const auto pushUint32 = [&](uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            bytes.push_back(uint8_t(value >> shift));
+    };
+    bytes.insert(std::end(bytes), { 'q', 'o', 'i', 'f' });
+    pushUint32(uint32_t(size.x));
+    pushUint32(uint32_t(size.y));
+    bytes.push_back(4); // RGBA
+    bytes.push_back(0); // sRGB with linear alpha
+
+    std::array<Pixel, 64> index {};
+    Pixel previous { 0, 0, 0, 255 };
+    uint8_t run = 0;
+    for (size_t offset = 0; offset < pixels.size(); offset += 4) {
+        const Pixel pixel { pixels[offset], pixels[offset + 1], pixels[offset + 2], pixels[offset + 3] };
+        if (pixel == previous) {
+            if (++run == 62) {
+                bytes.push_back(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            bytes.push_back(QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+
+        const uint8_t hash = uint8_t((pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64);
+        if (index[hash] == pixel) {
+            bytes.push_back(QOI_OP_INDEX | hash);
+        } else if (pixel[3] == previous[3]) {
+            // Differences wrap around, as specified.
+            const int dr = int8_t(uint8_t(pixel[0] - previous[0]));
+            const int dg = int8_t(uint8_t(pixel[1] - previous[1]));
+            const int db = int8_t(uint8_t(pixel[2] - previous[2]));
+            const int drDg = dr - dg, dbDg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                bytes.push_back(uint8_t(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+            } else if (dg >= -32 && dg <= 31 && drDg >= -8 && drDg <= 7 && dbDg >= -8 && dbDg <= 7) {
+                bytes.push_back(uint8_t(QOI_OP_LUMA | (dg + 32)));
+                bytes.push_back(uint8_t((drDg + 8) << 4 | (dbDg + 8)));
+            } else {
+                bytes.insert(std::end(bytes), { QOI_OP_RGB, pixel[0], pixel[1], pixel[2] });
+            }
+        } else {
+            bytes.insert(std::end(bytes), { QOI_OP_RGBA, pixel[0], pixel[1], pixel[2], pixel[3] });
+        }
+        index[hash] = pixel;
+        previous = pixel;
+    }
+    if (run > 0)
+        bytes.push_back(QOI_OP_RUN | (run - 1));
+    bytes.insert(std::end(bytes), { 0, 0, 0, 0, 0, 0, 0, 1 });
+
+    std::ofstream file { filePath, std::ios::binary };
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
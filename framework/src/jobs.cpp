@@ -0,0 +1,315 @@
+#include "jobs.h"
+#include "profiler.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <exception>
+
+// The worker (if any) of the calling thread; a thread can only be a worker of one job system.
+struct WorkerContext {
+    const JobSystem* pSystem { nullptr };
+    uint32_t workerIndex { 0 };
+};
+static thread_local WorkerContext workerContext;
+
+static constexpr uint32_t maxFailedAttemptsBeforeSleep = 32;
+
+// Chase-Lev work-stealing deque ("Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013) with a
+// fixed capacity. Only the owner calls push() and pop(); any thread may call steal().
+//
+// The paper's standalone fences are replaced by release/seq_cst operations on m_top and m_bottom, which give the same
+// guarantees and, unlike fences, are understood by ThreadSanitizer.
+class JobSystem::WorkStealingDeque {
+public:
+    static constexpr int64_t capacity = 4096;
+
+    // Returns false when the deque is full.
+    bool push(Job* pJob)
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= capacity)
+            return false;
+        m_jobs[bottom & (capacity - 1)].store(pJob, std::memory_order_relaxed);
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    Job* pop()
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_seq_cst);
+        if (top > bottom) {
+            // Empty.
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* pJob = m_jobs[bottom & (capacity - 1)].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            // Last job: race against thieves for it.
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                pJob = nullptr;
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return pJob;
+    }
+
+    Job* steal()
+    {
+        int64_t top = m_top.load(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+        if (top >= bottom)
+            return nullptr;
+
+        Job* pJob = m_jobs[top & (capacity - 1)].load(std::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr; // Lost against the owner or another thief.
+        return pJob;
+    }
+
+private:
+    static_assert((capacity & (capacity - 1)) == 0, "Capacity must be a power of two");
+
+    // On separate cache lines: the owner writes m_bottom, thieves write m_top.
+    alignas(64) std::atomic<int64_t> m_top { 0 };
+    alignas(64) std::atomic<int64_t> m_bottom { 0 };
+    std::array<std::atomic<Job*>, capacity> m_jobs {};
+};
+
+struct JobSystem::Worker {
+    WorkStealingDeque deque;
+    uint32_t randomState; // xorshift32 state for picking victims.
+    std::thread thread;
+};
+
+JobSystem& JobSystem::get()
+{
+    static JobSystem jobSystem { std::max(std::thread::hardware_concurrency(), 1u) - 1 };
+    return jobSystem;
+}
+
+JobSystem::JobSystem(uint32_t numWorkers)
+{
+    for (uint32_t i = 0; i < numWorkers; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+        m_workers.back()->randomState = 0x9E3779B9u * (i + 1);
+    }
+    // Start the threads only after all workers exist, since they steal from each other.
+    for (uint32_t i = 0; i < numWorkers; ++i) {
+        m_workers[i]->thread = std::thread([this, i]() {
+            workerContext = { .pSystem = this, .workerIndex = i };
+            workerLoop(*m_workers[i]);
+        });
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    assert(m_numQueued.load() == 0);
+    {
+        std::scoped_lock lock { m_sleepMutex };
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto& pWorker : m_workers)
+        pWorker->thread.join();
+}
+
+void JobSystem::run(Function&& function, JobCounter* pCounter, JobCounter* pDependency)
+{
+    Job* pJob = newJob(std::move(function), pCounter);
+
+    if (pDependency) {
+        // Checked under the lock: the last job of the dependency takes the continuations under the same lock.
+        std::scoped_lock lock { pDependency->m_mutex };
+        if (!pDependency->isDone()) {
+            pDependency->m_continuations.push_back(pJob);
+            return;
+        }
+    }
+    enqueue(pJob);
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    PROFILE_FUNCTION();
+    Worker* pWorker = workerContext.pSystem == this ? m_workers[workerContext.workerIndex].get() : nullptr;
+    while (!counter.isDone()) {
+        if (Job* pJob = findJob(pWorker))
+            execute(pJob);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(size_t begin, size_t end, size_t grainSize, const RangeFunction& function)
+{
+    grainSize = std::max(grainSize, size_t(1));
+    if (end <= begin)
+        return;
+
+    std::mutex exceptionMutex;
+    std::exception_ptr pException;
+    const auto runRange = [&](size_t rangeBegin, size_t rangeEnd) {
+        try {
+            function(rangeBegin, rangeEnd);
+        } catch (...) {
+            std::scoped_lock lock { exceptionMutex };
+            if (!pException)
+                pException = std::current_exception();
+        }
+    };
+
+    // The calling thread takes the first range and then helps with the others while it waits.
+    JobCounter counter;
+    const size_t firstEnd = std::min(begin + grainSize, end);
+    for (size_t rangeBegin = firstEnd; rangeBegin < end; rangeBegin += grainSize) {
+        const size_t rangeEnd = rangeBegin + std::min(grainSize, end - rangeBegin);
+        if (m_workers.empty())
+            runRange(rangeBegin, rangeEnd);
+        else
+            enqueue(newJob([&runRange, rangeBegin, rangeEnd]() { runRange(rangeBegin, rangeEnd); }, &counter), false);
+    }
+    wakeWorkers(static_cast<uint32_t>(std::min((end - firstEnd + grainSize - 1) / grainSize, m_workers.size())));
+    runRange(begin, firstEnd);
+    wait(counter);
+
+    if (pException)
+        std::rethrow_exception(pException);
+}
+
+uint32_t JobSystem::numThreads() const
+{
+    return static_cast<uint32_t>(m_workers.size()) + 1;
+}
+
+JobSystem::Job* JobSystem::newJob(Function&& function, JobCounter* pCounter)
+{
+    if (pCounter)
+        pCounter->m_numPending.fetch_add(1, std::memory_order_relaxed);
+    return new Job { .function = std::move(function), .pCounter = pCounter, .pSystem = this };
+}
+
+void JobSystem::enqueue(Job* pJob, bool wake)
+{
+    // Run the job right away if nobody else could pick it up.
+    if (m_workers.empty()) {
+        execute(pJob);
+        return;
+    }
+
+    m_numQueued.fetch_add(1, std::memory_order_seq_cst);
+    const bool isWorker = workerContext.pSystem == this;
+    if (!isWorker || !m_workers[workerContext.workerIndex]->deque.push(pJob)) {
+        std::scoped_lock lock { m_sharedQueueMutex };
+        m_sharedQueue.push_back(pJob);
+    }
+
+    if (wake)
+        wakeWorkers(1);
+}
+
+void JobSystem::wakeWorkers(uint32_t count)
+{
+    // Pairs with the increment of m_numSleeping in workerLoop(): either the worker sees the job or we see the worker.
+    const uint32_t numSleeping = m_numSleeping.load(std::memory_order_seq_cst);
+    if (numSleeping == 0 || count == 0)
+        return;
+    // Taking the lock guarantees that a worker which is about to sleep is waiting (and can be notified) afterwards.
+    { std::scoped_lock lock { m_sleepMutex }; }
+    if (count >= numSleeping) {
+        m_wakeUp.notify_all();
+    } else {
+        for (uint32_t i = 0; i < count; ++i)
+            m_wakeUp.notify_one();
+    }
+}
+
+JobSystem::Job* JobSystem::findJob(Worker* pWorker)
+{
+    Job* pJob = pWorker ? pWorker->deque.pop() : nullptr;
+    if (!pJob) {
+        std::scoped_lock lock { m_sharedQueueMutex };
+        if (!m_sharedQueue.empty()) {
+            // Oldest first, like stealing.
+            pJob = m_sharedQueue.front();
+            m_sharedQueue.pop_front();
+        }
+    }
+    if (!pJob && !m_workers.empty()) {
+        // Visit all other workers once, starting at a random one so that thieves spread out.
+        uint32_t random = pWorker ? pWorker->randomState : static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        if (pWorker)
+            pWorker->randomState = random;
+        const size_t numWorkers = m_workers.size();
+        for (size_t i = 0; i < numWorkers && !pJob; ++i) {
+            Worker& victim = *m_workers[(random + i) % numWorkers];
+            if (&victim != pWorker)
+                pJob = victim.deque.steal();
+        }
+    }
+    if (pJob)
+        m_numQueued.fetch_sub(1, std::memory_order_relaxed);
+    return pJob;
+}
+
+void JobSystem::execute(Job* pJob)
+{
+    pJob->function();
+    JobCounter* pCounter = pJob->pCounter;
+    delete pJob;
+    if (!pCounter)
+        return;
+
+    // Decremented under the lock so that run() either sees the counter as done or adds its continuation in time.
+    std::vector<Job*> continuations;
+    {
+        std::scoped_lock lock { pCounter->m_mutex };
+        if (pCounter->m_numPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            continuations.swap(pCounter->m_continuations);
+    }
+    for (Job* pContinuation : continuations)
+        pContinuation->pSystem->enqueue(pContinuation);
+}
+
+void JobSystem::workerLoop(Worker& worker)
+{
+    uint32_t numFailedAttempts = 0;
+    while (true) {
+        if (Job* pJob = findJob(&worker)) {
+            execute(pJob);
+            numFailedAttempts = 0;
+            continue;
+        }
+        // Jobs often come in bursts; look again a few times before going through the much slower sleep and wake up.
+        if (++numFailedAttempts < maxFailedAttemptsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+        numFailedAttempts = 0;
+
+        std::unique_lock lock { m_sleepMutex };
+        m_numSleeping.fetch_add(1, std::memory_order_seq_cst);
+        m_wakeUp.wait(lock, [&]() { return m_stop || m_numQueued.load(std::memory_order_seq_cst) > 0; });
+        m_numSleeping.fetch_sub(1, std::memory_order_relaxed);
+        if (m_stop)
+            return;
+    }
+}
+
+JobCounter::~JobCounter()
+{
+    // The last job may still be unlocking the mutex after the waiter saw the counter reach zero.
+    std::scoped_lock lock { m_mutex };
+    assert(isDone() && m_continuations.empty());
+}
+
+bool JobCounter::isDone() const
+{
+    return m_numPending.load(std::memory_order_acquire) == 0;
+}
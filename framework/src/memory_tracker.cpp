@@ -0,0 +1,289 @@
+#include "memory_tracker.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+#include <imgui/imgui.h>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+const char* memoryCategoryName(MemoryCategory category)
+{
+    switch (category) {
+    case MemoryCategory::MeshData:
+        return "Mesh data";
+    case MemoryCategory::ImageData:
+        return "Image data";
+    case MemoryCategory::GpuBuffer:
+        return "GPU buffers";
+    case MemoryCategory::GpuTexture:
+        return "GPU textures";
+    case MemoryCategory::ShaderProgram:
+        return "Shader programs";
+    };
+    return "";
+}
+
+size_t mipChainBytes(int width, int height, int numLayers, int bytesPerTexel)
+{
+    size_t bytes = 0;
+    while (true) {
+        bytes += size_t(width) * size_t(height) * size_t(numLayers) * size_t(bytesPerTexel);
+        if (width == 1 && height == 1)
+            return bytes;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+}
+
+static void addBytes(MemoryUsage& usage, size_t bytes)
+{
+    usage.currentBytes += bytes;
+    usage.peakBytes = std::max(usage.peakBytes, usage.currentBytes);
+    ++usage.numAllocations;
+}
+
+static void removeBytes(MemoryUsage& usage, size_t bytes)
+{
+    assert(usage.currentBytes >= bytes && usage.numAllocations > 0);
+    usage.currentBytes -= bytes;
+    --usage.numAllocations;
+}
+
+MemoryTracker& MemoryTracker::get()
+{
+    // Never destroyed: containers with a TrackedAllocator may be destroyed during static destruction.
+    static MemoryTracker* pMemoryTracker = new MemoryTracker();
+    return *pMemoryTracker;
+}
+
+void MemoryTracker::allocate(MemoryCategory category, std::string_view asset, size_t bytes)
+{
+    std::scoped_lock lock { m_mutex };
+    Category& categoryData = m_categories[size_t(category)];
+    addBytes(categoryData.usage, bytes);
+    addBytes(m_total, bytes);
+    if (!asset.empty()) {
+        auto iter = categoryData.assets.find(asset);
+        if (iter == std::end(categoryData.assets))
+            iter = categoryData.assets.emplace(asset, MemoryUsage {}).first;
+        addBytes(iter->second, bytes);
+    }
+}
+
+void MemoryTracker::free(MemoryCategory category, std::string_view asset, size_t bytes)
+{
+    std::scoped_lock lock { m_mutex };
+    Category& categoryData = m_categories[size_t(category)];
+    removeBytes(categoryData.usage, bytes);
+    removeBytes(m_total, bytes);
+    if (!asset.empty()) {
+        // Assets that are freed completely are kept so that their peak usage remains visible.
+        if (auto iter = categoryData.assets.find(asset); iter != std::end(categoryData.assets))
+            removeBytes(iter->second, bytes);
+    }
+}
+
+void MemoryTracker::setBudget(MemoryCategory category, size_t bytes)
+{
+    std::scoped_lock lock { m_mutex };
+    m_categories[size_t(category)].budget = bytes;
+}
+
+size_t MemoryTracker::budget(MemoryCategory category) const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_categories[size_t(category)].budget;
+}
+
+MemoryUsage MemoryTracker::usage(MemoryCategory category) const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_categories[size_t(category)].usage;
+}
+
+MemoryUsage MemoryTracker::totalUsage() const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_total;
+}
+
+std::map<std::string, MemoryUsage, std::less<>> MemoryTracker::assetUsage(MemoryCategory category) const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_categories[size_t(category)].assets;
+}
+
+static std::string formatBytes(size_t bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return fmt::format("{:.2f} MiB", double(bytes) / (1024.0 * 1024.0));
+    if (bytes >= 1024)
+        return fmt::format("{:.2f} KiB", double(bytes) / 1024.0);
+    return fmt::format("{} B", bytes);
+}
+
+void MemoryTracker::drawImGui()
+{
+    // Copy the data so that other threads are not blocked while drawing.
+    std::array<Category, numMemoryCategories> categories;
+    MemoryUsage total;
+    {
+        std::scoped_lock lock { m_mutex };
+        categories = m_categories;
+        total = m_total;
+    }
+
+    ImGui::Begin("Memory");
+    ImGui::Text("Total: %s (peak %s) in %zu allocations", formatBytes(total.currentBytes).c_str(), formatBytes(total.peakBytes).c_str(), total.numAllocations);
+    if (ImGui::Button("Save memory.json"))
+        writeJson("memory.json");
+
+    for (size_t i = 0; i < numMemoryCategories; ++i) {
+        const Category& category = categories[i];
+        const bool overBudget = category.budget > 0 && category.usage.currentBytes > category.budget;
+        if (overBudget)
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
+        const std::string label = fmt::format("{}: {} (peak {}){}###{}", memoryCategoryName(MemoryCategory(i)),
+            formatBytes(category.usage.currentBytes), formatBytes(category.usage.peakBytes),
+            category.budget > 0 ? fmt::format(", budget {}", formatBytes(category.budget)) : "", i);
+        const bool open = ImGui::TreeNode(label.c_str());
+        if (overBudget)
+            ImGui::PopStyleColor();
+        if (!open)
+            continue;
+
+        if (category.assets.empty())
+            ImGui::TextUnformatted("No per-asset information");
+        else if (ImGui::BeginTable("Assets", 3)) {
+            ImGui::TableSetupColumn("Asset");
+            ImGui::TableSetupColumn("Current");
+            ImGui::TableSetupColumn("Peak");
+            ImGui::TableHeadersRow();
+            // Largest assets first.
+            std::vector<std::pair<std::string, MemoryUsage>> assets { std::begin(category.assets), std::end(category.assets) };
+            std::stable_sort(std::begin(assets), std::end(assets), [](const auto& lhs, const auto& rhs) { return lhs.second.currentBytes > rhs.second.currentBytes; });
+            for (const auto& [asset, usage] : assets) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(asset.c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(formatBytes(usage.currentBytes).c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(formatBytes(usage.peakBytes).c_str());
+            }
+            ImGui::EndTable();
+        }
+        ImGui::TreePop();
+    }
+    ImGui::End();
+}
+
+static std::string escapeJson(std::string_view string)
+{
+    std::string escaped;
+    for (char c : string) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+static std::string usageJson(const MemoryUsage& usage)
+{
+    return fmt::format("\"current_bytes\": {}, \"peak_bytes\": {}, \"allocations\": {}", usage.currentBytes, usage.peakBytes, usage.numAllocations);
+}
+
+bool MemoryTracker::writeJson(const std::filesystem::path& filePath) const
+{
+    std::ofstream file { filePath };
+    if (!file)
+        return false;
+
+    std::scoped_lock lock { m_mutex };
+    file << fmt::format("{{\n  \"total\": {{ {} }},\n  \"categories\": {{", usageJson(m_total));
+    for (size_t i = 0; i < numMemoryCategories; ++i) {
+        const Category& category = m_categories[i];
+        file << fmt::format("{}\n    \"{}\": {{ {}, \"budget_bytes\": {}, \"assets\": {{", i == 0 ? "" : ",", memoryCategoryName(MemoryCategory(i)), usageJson(category.usage), category.budget);
+        bool first = true;
+        for (const auto& [asset, usage] : category.assets) {
+            file << fmt::format("{}\n      \"{}\": {{ {} }}", first ? "" : ",", escapeJson(asset), usageJson(usage));
+            first = false;
+        }
+        file << (category.assets.empty() ? "} }" : "\n    } }");
+    }
+    file << "\n  }\n}\n";
+    return static_cast<bool>(file);
+}
+
+TrackedMemory::TrackedMemory(MemoryCategory category, std::string asset, size_t bytes)
+    : m_category(category)
+    , m_asset(std::move(asset))
+    , m_bytes(bytes)
+{
+    if (m_bytes > 0)
+        MemoryTracker::get().allocate(m_category, m_asset, m_bytes);
+}
+
+TrackedMemory::TrackedMemory(const TrackedMemory& other)
+    : m_category(other.m_category)
+    , m_asset(other.m_asset)
+    , m_bytes(other.m_bytes)
+{
+    if (m_bytes > 0)
+        MemoryTracker::get().allocate(m_category, m_asset, m_bytes);
+}
+
+TrackedMemory::TrackedMemory(TrackedMemory&& other) noexcept
+    : m_category(other.m_category)
+    , m_asset(std::move(other.m_asset))
+    , m_bytes(std::exchange(other.m_bytes, 0))
+{
+}
+
+TrackedMemory::~TrackedMemory()
+{
+    release();
+}
+
+TrackedMemory& TrackedMemory::operator=(const TrackedMemory& other)
+{
+    if (this != &other)
+        *this = TrackedMemory(other);
+    return *this;
+}
+
+TrackedMemory& TrackedMemory::operator=(TrackedMemory&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_category = other.m_category;
+        m_asset = std::move(other.m_asset);
+        m_bytes = std::exchange(other.m_bytes, 0);
+    }
+    return *this;
+}
+
+void TrackedMemory::resize(size_t bytes)
+{
+    release();
+    m_bytes = bytes;
+    if (m_bytes > 0)
+        MemoryTracker::get().allocate(m_category, m_asset, m_bytes);
+}
+
+size_t TrackedMemory::bytes() const
+{
+    return m_bytes;
+}
+
+void TrackedMemory::release()
+{
+    if (m_bytes > 0)
+        MemoryTracker::get().free(m_category, m_asset, m_bytes);
+    m_bytes = 0;
+}
@@ -1,4 +1,6 @@
 #include "mesh.h"
+#include "jobs.h"
+#include "profiler.h"
 // Suppress warnings in third-party code.
 #include <framework/disable_all_warnings.h>
 DISABLE_WARNINGS_PUSH()
@@ -18,8 +20,6 @@ DISABLE_WARNINGS_POP()
 #include <tuple>
 #include <map>
 
-static void centerAndScaleToUnitMesh(std::span<Mesh> meshes);
-
 static glm::vec3 construct_vec3(const float* pFloats)
 {
     return glm::vec3(pFloats[0], pFloats[1], pFloats[2]);
@@ -49,8 +49,69 @@ struct VertexHash {
     }
 };
 
+// Build the mesh of the triangles [startTriangle, endTriangle) of a shape, which all use the same material.
+static Mesh buildMesh(const tinyobj::attrib_t& inAttrib, const std::vector<tinyobj::material_t>& inMaterials, const std::filesystem::path& baseDir,
+    const tinyobj::shape_t& shape, size_t startTriangle, size_t endTriangle, const LoadMeshSettings& settings)
+{
+    Mesh mesh;
+    using CacheKey = std::tuple<uint32_t, uint32_t, uint32_t>;
+    std::map<CacheKey, uint32_t> vertexCache; // Map the index of a vertex as loaded by tinyobjloader to its index in the generated mesh
+    for (size_t i = startTriangle * 3; i != endTriangle * 3; i += 3) {
+        const glm::vec3 v0 = construct_vec3(&inAttrib.vertices[3 * shape.mesh.indices[i + 0].vertex_index]);
+        const glm::vec3 v1 = construct_vec3(&inAttrib.vertices[3 * shape.mesh.indices[i + 1].vertex_index]);
+        const glm::vec3 v2 = construct_vec3(&inAttrib.vertices[3 * shape.mesh.indices[i + 2].vertex_index]);
+        const auto geometricNormal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+
+        // Load the triangle indices and lazily create the vertices.
+        glm::uvec3 triangle;
+        for (unsigned j = 0; j < 3; j++) {
+            const auto& tinyObjIndex = shape.mesh.indices[i + j];
+            Vertex vertex {
+                .position = construct_vec3(&inAttrib.vertices[3 * tinyObjIndex.vertex_index]),
+                .normal = glm::vec3(0),
+                .texCoord = glm::vec2(0)
+            };
+            if (tinyObjIndex.normal_index != -1 && !inAttrib.normals.empty())
+                vertex.normal = glm::vec3(inAttrib.normals[3 * tinyObjIndex.normal_index + 0], inAttrib.normals[3 * tinyObjIndex.normal_index + 1], inAttrib.normals[3 * tinyObjIndex.normal_index + 2]);
+            else
+                vertex.normal = geometricNormal;
+            if (tinyObjIndex.texcoord_index != -1 && !inAttrib.texcoords.empty())
+                vertex.texCoord = glm::vec2(inAttrib.texcoords[2 * tinyObjIndex.texcoord_index + 0], inAttrib.texcoords[2 * tinyObjIndex.texcoord_index + 1]);
+
+            const CacheKey cacheKey { tinyObjIndex.vertex_index, tinyObjIndex.normal_index, tinyObjIndex.texcoord_index };
+            if (auto iter = vertexCache.find(cacheKey); settings.cacheVertices && iter != std::end(vertexCache)) {
+                // Already visited this vertex? Reuse it!
+                triangle[j] = iter->second;
+            } else {
+                // New vertex? Create it and store it in the vertex cache.
+                vertexCache[cacheKey] = triangle[j] = (unsigned)mesh.vertices.size();
+                mesh.vertices.push_back(vertex);
+            }
+        }
+        mesh.triangles.push_back(triangle);
+    }
+
+    const auto materialID = shape.mesh.material_ids[startTriangle];
+    if (materialID == -1) {
+        mesh.material.kd = glm::vec3(1.0f);
+        mesh.material.ks = glm::vec3(0.0f);
+        mesh.material.shininess = 1.0f;
+    } else {
+        const auto& objMaterial = inMaterials[materialID];
+        mesh.material.kd = construct_vec3(objMaterial.diffuse);
+        if (!objMaterial.diffuse_texname.empty()) {
+            mesh.material.kdTexture = std::make_shared<Image>(baseDir / objMaterial.diffuse_texname);
+        }
+        mesh.material.ks = construct_vec3(objMaterial.specular);
+        mesh.material.shininess = objMaterial.shininess;
+        mesh.material.transparency = objMaterial.dissolve;
+    }
+    return mesh;
+}
+
 std::vector<Mesh> loadMesh(const std::filesystem::path& file, const LoadMeshSettings& settings)
 {
+    PROFILE_FUNCTION();
     if (!std::filesystem::exists(file)) {
         std::cerr << "File " << file << " does not exist." << std::endl;
         throw std::exception();
@@ -69,7 +130,11 @@ std::vector<Mesh> loadMesh(const std::filesystem::path& file, const LoadMeshSett
         throw std::exception();
     }
 
-    std::vector<Mesh> out;
+    struct SubMesh {
+        const tinyobj::shape_t* pShape;
+        size_t startTriangle, endTriangle;
+    };
+    std::vector<SubMesh> subMeshes;
     for (const auto& shape : inShapes) {
         assert(shape.mesh.indices.size() % 3 == 0);
 
@@ -84,73 +149,25 @@ std::vector<Mesh> loadMesh(const std::filesystem::path& file, const LoadMeshSett
             else
                 prevMaterialID = shape.mesh.material_ids[endTriangle];
 
-            Mesh mesh;
-            using CacheKey = std::tuple<uint32_t, uint32_t, uint32_t>;
-            std::map<CacheKey, uint32_t> vertexCache; // Map the index of a vertex as loaded by tinyobjloader to its index in the generated mesh
-            for (size_t i = startTriangle * 3; i != endTriangle * 3; i += 3) {
-                const glm::vec3 v0 = construct_vec3(&inAttrib.vertices[3 * shape.mesh.indices[i + 0].vertex_index]);
-                const glm::vec3 v1 = construct_vec3(&inAttrib.vertices[3 * shape.mesh.indices[i + 1].vertex_index]);
-                const glm::vec3 v2 = construct_vec3(&inAttrib.vertices[3 * shape.mesh.indices[i + 2].vertex_index]);
-                const auto geometricNormal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
-
-                // Load the triangle indices and lazily create the vertices.
-                glm::uvec3 triangle;
-                for (unsigned j = 0; j < 3; j++) {
-                    const auto& tinyObjIndex = shape.mesh.indices[i + j];
-                    Vertex vertex {
-                        .position = construct_vec3(&inAttrib.vertices[3 * tinyObjIndex.vertex_index]),
-                        .normal = glm::vec3(0),
-                        .texCoord = glm::vec2(0)
-                    };
-                    if (tinyObjIndex.normal_index != -1 && !inAttrib.normals.empty())
-                        vertex.normal = glm::vec3(inAttrib.normals[3 * tinyObjIndex.normal_index + 0], inAttrib.normals[3 * tinyObjIndex.normal_index + 1], inAttrib.normals[3 * tinyObjIndex.normal_index + 2]);
-                    else
-                        vertex.normal = geometricNormal;
-                    if (tinyObjIndex.texcoord_index != -1 && !inAttrib.texcoords.empty())
-                        vertex.texCoord = glm::vec2(inAttrib.texcoords[2 * tinyObjIndex.texcoord_index + 0], inAttrib.texcoords[2 * tinyObjIndex.texcoord_index + 1]);
-
-                    const CacheKey cacheKey { tinyObjIndex.vertex_index, tinyObjIndex.normal_index, tinyObjIndex.texcoord_index };
-                    if (auto iter = vertexCache.find(cacheKey); settings.cacheVertices && iter != std::end(vertexCache)) {
-                        // Already visited this vertex? Reuse it!
-                        triangle[j] = iter->second;
-                    } else {
-                        // New vertex? Create it and store it in the vertex cache.
-                        vertexCache[cacheKey] = triangle[j] = (unsigned)mesh.vertices.size();
-                        mesh.vertices.push_back(vertex);
-                    }
-                }
-                mesh.triangles.push_back(triangle);
-            }
-
-            const auto materialID = shape.mesh.material_ids[startTriangle];
-            if (materialID == -1) {
-                mesh.material.kd = glm::vec3(1.0f);
-                mesh.material.ks = glm::vec3(0.0f);
-                mesh.material.shininess = 1.0f;
-            } else {
-                const auto& objMaterial = inMaterials[materialID];
-                mesh.material.kd = construct_vec3(objMaterial.diffuse);
-                if (!objMaterial.diffuse_texname.empty()) {
-                    mesh.material.kdTexture = std::make_shared<Image>(baseDir / objMaterial.diffuse_texname);
-                }
-                mesh.material.ks = construct_vec3(objMaterial.specular);
-                mesh.material.shininess = objMaterial.shininess;
-                mesh.material.transparency = objMaterial.dissolve;
-            }
-
-            out.push_back(std::move(mesh));
-
+            subMeshes.push_back({ .pShape = &shape, .startTriangle = startTriangle, .endTriangle = endTriangle });
             startTriangle = endTriangle;
         }
     }
 
+    // The meshes (including decoding their textures) are independent of each other, so they are built in parallel.
+    std::vector<Mesh> out(subMeshes.size());
+    JobSystem::get().parallelFor(0, subMeshes.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            out[i] = buildMesh(inAttrib, inMaterials, baseDir, *subMeshes[i].pShape, subMeshes[i].startTriangle, subMeshes[i].endTriangle, settings);
+    });
+
     if (settings.normalizeVertexPositions)
         centerAndScaleToUnitMesh(out);
 
     return out;
 }
 
-static void centerAndScaleToUnitMesh(std::span<Mesh> meshes)
+void centerAndScaleToUnitMesh(std::span<Mesh> meshes)
 {
     std::vector<glm::vec3> positions;
     for (const auto& mesh : meshes)
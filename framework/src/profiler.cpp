@@ -0,0 +1,237 @@
+#include "profiler.h"
+// Without FRAMEWORK_ENABLE_PROFILER, profiler.h provides an empty inline Profiler instead.
+#ifdef FRAMEWORK_ENABLE_PROFILER
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+#include <imgui/imgui.h>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <string_view>
+
+Profiler& Profiler::get()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : m_startTime(std::chrono::steady_clock::now())
+{
+}
+
+uint64_t Profiler::now() const
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count());
+}
+
+Profiler::ThreadBufferHandle::~ThreadBufferHandle()
+{
+    // The buffer is reused by the next new thread once endFrame() has drained it.
+    if (pBuffer)
+        pBuffer->inUse.store(false, std::memory_order_release);
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+    thread_local ThreadBufferHandle handle;
+    if (handle.pBuffer)
+        return *handle.pBuffer;
+
+    // Threads that are started every frame (e.g. by the culling code) would otherwise allocate a new buffer each frame.
+    std::lock_guard lock { m_threadBuffersMutex };
+    for (const auto& pBuffer : m_threadBuffers) {
+        const bool drained = pBuffer->readIndex.load(std::memory_order_relaxed) == pBuffer->writeIndex.load(std::memory_order_relaxed);
+        if (!pBuffer->inUse.load(std::memory_order_acquire) && drained) {
+            pBuffer->inUse.store(true, std::memory_order_relaxed);
+            pBuffer->depth = 0;
+            handle.pBuffer = pBuffer.get();
+            return *handle.pBuffer;
+        }
+    }
+    auto& pBuffer = m_threadBuffers.emplace_back(std::make_unique<ThreadBuffer>());
+    pBuffer->threadId = static_cast<uint32_t>(m_threadBuffers.size() - 1);
+    handle.pBuffer = pBuffer.get();
+    return *handle.pBuffer;
+}
+
+uint32_t Profiler::enterZone()
+{
+    return threadBuffer().depth++;
+}
+
+void Profiler::record(const ProfileEvent& event)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    --buffer.depth;
+
+    const uint64_t writeIndex = buffer.writeIndex.load(std::memory_order_relaxed);
+    if (writeIndex - buffer.readIndex.load(std::memory_order_acquire) >= threadBufferCapacity) {
+        buffer.numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[writeIndex % threadBufferCapacity] = event;
+    buffer.writeIndex.store(writeIndex + 1, std::memory_order_release);
+}
+
+void Profiler::endFrame()
+{
+    m_lastFrameStart = m_lastFrameEnd;
+    m_lastFrameEnd = now();
+
+    std::lock_guard lock { m_threadBuffersMutex };
+    m_lastFrame.resize(m_threadBuffers.size());
+    for (size_t i = 0; i < m_threadBuffers.size(); ++i) {
+        ThreadBuffer& buffer = *m_threadBuffers[i];
+        Lane& lane = m_lastFrame[i];
+        lane.threadId = buffer.threadId;
+        lane.events.clear();
+
+        const uint64_t readIndex = buffer.readIndex.load(std::memory_order_relaxed);
+        const uint64_t writeIndex = buffer.writeIndex.load(std::memory_order_acquire);
+        for (uint64_t index = readIndex; index != writeIndex; ++index)
+            lane.events.push_back(buffer.events[index % threadBufferCapacity]);
+        buffer.readIndex.store(writeIndex, std::memory_order_release);
+
+        if (m_capturing) {
+            for (const ProfileEvent& event : lane.events) {
+                if (m_capturedEvents.size() < maxCapturedEvents)
+                    m_capturedEvents.push_back({ event, lane.threadId });
+            }
+        }
+    }
+
+    std::lock_guard gpuZonesLock { m_gpuZonesMutex };
+    for (const ProfileEvent& event : m_gpuZones) {
+        if (m_capturedEvents.size() < maxCapturedEvents)
+            m_capturedEvents.push_back({ event, gpuThreadId });
+    }
+    m_gpuZones.clear();
+}
+
+const std::vector<Profiler::Lane>& Profiler::lastFrame() const
+{
+    return m_lastFrame;
+}
+
+uint64_t Profiler::lastFrameStart() const
+{
+    return m_lastFrameStart;
+}
+
+uint64_t Profiler::lastFrameEnd() const
+{
+    return m_lastFrameEnd;
+}
+
+void Profiler::setCapturing(bool capturing)
+{
+    m_capturing = capturing;
+}
+
+bool Profiler::isCapturing() const
+{
+    return m_capturing;
+}
+
+uint64_t Profiler::numDroppedEvents() const
+{
+    std::lock_guard lock { m_threadBuffersMutex };
+    uint64_t numDropped = 0;
+    for (const auto& pBuffer : m_threadBuffers)
+        numDropped += pBuffer->numDropped.load(std::memory_order_relaxed);
+    return numDropped;
+}
+
+void Profiler::recordGpuZone(const ProfileEvent& event)
+{
+    // Moved into the capture by endFrame(), which may run on another thread.
+    if (!m_capturing)
+        return;
+    std::lock_guard lock { m_gpuZonesMutex };
+    if (m_gpuZones.size() < maxCapturedEvents)
+        m_gpuZones.push_back(event);
+}
+
+static std::string escapeJson(std::string_view string)
+{
+    std::string escaped;
+    for (char c : string) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool Profiler::writeChromeTrace(const std::filesystem::path& filePath)
+{
+    std::ofstream file { filePath };
+    if (!file)
+        return false;
+
+    // Complete ("X") events with timestamps in microseconds; see the Trace Event Format specification.
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    file << fmt::format("\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":\"GPU\"}}}}", gpuThreadId);
+    for (const auto& [event, threadId] : m_capturedEvents) {
+        file << fmt::format(",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+            escapeJson(event.name), threadId == gpuThreadId ? "gpu" : "cpu", threadId, double(event.start) * 1e-3, double(event.end - event.start) * 1e-3);
+    }
+    file << "\n]}\n";
+    m_capturedEvents.clear();
+    return static_cast<bool>(file);
+}
+
+void Profiler::drawImGui()
+{
+    ImGui::Begin("Profiler");
+    const double frameDuration = double(m_lastFrameEnd - m_lastFrameStart);
+    ImGui::Text("CPU frame: %.3f ms", frameDuration * 1e-6);
+    bool capturing = m_capturing;
+    if (ImGui::Checkbox("Capture", &capturing)) {
+        m_capturing = capturing;
+        if (!capturing)
+            writeChromeTrace("profile_trace.json");
+    }
+    ImGui::SameLine();
+    ImGui::Text("%zu zones (saved to profile_trace.json when stopped)", m_capturedEvents.size());
+    if (const uint64_t numDropped = numDroppedEvents(); numDropped > 0)
+        ImGui::Text("Dropped zones: %llu", static_cast<unsigned long long>(numDropped));
+
+    // Flame graph: one row per nesting level, zones placed relative to the start of the frame.
+    constexpr float rowHeight = 18.0f;
+    ImDrawList* pDrawList = ImGui::GetWindowDrawList();
+    const float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+    for (const Lane& lane : m_lastFrame) {
+        if (lane.events.empty() || frameDuration <= 0.0)
+            continue;
+        uint32_t maxDepth = 0;
+        for (const ProfileEvent& event : lane.events)
+            maxDepth = std::max(maxDepth, event.depth);
+
+        ImGui::Text("Thread %u", lane.threadId);
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImGui::InvisibleButton(fmt::format("lane{}", lane.threadId).c_str(), ImVec2(width, rowHeight * float(maxDepth + 1)));
+        for (const ProfileEvent& event : lane.events) {
+            const auto toX = [&](uint64_t time) {
+                const double t = (double(std::clamp(time, m_lastFrameStart, m_lastFrameEnd)) - double(m_lastFrameStart)) / frameDuration;
+                return origin.x + float(t) * width;
+            };
+            const ImVec2 min { toX(event.start), origin.y + rowHeight * float(event.depth) };
+            const ImVec2 max { std::max(toX(event.end), min.x + 1.0f), min.y + rowHeight - 1.0f };
+
+            // Stable color per zone name.
+            const size_t hash = std::hash<std::string_view> {}(event.name);
+            const ImU32 color = IM_COL32(80 + hash % 128, 80 + (hash >> 8) % 128, 80 + (hash >> 16) % 128, 255);
+            pDrawList->AddRectFilled(min, max, color);
+            if (ImGui::CalcTextSize(event.name).x < max.x - min.x - 4.0f)
+                pDrawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32_WHITE, event.name);
+            if (ImGui::IsMouseHoveringRect(min, max))
+                ImGui::SetTooltip("%s: %.3f ms", event.name, double(event.end - event.start) * 1e-6);
+        }
+    }
+    ImGui::End();
+}
+#endif
@@ -0,0 +1,143 @@
+#include "render_thread.h"
+#include "profiler.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <imgui/imgui.h>
+DISABLE_WARNINGS_POP()
+#include <cassert>
+#include <chrono>
+#include <utility>
+
+ImGuiDrawSnapshot::~ImGuiDrawSnapshot()
+{
+    clear();
+}
+
+void ImGuiDrawSnapshot::capture()
+{
+    PROFILE_FUNCTION();
+    ImGui::Render();
+    const ImDrawData* pSource = ImGui::GetDrawData();
+
+    clear();
+    if (!m_pDrawData)
+        m_pDrawData = std::make_unique<ImDrawData>();
+    // Shallow copy of the display settings; the draw lists themselves belong to ImGui and are reused next frame.
+    *m_pDrawData = *pSource;
+    for (int i = 0; i < pSource->CmdListsCount; ++i)
+        m_drawLists.push_back(pSource->CmdLists[i]->CloneOutput());
+    m_pDrawData->CmdLists = m_drawLists.data();
+}
+
+ImDrawData* ImGuiDrawSnapshot::drawData()
+{
+    return m_pDrawData && m_pDrawData->Valid ? m_pDrawData.get() : nullptr;
+}
+
+void ImGuiDrawSnapshot::clear()
+{
+    for (ImDrawList* pDrawList : m_drawLists)
+        IM_DELETE(pDrawList);
+    m_drawLists.clear();
+    if (m_pDrawData)
+        m_pDrawData->Clear();
+}
+
+RenderThread::RenderThread(Window& window, RenderFunction&& render)
+    : m_window(window)
+    , m_render(std::move(render))
+{
+    m_window.releaseContext();
+    m_thread = std::thread([this]() { threadLoop(); });
+}
+
+RenderThread::~RenderThread()
+{
+    {
+        std::scoped_lock lock { m_mutex };
+        m_stop = true;
+    }
+    m_packetSubmitted.notify_one();
+    m_thread.join();
+    m_window.makeContextCurrent();
+}
+
+uint32_t RenderThread::beginPacket()
+{
+    PROFILE_FUNCTION();
+    const auto start = std::chrono::high_resolution_clock::now();
+    std::unique_lock lock { m_mutex };
+    m_packetRendered.wait(lock, [&]() { return m_pRenderException || m_numSubmitted - m_numRendered < numPackets; });
+    rethrowRenderException();
+    m_mainThreadWaitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return static_cast<uint32_t>(m_numSubmitted % numPackets);
+}
+
+void RenderThread::submitPacket()
+{
+    {
+        std::scoped_lock lock { m_mutex };
+        assert(m_numSubmitted - m_numRendered < numPackets);
+        ++m_numSubmitted;
+    }
+    m_packetSubmitted.notify_one();
+}
+
+void RenderThread::waitIdle()
+{
+    std::unique_lock lock { m_mutex };
+    m_packetRendered.wait(lock, [&]() { return m_pRenderException || m_numRendered == m_numSubmitted; });
+    rethrowRenderException();
+}
+
+float RenderThread::mainThreadWaitMs() const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_mainThreadWaitMs;
+}
+
+float RenderThread::renderThreadWaitMs() const
+{
+    std::scoped_lock lock { m_mutex };
+    return m_renderThreadWaitMs;
+}
+
+void RenderThread::threadLoop()
+{
+    m_window.makeContextCurrent();
+
+    std::unique_lock lock { m_mutex };
+    while (true) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        m_packetSubmitted.wait(lock, [&]() { return m_stop || m_numRendered < m_numSubmitted; });
+        // Render the outstanding packets before stopping so that the last frames are not lost.
+        if (m_numRendered == m_numSubmitted)
+            break;
+        m_renderThreadWaitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        const uint32_t packetIndex = static_cast<uint32_t>(m_numRendered % numPackets);
+        lock.unlock();
+        try {
+            m_render(packetIndex);
+        } catch (...) {
+            lock.lock();
+            m_pRenderException = std::current_exception();
+            break;
+        }
+        lock.lock();
+        ++m_numRendered;
+        m_packetRendered.notify_all();
+    }
+    lock.unlock();
+    m_packetRendered.notify_all();
+
+    // Finish all commands before the context moves back to the thread that owns the window.
+    glFinish();
+    m_window.releaseContext();
+}
+
+void RenderThread::rethrowRenderException()
+{
+    if (m_pRenderException)
+        std::rethrow_exception(m_pRenderException);
+}
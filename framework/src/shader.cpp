@@ -1,23 +1,47 @@
 #include "shader.h"
+#include "window.h"
 #include <framework/disable_all_warnings.h>
 DISABLE_WARNINGS_PUSH()
 #include <fmt/format.h>
 DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <regex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 
 static constexpr GLuint invalid = 0xFFFFFFFF;
 
-static bool checkShaderErrors(GLuint shader);
-static bool checkProgramErrors(GLuint program);
+// GL_KHR_parallel_shader_compile is not part of the glad loader that ships with the framework, so load it manually.
+static constexpr GLenum GL_COMPLETION_STATUS_KHR_ = 0x91B1;
+using MaxShaderCompilerThreadsKHR = void(APIENTRY*)(GLuint count);
+
+static std::filesystem::path binaryCacheDirectory;
+static std::vector<UniformBlockLayout> uniformBlockLayouts;
+
+static bool parallelShaderCompileSupported();
+static bool checkShaderErrors(GLuint shader, const ShaderSourceMap& sourceMap, std::string& log);
+static bool checkProgramErrors(GLuint program, std::string& log);
+static bool checkUniformBlockLayouts(GLuint program, std::string& log);
 static std::string readFile(std::filesystem::path filePath);
+static void expandIncludes(const std::filesystem::path& filePath, std::string& source, ShaderSourceMap& sourceMap, std::vector<std::filesystem::path>& includeStack);
+static GLuint loadProgramBinary(const std::filesystem::path& filePath);
+static void storeProgramBinary(GLuint program, const std::filesystem::path& filePath);
 
-Shader::Shader(GLuint program)
+Shader::Shader(GLuint program, std::string name)
     : m_program(program)
 {
+    // The program binary is the closest to the size of the linked program that OpenGL reports.
+    GLint binaryLength = 0;
+    glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    m_memory = TrackedMemory(MemoryCategory::ShaderProgram, std::move(name), static_cast<size_t>(std::max(binaryLength, 0)));
 }
 
 Shader::Shader()
@@ -26,6 +50,7 @@ Shader::Shader()
 }
 
 Shader::Shader(Shader&& other)
+    : m_memory(std::move(other.m_memory))
 {
     m_program = other.m_program;
     other.m_program = invalid;
@@ -44,6 +69,7 @@ Shader& Shader::operator=(Shader&& other)
 
     m_program = other.m_program;
     other.m_program = invalid;
+    m_memory = std::move(other.m_memory);
     return *this;
 }
 
@@ -64,6 +90,16 @@ void Shader::bindUniformBlock(const std::string& blockName, GLuint bindingLocati
     }
 }
 
+bool Shader::isValid() const
+{
+    return m_program != invalid;
+}
+
+bool Shader::hasUniformBlock(const std::string& blockName) const
+{
+    return glGetUniformBlockIndex(m_program, blockName.data()) != GL_INVALID_INDEX;
+}
+
 GLuint Shader::getAttributeLocation(const std::string& name) const
 {
     GLuint loc = glGetAttribLocation(m_program, name.c_str());
@@ -82,9 +118,14 @@ GLint Shader::getUniformLocation(const std::string& name) const
     return loc;
 }
 
-ShaderBuilder::~ShaderBuilder()
+void ShaderBuilder::setBinaryCacheDirectory(std::filesystem::path directory)
 {
-    freeShaders();
+    binaryCacheDirectory = std::move(directory);
+}
+
+void ShaderBuilder::registerUniformBlockLayout(UniformBlockLayout layout)
+{
+    uniformBlockLayouts.push_back(std::move(layout));
 }
 
 ShaderBuilder& ShaderBuilder::addStage(GLuint shaderStage, std::filesystem::path shaderFile)
@@ -93,39 +134,312 @@ ShaderBuilder& ShaderBuilder::addStage(GLuint shaderStage, std::filesystem::path
         throw ShaderLoadingException(fmt::format("File {} does not exist", shaderFile.string().c_str()));
     }
 
-    const std::string shaderSource = readFile(shaderFile);
-    const GLuint shader = glCreateShader(shaderStage);
-    const char* shaderSourcePtr = shaderSource.c_str();
-    glShaderSource(shader, 1, &shaderSourcePtr, nullptr);
-    glCompileShader(shader);
-    if (!checkShaderErrors(shader)) {
-        glDeleteShader(shader);
-        throw ShaderLoadingException(fmt::format("Failed to compile shader {}", shaderFile.string().c_str()));
+    // Compilation is deferred to build() so that it can be skipped when a cached program binary exists.
+    // Includes are expanded right away; the program hash then covers the included files as well.
+    Stage stage { .stage = shaderStage, .source = {}, .sourceMap = {} };
+    stage.sourceMap.files.push_back(shaderFile);
+    std::vector<std::filesystem::path> includeStack { std::filesystem::weakly_canonical(shaderFile) };
+    expandIncludes(shaderFile, stage.source, stage.sourceMap, includeStack);
+    m_stages.push_back(std::move(stage));
+    return *this;
+}
+
+std::vector<std::filesystem::path> ShaderBuilder::dependencies() const
+{
+    std::vector<std::filesystem::path> files;
+    for (const Stage& stage : m_stages) {
+        for (const std::filesystem::path& file : stage.sourceMap.files) {
+            if (std::find(std::begin(files), std::end(files), file) == std::end(files))
+                files.push_back(file);
+        }
     }
+    return files;
+}
 
-    m_shaders.push_back(shader);
+ShaderBuilder& ShaderBuilder::addDefine(std::string name, std::string value)
+{
+    m_defines.emplace_back(std::move(name), std::move(value));
     return *this;
 }
 
 Shader ShaderBuilder::build()
 {
+    return buildAsync().finish();
+}
+
+PendingShader ShaderBuilder::buildAsync()
+{
+    // The first call also tells the driver how many compiler threads to use.
+    parallelShaderCompileSupported();
+
+    PendingShader pendingShader;
+    // Error messages refer to the source files, also for programs loaded from the cache (uniform block mismatches).
+    for (const Stage& stage : m_stages)
+        pendingShader.m_sourceMaps.push_back(stage.sourceMap);
+
+    // Program binaries are only valid for the exact driver that produced them, so the driver identification is
+    // part of the hash; binaries of an old driver simply stop being used.
+    std::filesystem::path cacheFile;
+    GLint numBinaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+    if (!binaryCacheDirectory.empty() && numBinaryFormats > 0) {
+        cacheFile = binaryCacheDirectory / fmt::format("{:016x}.bin", computeProgramHash());
+        if (GLuint program = loadProgramBinary(cacheFile); program != invalid) {
+            pendingShader.m_program = program;
+            return pendingShader;
+        }
+    }
+
+    compileAndLink(pendingShader);
+    pendingShader.m_binaryCacheFile = std::move(cacheFile);
+    return pendingShader;
+}
+
+std::string ShaderBuilder::preprocessedSource(const Stage& stage) const
+{
+    if (m_defines.empty())
+        return stage.source;
+
+    // #version must be the first directive, so the defines go directly behind it. A #line directive afterwards keeps
+    // the line numbers in the compile log in sync with the expanded source (see ShaderSourceMap).
+    size_t insertPosition = 0;
+    int nextLine = 1;
+    if (const size_t versionPosition = stage.source.find("#version"); versionPosition != std::string::npos) {
+        insertPosition = stage.source.find('\n', versionPosition);
+        insertPosition = insertPosition == std::string::npos ? stage.source.size() : insertPosition + 1;
+        nextLine = 1 + static_cast<int>(std::count(std::begin(stage.source), std::begin(stage.source) + static_cast<std::ptrdiff_t>(insertPosition), '\n'));
+    }
+
+    std::string defines;
+    if (insertPosition == stage.source.size() && !stage.source.empty() && stage.source.back() != '\n')
+        defines += '\n';
+    for (const auto& [name, value] : m_defines)
+        defines += fmt::format("#define {} {}\n", name, value);
+    defines += fmt::format("#line {}\n", nextLine);
+
+    std::string source = stage.source;
+    source.insert(insertPosition, defines);
+    return source;
+}
+
+void ShaderBuilder::compileAndLink(PendingShader& pendingShader) const
+{
+    // Compile and link without querying any status; a status query would wait for the (parallel) compiler.
+    // Errors are checked in PendingShader::finish().
+    for (const Stage& stage : m_stages) {
+        const GLuint shader = glCreateShader(stage.stage);
+        const std::string source = preprocessedSource(stage);
+        const char* shaderSourcePtr = source.c_str();
+        glShaderSource(shader, 1, &shaderSourcePtr, nullptr);
+        glCompileShader(shader);
+        pendingShader.m_shaders.push_back(shader);
+    }
+
     // Combine vertex and fragment shaders into a single shader program.
-    GLuint program = glCreateProgram();
-    for (GLuint shader : m_shaders)
+    const GLuint program = glCreateProgram();
+    for (GLuint shader : pendingShader.m_shaders)
         glAttachShader(program, shader);
+    if (!binaryCacheDirectory.empty())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program);
+    pendingShader.m_program = program;
+}
 
-    if (!checkProgramErrors(program)) {
-        throw ShaderLoadingException("Shader program failed to link");
-    }
+PendingShader::PendingShader(PendingShader&& other)
+    : m_program(other.m_program)
+    , m_shaders(std::move(other.m_shaders))
+    , m_sourceMaps(std::move(other.m_sourceMaps))
+    , m_binaryCacheFile(std::move(other.m_binaryCacheFile))
+{
+    other.m_program = 0;
+    other.m_shaders.clear();
+}
 
-    return Shader(program);
+PendingShader::~PendingShader()
+{
+    for (GLuint shader : m_shaders)
+        glDeleteShader(shader);
+    if (m_program)
+        glDeleteProgram(m_program);
 }
 
-void ShaderBuilder::freeShaders()
+PendingShader& PendingShader::operator=(PendingShader&& other)
 {
     for (GLuint shader : m_shaders)
         glDeleteShader(shader);
+    if (m_program)
+        glDeleteProgram(m_program);
+
+    m_program = std::exchange(other.m_program, 0);
+    m_shaders = std::exchange(other.m_shaders, {});
+    m_sourceMaps = std::move(other.m_sourceMaps);
+    m_binaryCacheFile = std::move(other.m_binaryCacheFile);
+    return *this;
+}
+
+bool PendingShader::isReady() const
+{
+    if (!parallelShaderCompileSupported() || m_shaders.empty())
+        return true;
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(m_program, GL_COMPLETION_STATUS_KHR_, &completed);
+    return completed == GL_TRUE;
+}
+
+Shader PendingShader::finish()
+{
+    assert(m_program);
+    const GLuint program = std::exchange(m_program, 0);
+    const std::vector<GLuint> shaders = std::exchange(m_shaders, {});
+    const auto freeShaders = [&]() {
+        // The program keeps the linked code; the shader objects are no longer needed.
+        for (GLuint shader : shaders) {
+            glDetachShader(program, shader);
+            glDeleteShader(shader);
+        }
+    };
+
+    // The exceptions carry the compile/link log so that callers can display it (e.g. after a hot reload).
+    std::string log;
+    for (size_t i = 0; i < shaders.size(); ++i) {
+        if (!checkShaderErrors(shaders[i], m_sourceMaps[i], log)) {
+            freeShaders();
+            glDeleteProgram(program);
+            throw ShaderLoadingException(fmt::format("Failed to compile shader {}:\n{}", m_sourceMaps[i].files.front().string().c_str(), log));
+        }
+    }
+    freeShaders();
+
+    if (!checkProgramErrors(program, log)) {
+        glDeleteProgram(program);
+        throw ShaderLoadingException(fmt::format("Shader program failed to link:\n{}", log));
+    }
+    if (!checkUniformBlockLayouts(program, log)) {
+        glDeleteProgram(program);
+        throw ShaderLoadingException(fmt::format("Shader program {} does not match the C++ uniform block layouts:\n{}", m_sourceMaps.empty() ? "" : m_sourceMaps.front().files.front().string(), log));
+    }
+    if (!m_binaryCacheFile.empty())
+        storeProgramBinary(program, m_binaryCacheFile);
+    // Programs are named after their stage files, e.g. "shader_vert.glsl+shader_frag.glsl".
+    std::string name;
+    for (const ShaderSourceMap& sourceMap : m_sourceMaps)
+        name += (name.empty() ? "" : "+") + sourceMap.files.front().filename().string();
+    return Shader(program, std::move(name));
+}
+
+// 64-bit FNV-1a hash.
+static void hashBytes(uint64_t& hash, std::string_view bytes)
+{
+    for (char c : bytes) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+}
+
+uint64_t ShaderBuilder::computeProgramHash() const
+{
+    // Strings are hashed including their terminator so that concatenations of different strings do not collide.
+    uint64_t hash = 0xcbf29ce484222325;
+    for (GLenum name : std::array<GLenum, 4> { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION }) {
+        const auto* pString = reinterpret_cast<const char*>(glGetString(name));
+        hashBytes(hash, pString ? pString : "");
+        hashBytes(hash, std::string_view("", 1));
+    }
+    for (const Stage& stage : m_stages) {
+        hashBytes(hash, std::to_string(stage.stage));
+        const std::string source = preprocessedSource(stage);
+        hashBytes(hash, std::string_view(source.c_str(), source.size() + 1));
+    }
+    return hash;
+}
+
+// Cache file layout: magic, binary format, binary length, binary.
+static constexpr uint32_t programBinaryMagic = 0x42505347;
+
+static GLuint loadProgramBinary(const std::filesystem::path& filePath)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+        return invalid;
+
+    uint32_t magic = 0;
+    GLenum binaryFormat = 0;
+    GLsizei binaryLength = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    file.read(reinterpret_cast<char*>(&binaryFormat), sizeof(binaryFormat));
+    file.read(reinterpret_cast<char*>(&binaryLength), sizeof(binaryLength));
+    if (!file || magic != programBinaryMagic || binaryLength <= 0)
+        return invalid;
+    std::vector<char> binary(static_cast<size_t>(binaryLength));
+    if (!file.read(binary.data(), binaryLength))
+        return invalid;
+
+    // The driver may still reject the binary (e.g. after an update that did not change the version string).
+    // In that case the program is recompiled from source and the cache entry is overwritten.
+    const GLuint program = glCreateProgram();
+    glProgramBinary(program, binaryFormat, binary.data(), binaryLength);
+    GLint linkSuccessful = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkSuccessful);
+    if (!linkSuccessful) {
+        glDeleteProgram(program);
+        return invalid;
+    }
+    return program;
+}
+
+static void storeProgramBinary(GLuint program, const std::filesystem::path& filePath)
+{
+    GLint binaryLength = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    if (binaryLength <= 0)
+        return;
+
+    std::vector<char> binary(static_cast<size_t>(binaryLength));
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, binaryLength, &binaryLength, &binaryFormat, binary.data());
+
+    // Write to a temporary file first so that a concurrently starting process never reads a partial binary.
+    std::error_code errorCode;
+    std::filesystem::create_directories(filePath.parent_path(), errorCode);
+    std::filesystem::path tmpFilePath = filePath;
+    tmpFilePath += ".tmp";
+    {
+        std::ofstream file(tmpFilePath, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&programBinaryMagic), sizeof(programBinaryMagic));
+        file.write(reinterpret_cast<const char*>(&binaryFormat), sizeof(binaryFormat));
+        file.write(reinterpret_cast<const char*>(&binaryLength), sizeof(binaryLength));
+        file.write(binary.data(), binaryLength);
+        if (!file) {
+            std::cerr << "Warning : Could not write program binary " << tmpFilePath << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename(tmpFilePath, filePath, errorCode);
+}
+
+static bool initParallelShaderCompile()
+{
+    bool supported = false;
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions; ++i) {
+        const std::string_view extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        supported |= (extension == "GL_KHR_parallel_shader_compile");
+    }
+    if (!supported)
+        return false;
+
+    // 0xFFFFFFFF lets the driver pick the number of compiler threads.
+    if (auto pMaxShaderCompilerThreadsKHR = reinterpret_cast<MaxShaderCompilerThreadsKHR>(Window::getProcAddress("glMaxShaderCompilerThreadsKHR")))
+        pMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    return true;
+}
+
+static bool parallelShaderCompileSupported()
+{
+    static const bool supported = initParallelShaderCompile();
+    return supported;
 }
 
 static std::string readFile(std::filesystem::path filePath)
@@ -137,13 +451,91 @@ static std::string readFile(std::filesystem::path filePath)
     return buffer.str();
 }
 
-static bool checkShaderErrors(GLuint shader)
+// Matches "<source string>:<line>" or "<source string>(<line>)" as used by the common drivers at the start of a message,
+// e.g. "0:12(5): error" (Mesa), "0(12) : error" (NVIDIA) and "ERROR: 0:12:" (AMD, Apple).
+static const std::regex logLocationRegex { R"((^|[^\w.])(\d+)([:(])(\d+))" };
+
+// Replace the locations in a compile log (lines of the expanded source) by the files and lines that they came from.
+static std::string remapShaderLog(const std::string& log, const ShaderSourceMap& sourceMap)
+{
+    std::istringstream logStream { log };
+    std::string remappedLog;
+    for (std::string line; std::getline(logStream, line);) {
+        // Only the first location of a line is remapped; numbers in the message itself are left alone.
+        std::smatch match;
+        if (std::regex_search(line, match, logLocationRegex)) {
+            const auto expandedLine = static_cast<uint32_t>(std::stoul(match[4].str()));
+            auto segmentIter = std::upper_bound(std::begin(sourceMap.segments), std::end(sourceMap.segments), expandedLine,
+                [](uint32_t lineNumber, const ShaderSourceMap::Segment& segment) { return lineNumber < segment.line; });
+            if (segmentIter != std::begin(sourceMap.segments)) {
+                const ShaderSourceMap::Segment& segment = *std::prev(segmentIter);
+                const std::string location = fmt::format("{}{}{}", sourceMap.files[segment.fileIndex].string(), match[3].str(), segment.fileLine + (expandedLine - segment.line));
+                line.replace(static_cast<size_t>(match.position(2)), static_cast<size_t>(match.length(2) + match.length(3) + match.length(4)), location);
+            }
+        }
+        remappedLog += line;
+        remappedLog += '\n';
+    }
+    return remappedLog;
+}
+
+// Append the file to source, replacing #include directives by the contents of the included files.
+// No #line directives are emitted (drivers handle their source string numbers inconsistently); instead, the source map
+// records which file every line of the expanded source came from.
+static void expandIncludes(const std::filesystem::path& filePath, std::string& source, ShaderSourceMap& sourceMap, std::vector<std::filesystem::path>& includeStack)
+{
+    static const std::regex includeRegex { R"regex(^\s*#\s*include\s+"([^"]+)")regex" };
+
+    const auto fileIndex = static_cast<uint32_t>(std::distance(std::begin(sourceMap.files), std::find(std::begin(sourceMap.files), std::end(sourceMap.files), filePath)));
+    uint32_t expandedLine = 1 + static_cast<uint32_t>(std::count(std::begin(source), std::end(source), '\n'));
+    sourceMap.segments.push_back({ expandedLine, fileIndex, 1 });
+
+    std::istringstream fileStream { readFile(filePath) };
+    uint32_t lineNumber = 0;
+    for (std::string line; std::getline(fileStream, line);) {
+        ++lineNumber;
+        std::smatch match;
+        if (!std::regex_search(line, match, includeRegex)) {
+            source += line;
+            source += '\n';
+            ++expandedLine;
+            continue;
+        }
+
+        const std::filesystem::path includeFile = filePath.parent_path() / match[1].str();
+        if (!std::filesystem::exists(includeFile))
+            throw ShaderLoadingException(fmt::format("{}:{}: included file {} does not exist", filePath.string(), lineNumber, includeFile.string()));
+        const std::filesystem::path canonicalIncludeFile = std::filesystem::weakly_canonical(includeFile);
+        if (std::find(std::begin(includeStack), std::end(includeStack), canonicalIncludeFile) != std::end(includeStack))
+            throw ShaderLoadingException(fmt::format("{}:{}: recursive include of {}", filePath.string(), lineNumber, includeFile.string()));
+
+        // Every file is included once; an empty line keeps the line numbers intact.
+        const bool alreadyIncluded = std::any_of(std::begin(sourceMap.files), std::end(sourceMap.files),
+            [&](const std::filesystem::path& file) { return std::filesystem::weakly_canonical(file) == canonicalIncludeFile; });
+        if (alreadyIncluded) {
+            source += '\n';
+            ++expandedLine;
+            continue;
+        }
+
+        sourceMap.files.push_back(includeFile);
+        includeStack.push_back(canonicalIncludeFile);
+        expandIncludes(includeFile, source, sourceMap, includeStack);
+        includeStack.pop_back();
+
+        // Continue with the line after the #include.
+        expandedLine = 1 + static_cast<uint32_t>(std::count(std::begin(source), std::end(source), '\n'));
+        sourceMap.segments.push_back({ expandedLine, fileIndex, lineNumber + 1 });
+    }
+}
+
+static bool checkShaderErrors(GLuint shader, const ShaderSourceMap& sourceMap, std::string& log)
 {
     // Check if the shader compiled successfully.
     GLint compileSuccessful;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &compileSuccessful);
 
-    // If it didn't, then read and print the compile log.
+    // If it didn't, then read the compile log.
     if (!compileSuccessful) {
         GLint logLength;
         glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
@@ -152,20 +544,20 @@ static bool checkShaderErrors(GLuint shader)
         logBuffer.resize(static_cast<size_t>(logLength));
         glGetShaderInfoLog(shader, logLength, nullptr, logBuffer.data());
 
-        std::cerr << logBuffer << std::endl;
+        log = remapShaderLog(logBuffer.c_str(), sourceMap);
         return false;
     } else {
         return true;
     }
 }
 
-static bool checkProgramErrors(GLuint program)
+static bool checkProgramErrors(GLuint program, std::string& log)
 {
     // Check if the program linked successfully
     GLint linkSuccessful;
     glGetProgramiv(program, GL_LINK_STATUS, &linkSuccessful);
 
-    // If it didn't, then read and print the link log
+    // If it didn't, then read the link log
     if (!linkSuccessful) {
         GLint logLength;
         glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
@@ -174,9 +566,84 @@ static bool checkProgramErrors(GLuint program)
         logBuffer.resize(static_cast<size_t>(logLength));
         glGetProgramInfoLog(program, logLength, nullptr, logBuffer.data());
 
-        std::cerr << logBuffer << std::endl;
+        log = logBuffer.c_str();
         return false;
     } else {
         return true;
     }
 }
+
+// Compare the layout that the driver assigned to a uniform block with the C++ struct that is uploaded to it.
+static void checkUniformBlockLayout(GLuint program, GLuint blockIndex, const UniformBlockLayout& layout, std::string& log)
+{
+    GLint blockDataSize = 0, numUniforms = 0;
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockDataSize);
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &numUniforms);
+    if (static_cast<size_t>(blockDataSize) > layout.size * layout.arraySize)
+        log += fmt::format("  {}: block is {} bytes but the C++ data is only {} bytes\n", layout.blockName, blockDataSize, layout.size * layout.arraySize);
+
+    std::vector<GLint> signedIndices(static_cast<size_t>(numUniforms));
+    glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, signedIndices.data());
+    const std::vector<GLuint> indices(std::begin(signedIndices), std::end(signedIndices));
+    const auto queryUniforms = [&](GLenum property) {
+        std::vector<GLint> values(indices.size());
+        glGetActiveUniformsiv(program, numUniforms, indices.data(), property, values.data());
+        return values;
+    };
+    const std::vector<GLint> offsets = queryUniforms(GL_UNIFORM_OFFSET);
+    const std::vector<GLint> types = queryUniforms(GL_UNIFORM_TYPE);
+    const std::vector<GLint> matrixStrides = queryUniforms(GL_UNIFORM_MATRIX_STRIDE);
+    const std::vector<GLint> rowMajor = queryUniforms(GL_UNIFORM_IS_ROW_MAJOR);
+    const std::vector<GLint> nameLengths = queryUniforms(GL_UNIFORM_NAME_LENGTH);
+
+    // std140 blocks report all of their members as active, including the ones that the shader does not use.
+    std::unordered_map<std::string, GLint> shaderOffsets;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        std::string name(static_cast<size_t>(nameLengths[i]), '\0');
+        glGetActiveUniformName(program, indices[i], nameLengths[i], nullptr, name.data());
+        name.resize(std::strlen(name.c_str()));
+        shaderOffsets[name] = offsets[i];
+
+        // The layout only describes the first struct of an array; the others follow at a stride of layout.size.
+        if (layout.arraySize > 1 && name.find("[0]") == std::string::npos)
+            continue;
+
+        auto memberIter = std::find_if(std::begin(layout.members), std::end(layout.members), [&](const UniformBlockMember& member) { return member.name == name; });
+        if (memberIter == std::end(layout.members)) {
+            log += fmt::format("  {}.{}: missing in the C++ struct\n", layout.blockName, name);
+            continue;
+        }
+        if (static_cast<size_t>(offsets[i]) != memberIter->offset)
+            log += fmt::format("  {}.{}: offset is {} in the shader but {} in C++\n", layout.blockName, name, offsets[i], memberIter->offset);
+        if (static_cast<GLenum>(types[i]) != memberIter->type)
+            log += fmt::format("  {}.{}: type is 0x{:04X} in the shader but 0x{:04X} in C++\n", layout.blockName, name, types[i], memberIter->type);
+        if (matrixStrides[i] != 0 && (matrixStrides[i] != 16 || rowMajor[i]))
+            log += fmt::format("  {}.{}: matrix must be column major with a stride of 16 bytes (is {}{})\n", layout.blockName, name, matrixStrides[i], rowMajor[i] ? ", row major" : "");
+    }
+
+    for (const UniformBlockMember& member : layout.members) {
+        auto offsetIter = shaderOffsets.find(member.name);
+        if (offsetIter == std::end(shaderOffsets)) {
+            log += fmt::format("  {}.{}: missing in the shader\n", layout.blockName, member.name);
+            continue;
+        }
+        // Two elements suffice to check the stride of an array of structs.
+        if (layout.arraySize > 1) {
+            std::string secondName = member.name;
+            secondName.replace(secondName.find("[0]"), 3, "[1]");
+            if (auto secondIter = shaderOffsets.find(secondName); secondIter != std::end(shaderOffsets) && static_cast<size_t>(secondIter->second - offsetIter->second) != layout.size)
+                log += fmt::format("  {}.{}: array stride is {} in the shader but {} in C++\n", layout.blockName, member.name, secondIter->second - offsetIter->second, layout.size);
+        }
+    }
+}
+
+static bool checkUniformBlockLayouts(GLuint program, std::string& log)
+{
+    log.clear();
+    for (const UniformBlockLayout& layout : uniformBlockLayouts) {
+        // Programs that do not contain the block are not affected by it.
+        if (const GLuint blockIndex = glGetUniformBlockIndex(program, layout.blockName.c_str()); blockIndex != GL_INVALID_INDEX)
+            checkUniformBlockLayout(program, blockIndex, layout, log);
+    }
+    return log.empty();
+}
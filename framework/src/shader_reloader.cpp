@@ -0,0 +1,91 @@
+#include "shader_reloader.h"
+#include "profiler.h"
+#include <algorithm>
+#include <iostream>
+
+void ShaderReloader::add(Shader& shader, BuilderFactory makeBuilder)
+{
+    Entry& entry = m_entries.emplace_back(Entry { .pShader = &shader, .makeBuilder = std::move(makeBuilder), .dependencies = {}, .pendingShader = {}, .error = {} });
+    for (const std::filesystem::path& file : entry.makeBuilder().dependencies()) {
+        entry.dependencies.push_back(std::filesystem::weakly_canonical(file));
+        m_fileWatcher.addFile(file);
+    }
+}
+
+void ShaderReloader::remove(const Shader& shader)
+{
+    std::erase_if(m_entries, [&](const Entry& entry) { return entry.pShader == &shader; });
+}
+
+void ShaderReloader::startRebuild(Entry& entry)
+{
+    try {
+        ShaderBuilder builder = entry.makeBuilder();
+        // The includes may have changed as well.
+        entry.dependencies.clear();
+        for (const std::filesystem::path& file : builder.dependencies()) {
+            entry.dependencies.push_back(std::filesystem::weakly_canonical(file));
+            m_fileWatcher.addFile(file);
+        }
+        entry.pendingShader.emplace(builder.buildAsync());
+    } catch (const ShaderLoadingException& e) {
+        entry.error = Error { .file = entry.dependencies.front(), .log = e.what() };
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+void ShaderReloader::update()
+{
+    PROFILE_FUNCTION();
+    const std::vector<std::filesystem::path> changedFiles = m_fileWatcher.poll();
+    if (!changedFiles.empty()) {
+        for (Entry& entry : m_entries) {
+            const bool changed = std::any_of(std::begin(entry.dependencies), std::end(entry.dependencies),
+                [&](const std::filesystem::path& file) { return std::find(std::begin(changedFiles), std::end(changedFiles), file) != std::end(changedFiles); });
+            if (!changed)
+                continue;
+
+            // Only one rebuild per shader is in flight; a newer change restarts it once the current one finished.
+            if (entry.pendingShader)
+                entry.outdated = true;
+            else
+                startRebuild(entry);
+        }
+    }
+
+    for (Entry& entry : m_entries) {
+        if (!entry.pendingShader || !entry.pendingShader->isReady())
+            continue;
+
+        try {
+            // Swapping between frames means that no draw ever sees a partially updated shader.
+            *entry.pShader = entry.pendingShader->finish();
+            entry.error.reset();
+            ++m_numReloads;
+        } catch (const ShaderLoadingException& e) {
+            entry.error = Error { .file = entry.dependencies.front(), .log = e.what() };
+            std::cerr << e.what() << std::endl;
+        }
+        entry.pendingShader.reset();
+
+        if (entry.outdated) {
+            entry.outdated = false;
+            startRebuild(entry);
+        }
+    }
+}
+
+std::vector<ShaderReloader::Error> ShaderReloader::errors() const
+{
+    std::vector<Error> errors;
+    for (const Entry& entry : m_entries) {
+        if (entry.error)
+            errors.push_back(*entry.error);
+    }
+    return errors;
+}
+
+size_t ShaderReloader::numReloads() const
+{
+    return m_numReloads;
+}
@@ -0,0 +1,141 @@
+#include "shader_variants.h"
+#include <cassert>
+#include <iostream>
+#include <utility>
+
+ShaderVariants::ShaderVariants(std::vector<Stage> stages, std::vector<std::string> featureDefines)
+    : m_stages(std::move(stages))
+    , m_featureDefines(std::move(featureDefines))
+{
+    assert(m_featureDefines.size() <= 32);
+}
+
+ShaderVariants::ShaderVariants(ShaderVariants&& other)
+{
+    *this = std::move(other);
+}
+
+ShaderVariants::~ShaderVariants()
+{
+    removeFromReloader();
+}
+
+ShaderVariants& ShaderVariants::operator=(ShaderVariants&& other)
+{
+    // The compiled variants are destroyed; the reloader must forget about them.
+    removeFromReloader();
+    m_stages = std::move(other.m_stages);
+    m_featureDefines = std::move(other.m_featureDefines);
+    m_variants = std::move(other.m_variants);
+    other.m_variants.clear();
+    m_pendingVariants = std::move(other.m_pendingVariants);
+    m_failedVariants = std::move(other.m_failedVariants);
+    m_pReloader = std::exchange(other.m_pReloader, nullptr);
+    return *this;
+}
+
+ShaderBuilder ShaderVariants::makeBuilder(const std::vector<Stage>& stages, const std::vector<std::string>& featureDefines, uint32_t features)
+{
+    ShaderBuilder builder;
+    for (const auto& [shaderStage, shaderFile] : stages)
+        builder.addStage(shaderStage, shaderFile);
+    for (size_t i = 0; i < featureDefines.size(); ++i) {
+        if (features & (1u << i))
+            builder.addDefine(featureDefines[i]);
+    }
+    return builder;
+}
+
+void ShaderVariants::setReloader(ShaderReloader* pReloader)
+{
+    removeFromReloader();
+    m_pReloader = pReloader;
+    for (auto& [features, shader] : m_variants)
+        addToReloader(features, shader);
+}
+
+void ShaderVariants::addToReloader(uint32_t features, Shader& shader)
+{
+    if (!m_pReloader)
+        return;
+    // Capture by value: the reloader may rebuild the variant after this object has been moved.
+    m_pReloader->add(shader, [stages = m_stages, featureDefines = m_featureDefines, features]() {
+        return makeBuilder(stages, featureDefines, features);
+    });
+}
+
+void ShaderVariants::removeFromReloader()
+{
+    if (!m_pReloader)
+        return;
+    for (const auto& [features, shader] : m_variants)
+        m_pReloader->remove(shader);
+}
+
+void ShaderVariants::prefetch(uint32_t features)
+{
+    if (m_variants.contains(features) || m_pendingVariants.contains(features) || m_failedVariants.contains(features))
+        return;
+    try {
+        m_pendingVariants.emplace(features, makeBuilder(m_stages, m_featureDefines, features).buildAsync());
+    } catch (const ShaderLoadingException&) {
+        m_failedVariants.insert(features);
+        throw;
+    }
+}
+
+const Shader& ShaderVariants::finish(uint32_t features, PendingShader& pendingShader)
+{
+    // Take the pending shader out of the map first so it is also removed when finish() throws.
+    PendingShader shader = std::move(pendingShader);
+    m_pendingVariants.erase(features);
+    try {
+        Shader& variant = m_variants.emplace(features, shader.finish()).first->second;
+        addToReloader(features, variant);
+        return variant;
+    } catch (const ShaderLoadingException&) {
+        m_failedVariants.insert(features);
+        throw;
+    }
+}
+
+const Shader& ShaderVariants::get(uint32_t features)
+{
+    if (auto iter = m_variants.find(features); iter != std::end(m_variants))
+        return iter->second;
+
+    prefetch(features);
+    if (auto iter = m_pendingVariants.find(features); iter != std::end(m_pendingVariants))
+        return finish(features, iter->second);
+
+    // Only failed variants are neither compiled nor pending; try again so that the caller gets the error.
+    m_failedVariants.erase(features);
+    return get(features);
+}
+
+const Shader* ShaderVariants::tryGet(uint32_t features)
+{
+    if (auto iter = m_variants.find(features); iter != std::end(m_variants))
+        return &iter->second;
+
+    try {
+        prefetch(features);
+        auto iter = m_pendingVariants.find(features);
+        if (iter == std::end(m_pendingVariants) || !iter->second.isReady())
+            return nullptr;
+        return &finish(features, iter->second);
+    } catch (const ShaderLoadingException& e) {
+        std::cerr << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+size_t ShaderVariants::numCompiledVariants() const
+{
+    return m_variants.size();
+}
+
+size_t ShaderVariants::numPendingVariants() const
+{
+    return m_pendingVariants.size();
+}
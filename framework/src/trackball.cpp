@@ -49,6 +49,17 @@ Trackball::Trackball(Window* pWindow, float fovy, const glm::vec3& lookAt, float
     });
 }
 
+Trackball::Trackball(float fovy, float aspectRatio, const glm::vec3& lookAt, float distFromLookAt, float rotationX, float rotationY)
+    : m_pWindow(nullptr)
+    , m_fovy(fovy)
+    , m_halfScreenSpaceHeight(std::tan(m_fovy / 2.0f))
+    , m_halfScreenSpaceWidth(aspectRatio * m_halfScreenSpaceHeight)
+    , m_lookAt(lookAt)
+    , m_distanceFromLookAt(distFromLookAt)
+    , m_rotationEulerAngles(rotationX, rotationY, 0)
+{
+}
+
 void Trackball::printHelp()
 {
     std::cout << "Left button: turn in XY," << std::endl;
@@ -85,6 +96,8 @@ glm::mat4 Trackball::viewMatrix() const
 
 glm::mat4 Trackball::projectionMatrix() const
 {
+    if (!m_pWindow)
+        return projectionMatrix(m_halfScreenSpaceWidth / m_halfScreenSpaceHeight);
     return projectionMatrix(m_pWindow->getAspectRatio());
 }
 
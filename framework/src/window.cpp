@@ -1,4 +1,7 @@
 #include "window.h"
+#include "frame_allocator.h"
+#include "gpu_profiler.h"
+#include "profiler.h"
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/imgui_impl_opengl2.h>
@@ -6,7 +9,15 @@
 #define IMGUI_IMPL_OPENGL_LOADER_GLAD 1
 #include <imgui/imgui_impl_opengl3.h>
 #include <iostream>
-#include <stb/stb_image_write.h>
+#include <utility>
+#ifdef FRAMEWORK_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
+
+// Set while a headless EGL context is in use; OpenGL functions must then be loaded through EGL instead of GLFW.
+static bool usingEgl = false;
 
 static void glfwErrorCallback(int error, const char* description)
 {
@@ -25,9 +36,39 @@ void APIENTRY glDebugCallback(GLenum source, GLenum type, GLuint id, GLenum seve
 }
 #endif
 
+static void loadOpenGLFunctions()
+{
+    if (!gladLoadGLLoader((GLADloadproc)Window::getProcAddress)) {
+        std::cerr << "Could not initialize GLEW" << std::endl;
+        exit(1);
+    }
+    int glVersionMajor, glVersionMinor;
+    glGetIntegerv(GL_MAJOR_VERSION, &glVersionMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &glVersionMinor);
+    std::cout << "Initialized OpenGL version " << glVersionMajor << "." << glVersionMinor << std::endl;
+
+    // NOTE(Mathijs): this is not supported on macOS since Apple can't be bothered to update
+    //  their OpenGL version past 4.1 which released in 2010!
+#if !defined(__APPLE__) && defined(GL_DEBUG_SEVERITY_NOTIFICATION) && !defined(NDEBUG)
+    // Custom debug message with breakpoints at the exact error. Only supported on OpenGL 4.3 and higher.
+    if (glVersionMajor > 4 || (glVersionMajor == 4 && glVersionMinor >= 3)) {
+        glDebugMessageCallback(glDebugCallback, nullptr);
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+#endif
+}
+
 Window::Window(std::string_view title, const glm::ivec2& windowSize, OpenGLVersion glVersion, bool presentable, bool visible)
     : m_presentable(presentable), m_glVersion(glVersion)
 {
+    // Headless rendering without a display server; GLFW is not initialized at all since that would require one.
+    if (!m_presentable && createHeadlessContext()) {
+        m_windowSize = windowSize;
+        loadOpenGLFunctions();
+        createHeadlessFramebuffer();
+        return;
+    }
+
     glfwSetErrorCallback(glfwErrorCallback);
     if (!glfwInit()) {
         std::cerr << "Could not initialize GLFW" << std::endl;
@@ -88,7 +129,9 @@ Window::Window(std::string_view title, const glm::ivec2& windowSize, OpenGLVersi
         exit(1);
     }
     glfwMakeContextCurrent(m_pWindow);
-    glfwSwapInterval(1); // Enable vsync. To disable vsync set this to 0.
+    glfwSwapInterval(1); // Enable vsync. To disable vsync call setVsync(false).
+    // A negative swap interval enables adaptive vsync (late frames are presented immediately).
+    m_adaptiveVsyncSupported = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
 
     float xScale, yScale;
     glfwGetWindowContentScale(m_pWindow, &xScale, &yScale);
@@ -96,27 +139,11 @@ Window::Window(std::string_view title, const glm::ivec2& windowSize, OpenGLVersi
 
     glfwGetWindowSize(m_pWindow, &m_windowSize.x, &m_windowSize.y);
 
-    if (m_presentable) {
-        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-            glfwTerminate();
-            std::cerr << "Could not initialize GLEW" << std::endl;
-            exit(1);
-        }
-        int glVersionMajor, glVersionMinor;
-        glGetIntegerv(GL_MAJOR_VERSION, &glVersionMajor);
-        glGetIntegerv(GL_MINOR_VERSION, &glVersionMinor);
-        std::cout << "Initialized OpenGL version " << glVersionMajor << "." << glVersionMinor << std::endl;
-
-        // NOTE(Mathijs): this is not supported on macOS since Apple can't be bothered to update
-        //  their OpenGL version past 4.1 which released in 2010!
-#if !defined(__APPLE__) && defined(GL_DEBUG_SEVERITY_NOTIFICATION) && !defined(NDEBUG)
-        // Custom debug message with breakpoints at the exact error. Only supported on OpenGL 4.3 and higher.
-        if (glVersionMajor > 4 || (glVersionMajor == 4 && glVersionMinor >= 3)) {
-            glDebugMessageCallback(glDebugCallback, nullptr);
-            glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-        }
-#endif
-
+    loadOpenGLFunctions();
+    if (!m_presentable) {
+        // Hidden window as a fallback for headless rendering; still render offscreen so that both behave the same.
+        createHeadlessFramebuffer();
+    } else {
         // Setup Dear ImGui context.
         ImGui::CreateContext();
         ImGuiIO& io = ImGui::GetIO();
@@ -154,6 +181,20 @@ Window::Window(std::string_view title, const glm::ivec2& windowSize, OpenGLVersi
             }
         } break;
         };
+        // Create the font atlas and shaders now, so that starting an ImGui frame in updateInput() needs no context.
+        switch (glVersion) {
+        case OpenGLVersion::GL2: {
+            ImGui_ImplOpenGL2_NewFrame();
+        } break;
+        case OpenGLVersion::GL3: {
+        } break;
+        case OpenGLVersion::GL41: {
+            ImGui_ImplOpenGL3_NewFrame();
+        } break;
+        case OpenGLVersion::GL45: {
+            ImGui_ImplOpenGL3_NewFrame();
+        } break;
+        };
 
         glfwSetWindowUserPointer(m_pWindow, this);
 
@@ -163,11 +204,17 @@ Window::Window(std::string_view title, const glm::ivec2& windowSize, OpenGLVersi
         glfwSetCursorPosCallback(m_pWindow, mouseMoveCallback);
         glfwSetScrollCallback(m_pWindow, scrollCallback);
         glfwSetWindowSizeCallback(m_pWindow, windowSizeCallback);
+        m_lastCursorPos = m_inputState.cursorPos = m_pendingInputState.cursorPos = getCursorPos();
     }
 }
 
 Window::~Window()
 {
+    // Outstanding captures use the OpenGL context, so finish them before it is destroyed.
+    waitForImageWrites();
+    m_pReadback.reset();
+    m_pImageWriter.reset();
+
     if (m_presentable) {
         switch (m_glVersion) {
         case OpenGLVersion::GL2: {
@@ -186,39 +233,173 @@ Window::~Window()
         ImGui::DestroyContext();
     }
 
+    if (m_headlessFramebuffer) {
+        glDeleteFramebuffers(1, &m_headlessFramebuffer);
+        glDeleteRenderbuffers(2, m_headlessRenderbuffers);
+    }
+
+#ifdef FRAMEWORK_HAS_EGL
+    if (m_eglContext) {
+        eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(m_eglDisplay, m_eglContext);
+        eglTerminate(m_eglDisplay);
+        usingEgl = false;
+        return;
+    }
+#endif
     glfwDestroyWindow(m_pWindow);
     glfwTerminate();
 }
 
+bool Window::createHeadlessContext()
+{
+#ifdef FRAMEWORK_HAS_EGL
+    // EGL_MESA_platform_surfaceless: a display that is not connected to any window system.
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    const auto eglGetPlatformDisplayEXT = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (!clientExtensions || !std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless") || !eglGetPlatformDisplayEXT) {
+        std::cerr << "Surfaceless EGL is not supported, headless rendering falls back to a hidden window" << std::endl;
+        return false;
+    }
+
+    EGLDisplay display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        std::cerr << "Could not initialize surfaceless EGL display" << std::endl;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        eglTerminate(display);
+        return false;
+    }
+
+    // Rendering goes to a framebuffer object, so any config will do (or none with EGL_KHR_no_config_context).
+    const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+        config = EGL_NO_CONFIG_KHR;
+
+    EGLint major = 4, minor = 1, profile = EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT;
+    switch (m_glVersion) {
+    case OpenGLVersion::GL2: {
+        major = 2;
+        minor = 1;
+        profile = EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT;
+    } break;
+    case OpenGLVersion::GL3: {
+        major = 3;
+        minor = 3;
+    } break;
+    case OpenGLVersion::GL41: {
+    } break;
+    case OpenGLVersion::GL45: {
+        minor = 5;
+    } break;
+    };
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, profile,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cerr << "Could not create surfaceless OpenGL " << major << "." << minor << " context (EGL error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        eglTerminate(display);
+        return false;
+    }
+
+    m_eglDisplay = display;
+    m_eglContext = context;
+    usingEgl = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Window::createHeadlessFramebuffer()
+{
+    glGenRenderbuffers(2, m_headlessRenderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_headlessRenderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_windowSize.x, m_windowSize.y);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_headlessRenderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_windowSize.x, m_windowSize.y);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_headlessFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_headlessFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_headlessRenderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_headlessRenderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Could not create the framebuffer of a headless window" << std::endl;
+        exit(1);
+    }
+    // Left bound, like the default framebuffer of a regular window.
+    glViewport(0, 0, m_windowSize.x, m_windowSize.y);
+}
+
+GLFWglproc Window::getProcAddress(const char* name)
+{
+#ifdef FRAMEWORK_HAS_EGL
+    if (usingEgl)
+        return reinterpret_cast<GLFWglproc>(eglGetProcAddress(name));
+#endif
+    return glfwGetProcAddress(name);
+}
+
 void Window::close()
 {
-    glfwSetWindowShouldClose(m_pWindow, 1);
+    if (m_pWindow)
+        glfwSetWindowShouldClose(m_pWindow, 1);
+    else
+        m_shouldClose = true;
 }
 
 bool Window::shouldClose()
 {
+    if (!m_pWindow)
+        return m_shouldClose;
     return glfwWindowShouldClose(m_pWindow) != 0;
 }
 
+void Window::makeContextCurrent()
+{
+#ifdef FRAMEWORK_HAS_EGL
+    if (m_eglContext) {
+        eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, m_eglContext);
+        return;
+    }
+#endif
+    glfwMakeContextCurrent(m_pWindow);
+}
+
+void Window::releaseContext()
+{
+#ifdef FRAMEWORK_HAS_EGL
+    if (m_eglContext) {
+        eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        return;
+    }
+#endif
+    glfwMakeContextCurrent(nullptr);
+}
+
 void Window::updateInput()
 {
-    glfwPollEvents();
+    if (m_pWindow) {
+        glfwPollEvents();
+        dispatchEvents();
+    }
+    // Also contains the input that sampleInput() processed during the previous frame, which is dispatched only now.
+    m_inputState = m_pendingInputState;
+    m_pendingInputState = { .cursorPos = m_pendingInputState.cursorPos };
 
     if (m_presentable) {
-        // Start the Dear ImGui frame.
-        switch (m_glVersion) {
-        case OpenGLVersion::GL2: {
-            ImGui_ImplOpenGL2_NewFrame();
-        } break;
-        case OpenGLVersion::GL3:{
-        } break;
-        case OpenGLVersion::GL41: {
-            ImGui_ImplOpenGL3_NewFrame();
-        } break;
-        case OpenGLVersion::GL45: {
-            ImGui_ImplOpenGL3_NewFrame();
-        } break;
-        };
+        // Start the Dear ImGui frame. The renderer backends only create their device objects in NewFrame(), which
+        // already happened in the constructor.
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
     }
@@ -226,55 +407,107 @@ void Window::updateInput()
 
 void Window::swapBuffers()
 {
+    PROFILE_FUNCTION();
 
     if (m_presentable) {
-        // Rendering of Dear ImGui ui.
         ImGui::Render();
-        switch (m_glVersion) {
-        case OpenGLVersion::GL2: {
-            ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
-        } break;
-        case OpenGLVersion::GL3: {
-        } break;
-        case OpenGLVersion::GL41: {
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        } break;
-        case OpenGLVersion::GL45: {
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        } break;
-        };
+        renderImGui(ImGui::GetDrawData());
     }
+    present();
+}
 
-    glfwSwapBuffers(m_pWindow);
+void Window::renderImGui(ImDrawData* pDrawData)
+{
+    if (!m_presentable || !pDrawData)
+        return;
+
+    // Rendering of Dear ImGui ui.
+    GPU_PROFILE_SCOPE("ImGui");
+    switch (m_glVersion) {
+    case OpenGLVersion::GL2: {
+        ImGui_ImplOpenGL2_RenderDrawData(pDrawData);
+    } break;
+    case OpenGLVersion::GL3: {
+    } break;
+    case OpenGLVersion::GL41: {
+        ImGui_ImplOpenGL3_RenderDrawData(pDrawData);
+    } break;
+    case OpenGLVersion::GL45: {
+        ImGui_ImplOpenGL3_RenderDrawData(pDrawData);
+    } break;
+    };
 }
 
+void Window::present()
+{
+    PROFILE_FUNCTION();
 
-void Window::renderToImage (const std::filesystem::path& filePath, const bool flipY) {
-        std::vector <GLubyte> pixels;
-        pixels.reserve (4 * m_windowSize.x * m_windowSize.y);
+    // Headless windows render to a framebuffer object that is never presented.
+    if (m_presentable) {
+        const VsyncMode vsyncMode = m_vsyncMode.load(std::memory_order_relaxed);
+        const int swapInterval = vsyncMode == VsyncMode::Off ? 0 : (vsyncMode == VsyncMode::On ? 1 : -1);
+        if (swapInterval != m_swapInterval) {
+            glfwSwapInterval(swapInterval);
+            m_swapInterval = swapInterval;
+        }
+        glfwSwapBuffers(m_pWindow);
+    } else {
+        glFlush();
+    }
 
-        glReadPixels(0, 0, m_windowSize.x, m_windowSize.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    if (m_pReadback)
+        m_pReadback->poll();
 
-        std::string filePathString = filePath.string();
+    FrameAllocator::get().nextFrame();
+}
 
-        // flips Y axis
-        if (flipY) {
-            // swap entire lines (if height is odd will not touch middle line)
-            for(int line = 0; line != m_windowSize.y/2; ++line) {
-                   std::swap_ranges(pixels.begin() + 4 * m_windowSize.x * line,
-                    pixels.begin() + 4 * m_windowSize.x * (line + 1),
-                    pixels.begin() + 4 * m_windowSize.x * (m_windowSize.y - line - 1));
-            }
-        }
+void Window::setVsync(bool enabled)
+{
+    setVsyncMode(enabled ? VsyncMode::On : VsyncMode::Off);
+}
 
-        if ((filePath.extension()).compare(".bmp") == 0) {
-            stbi_write_bmp(filePathString.c_str(), m_windowSize.x, m_windowSize.y, 4, pixels.data());
-        }
-        else if ((filePath.extension()).compare(".png") == 0) {
-            stbi_write_png(filePathString.c_str(), m_windowSize.x, m_windowSize.y, 4, pixels.data(), 4*m_windowSize.x);
-        }
+void Window::setVsyncMode(VsyncMode mode)
+{
+    if (!m_presentable)
+        return;
+    if (mode == VsyncMode::Adaptive && !m_adaptiveVsyncSupported)
+        mode = VsyncMode::On;
+    m_vsyncMode.store(mode, std::memory_order_relaxed);
+}
+
+VsyncMode Window::getVsyncMode() const
+{
+    // Headless windows are never presented, so nothing waits for a refresh.
+    return m_presentable ? m_vsyncMode.load(std::memory_order_relaxed) : VsyncMode::Off;
+}
+
+
+void Window::renderToImage(const std::filesystem::path& filePath, const bool flipY)
+{
+    PROFILE_FUNCTION();
+    if (!m_pReadback) {
+        m_pReadback = std::make_unique<AsyncReadback>();
+        m_pImageWriter = std::make_unique<ImageWriter>();
+    }
+
+    GLint previousReadFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, getFramebuffer());
+    // Framebuffer pixels rather than window coordinates, which differ on HighDPI displays.
+    const glm::ivec2 size = getFrameBufferSize();
+    m_pReadback->capture(glm::ivec2(0), size, [this, filePath, flipY](CapturedImage&& image) {
+        m_pImageWriter->write(filePath, image.size, std::move(image.pixels), flipY);
+    });
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previousReadFramebuffer));
 }
 
+void Window::waitForImageWrites()
+{
+    if (m_pReadback)
+        m_pReadback->finish();
+    if (m_pImageWriter)
+        m_pImageWriter->waitIdle();
+}
 
 void Window::registerKeyCallback(KeyCallback&& callback)
 {
@@ -314,9 +547,8 @@ void Window::keyCallback(GLFWwindow* window, int key, int scancode, int action,
     if (ImGui::GetIO().WantCaptureKeyboard)
         return;
 
-    const Window* pThisWindow = static_cast<const Window*>(glfwGetWindowUserPointer(window));
-    for (auto& callback : pThisWindow->m_keyCallbacks)
-        callback(key, scancode, action, mods);
+    Window* pThisWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    pThisWindow->queueEvent({ .type = InputEvent::Type::Key, .key = key, .scancode = scancode, .action = action, .mods = mods });
 }
 
 void Window::charCallback(GLFWwindow* window, unsigned unicodeCodePoint)
@@ -328,65 +560,170 @@ void Window::charCallback(GLFWwindow* window, unsigned unicodeCodePoint)
         return;
     }
 
-    const Window* pThisWindow = static_cast<const Window*>(glfwGetWindowUserPointer(window));
-    for (auto& callback : pThisWindow->m_charCallbacks)
-        callback(unicodeCodePoint);
+    Window* pThisWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    pThisWindow->queueEvent({ .type = InputEvent::Type::Char, .key = int(unicodeCodePoint) });
 }
 
 void Window::mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
 {
-    // Ignore callbacks when the user is interacting with imgui.
-    if (ImGui::GetIO().WantCaptureMouse)
+    // Ignore callbacks when the user is interacting with imgui; a captured mouse belongs to the application.
+    Window* pThisWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    if (ImGui::GetIO().WantCaptureMouse && !pThisWindow->m_mouseCaptured)
         return;
 
-    const Window* pThisWindow = static_cast<const Window*>(glfwGetWindowUserPointer(window));
-    for (auto& callback : pThisWindow->m_mouseButtonCallbacks)
-        callback(button, action, mods);
+    pThisWindow->queueEvent({ .type = InputEvent::Type::MouseButton, .key = button, .action = action, .mods = mods });
 }
 
 void Window::mouseMoveCallback(GLFWwindow* window, double xpos, double ypos)
 {
-    // Ignore callbacks when the user is interacting with imgui.
-    if (ImGui::GetIO().WantCaptureMouse)
+    Window* pThisWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    const glm::vec2 cursorPos { xpos, pThisWindow->m_windowSize.y - 1 - ypos };
+    const glm::vec2 cursorDelta = cursorPos - pThisWindow->m_lastCursorPos;
+    // Track the cursor while ImGui has it too, so that the first move outside of ImGui does not jump.
+    pThisWindow->m_lastCursorPos = cursorPos;
+
+    // Ignore callbacks when the user is interacting with imgui; a captured mouse belongs to the application.
+    if (ImGui::GetIO().WantCaptureMouse && !pThisWindow->m_mouseCaptured)
         return;
 
-    const Window* pThisWindow = static_cast<const Window*>(glfwGetWindowUserPointer(window));
-    for (auto& callback : pThisWindow->m_mouseMoveCallbacks)
-        callback(glm::vec2(xpos, pThisWindow->m_windowSize.y - 1 - ypos));
+    MouseMotion& mouseMotion = pThisWindow->m_mouseMotion;
+    mouseMotion.lastSampleTime = std::chrono::steady_clock::now();
+    if (mouseMotion.numSamples++ == 0)
+        mouseMotion.firstSampleTime = mouseMotion.lastSampleTime;
+    mouseMotion.delta += cursorDelta;
+
+    pThisWindow->m_pendingInputState.cursorPos = cursorPos;
+    pThisWindow->m_pendingInputState.cursorDelta += cursorDelta;
+    pThisWindow->queueEvent({ .type = InputEvent::Type::MouseMove, .value = cursorPos });
 }
 
 void Window::scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    // Ignore callbacks when the user is interacting with imgui.
-    if (ImGui::GetIO().WantCaptureMouse)
+    // Ignore callbacks when the user is interacting with imgui; a captured mouse belongs to the application.
+    Window* pThisWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    if (ImGui::GetIO().WantCaptureMouse && !pThisWindow->m_mouseCaptured)
         return;
 
-    const Window* pThisWindow = static_cast<const Window*>(glfwGetWindowUserPointer(window));
-    for (auto& callback : pThisWindow->m_scrollCallbacks)
-        callback(glm::vec2(xoffset, yoffset));
+    pThisWindow->m_pendingInputState.scrollDelta += glm::vec2(xoffset, yoffset);
+    pThisWindow->queueEvent({ .type = InputEvent::Type::Scroll, .value = glm::vec2(xoffset, yoffset) });
 }
 
 void Window::windowSizeCallback(GLFWwindow* window, int width, int height)
 {
     Window* pThisWindow = static_cast<Window*>(glfwGetWindowUserPointer(window));
     pThisWindow->m_windowSize = glm::ivec2 { width, height };
+    pThisWindow->queueEvent({ .type = InputEvent::Type::WindowResize, .value = glm::vec2(width, height) });
+}
+
+void Window::queueEvent(const InputEvent& event)
+{
+    ++m_pendingInputState.numEvents;
+
+    InputEvent* pPreviousEvent = nullptr;
+    if (!m_spilledEvents.empty())
+        pPreviousEvent = &m_spilledEvents.back();
+    else if (m_numQueuedEvents > 0)
+        pPreviousEvent = &m_eventQueues[m_currentEventQueue][m_numQueuedEvents - 1];
+    if (pPreviousEvent && pPreviousEvent->type == event.type) {
+        switch (event.type) {
+        case InputEvent::Type::MouseMove:
+        case InputEvent::Type::WindowResize:
+            pPreviousEvent->value = event.value;
+            return;
+        case InputEvent::Type::Scroll:
+            pPreviousEvent->value += event.value;
+            return;
+        default:
+            break;
+        };
+    }
+
+    if (m_numQueuedEvents == maxQueuedEvents && !m_dispatching)
+        dispatchEvents();
+    if (m_numQueuedEvents == maxQueuedEvents || !m_spilledEvents.empty()) {
+        // The other queue is still being read by dispatchEvents(); line up behind the full queue.
+        m_spilledEvents.push_back(event);
+        return;
+    }
+    m_eventQueues[m_currentEventQueue][m_numQueuedEvents++] = event;
+}
 
-    for (const auto& callback : pThisWindow->m_windowResizeCallbacks)
-        callback(glm::ivec2(width, height));
+void Window::dispatchEvents()
+{
+    // Callbacks may queue new events (e.g. setMouseCapture() polls); they go into the other queue (or the spill buffer)
+    // and are dispatched by the outer call once the current batch is done, never by a nested call that would swap back
+    // to this batch.
+    if (m_dispatching)
+        return;
+    m_dispatching = true;
+    while (m_numQueuedEvents > 0 || !m_spilledEvents.empty()) {
+        if (m_numQueuedEvents > 0) {
+            const auto& events = m_eventQueues[m_currentEventQueue];
+            const size_t numEvents = std::exchange(m_numQueuedEvents, 0);
+            m_currentEventQueue ^= 1;
+            m_pendingInputState.numDispatchedEvents += uint32_t(numEvents);
+            for (size_t i = 0; i < numEvents; ++i)
+                dispatchEvent(events[i]);
+        } else {
+            // Events queued after the queue had filled up; newer than everything dispatched so far.
+            const std::vector<InputEvent> spilledEvents = std::exchange(m_spilledEvents, {});
+            m_pendingInputState.numDispatchedEvents += uint32_t(spilledEvents.size());
+            for (const InputEvent& spilledEvent : spilledEvents)
+                dispatchEvent(spilledEvent);
+        }
+    }
+    m_dispatching = false;
+}
+
+void Window::dispatchEvent(const InputEvent& event)
+{
+    switch (event.type) {
+    case InputEvent::Type::Key: {
+        for (auto& callback : m_keyCallbacks)
+            callback(event.key, event.scancode, event.action, event.mods);
+    } break;
+    case InputEvent::Type::Char: {
+        for (auto& callback : m_charCallbacks)
+            callback(unsigned(event.key));
+    } break;
+    case InputEvent::Type::MouseButton: {
+        for (auto& callback : m_mouseButtonCallbacks)
+            callback(event.key, event.action, event.mods);
+    } break;
+    case InputEvent::Type::MouseMove: {
+        for (auto& callback : m_mouseMoveCallbacks)
+            callback(event.value);
+    } break;
+    case InputEvent::Type::Scroll: {
+        for (auto& callback : m_scrollCallbacks)
+            callback(event.value);
+    } break;
+    case InputEvent::Type::WindowResize: {
+        for (const auto& callback : m_windowResizeCallbacks)
+            callback(glm::ivec2(event.value));
+    } break;
+    };
+}
+
+const Window::InputState& Window::getInputState() const
+{
+    return m_inputState;
 }
 
 bool Window::isKeyPressed(int key) const
 {
-    return glfwGetKey(m_pWindow, key) == GLFW_PRESS;
+    return m_pWindow && glfwGetKey(m_pWindow, key) == GLFW_PRESS;
 }
 
 bool Window::isMouseButtonPressed(int button) const
 {
-    return glfwGetMouseButton(m_pWindow, button) == GLFW_PRESS;
+    return m_pWindow && glfwGetMouseButton(m_pWindow, button) == GLFW_PRESS;
 }
 
 glm::vec2 Window::getCursorPos() const
 {
+    if (!m_pWindow)
+        return glm::vec2(0.0f);
     double x, y;
     glfwGetCursorPos(m_pWindow, &x, &y);
     return glm::vec2(x, m_windowSize.y - 1 - y);
@@ -402,6 +739,8 @@ glm::vec2 Window::getCursorPixel() const
     // https://stackoverflow.com/questions/45796287/screen-coordinates-to-world-coordinates
     // Coordinates returned by glfwGetCursorPos are in screen coordinates which may not map 1:1 to
     // pixel coordinates on some machines (e.g. with resolution scaling).
+    if (!m_pWindow)
+        return glm::vec2(0.5f);
     glm::ivec2 screenSize;
     glfwGetWindowSize(m_pWindow, &screenSize.x, &screenSize.y);
     glm::ivec2 framebufferSize;
@@ -418,13 +757,47 @@ glm::vec2 Window::getCursorPixel() const
 
 void Window::setMouseCapture(bool capture)
 {
+    if (!m_presentable)
+        return;
     if (capture) {
         glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        // Raw motion skips the pointer acceleration of the OS, which is meant for pointing rather than for turning.
+        m_rawMouseMotion = glfwRawMouseMotionSupported() == GLFW_TRUE;
+        if (m_rawMouseMotion)
+            glfwSetInputMode(m_pWindow, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
     } else {
+        if (m_rawMouseMotion)
+            glfwSetInputMode(m_pWindow, GLFW_RAW_MOUSE_MOTION, GLFW_FALSE);
+        m_rawMouseMotion = false;
         glfwSetInputMode(m_pWindow, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
+    m_mouseCaptured = capture;
 
     glfwPollEvents();
+    // Changing the cursor mode moves the cursor, which is not motion of the mouse.
+    m_lastCursorPos = getCursorPos();
+    m_mouseMotion = {};
+}
+
+bool Window::isMouseCaptured() const
+{
+    return m_mouseCaptured;
+}
+
+bool Window::usesRawMouseMotion() const
+{
+    return m_rawMouseMotion;
+}
+
+Window::MouseMotion Window::consumeMouseMotion()
+{
+    return std::exchange(m_mouseMotion, {});
+}
+
+void Window::sampleInput()
+{
+    if (m_pWindow)
+        glfwPollEvents();
 }
 
 glm::ivec2 Window::getWindowSize() const
@@ -434,6 +807,8 @@ glm::ivec2 Window::getWindowSize() const
 
 glm::ivec2 Window::getFrameBufferSize() const
 {
+    if (!m_presentable)
+        return m_windowSize;
     glm::ivec2 out {};
     glfwGetFramebufferSize(m_pWindow, &out.x, &out.y);
     return out;
@@ -450,3 +825,13 @@ float Window::getDpiScalingFactor() const
 {
     return m_dpiScalingFactor;
 }
+
+bool Window::isHeadless() const
+{
+    return !m_presentable;
+}
+
+GLuint Window::getFramebuffer() const
+{
+    return m_headlessFramebuffer;
+}
@@ -0,0 +1,8 @@
+// Per-mesh material, bound by GPUMesh::bindMaterial()
+layout(std140) uniform Material // Must match the GPUMaterial defined in src/mesh.h
+{
+    vec3 kd;
+	vec3 ks;
+	float shininess;
+	float transparency;
+};
@@ -0,0 +1,50 @@
+#version 410
+#extension GL_ARB_bindless_texture : enable
+
+// Must match the constants in src/material_system.h
+#define MAX_MATERIALS 256
+#define MAX_TEXTURE_ARRAYS 8
+
+struct MaterialEntry // Must match the GPUMaterialEntry defined in src/material_system.h
+{
+    vec3 kd;
+    float shininess;
+    vec3 ks;
+    float transparency;
+    int textureArray;
+    int textureLayer;
+    uvec2 textureHandle;
+};
+
+layout(std140) uniform Materials
+{
+    MaterialEntry materials[MAX_MATERIALS];
+};
+
+#ifndef GL_ARB_bindless_texture
+uniform sampler2DArray materialTextures[MAX_TEXTURE_ARRAYS];
+#endif
+// Selects the material of the current draw; dynamically uniform so it may index the sampler array.
+uniform int materialIndex;
+
+in vec3 fragPosition;
+in vec3 fragNormal;
+in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    MaterialEntry material = materials[materialIndex];
+
+    vec3 kd = material.kd;
+    if (material.textureArray >= 0) {
+        vec3 texCoord = vec3(fragTexCoord, float(material.textureLayer));
+#ifdef GL_ARB_bindless_texture
+        kd = texture(sampler2DArray(material.textureHandle), texCoord).rgb;
+#else
+        kd = texture(materialTextures[material.textureArray], texCoord).rgb;
+#endif
+    }
+    fragColor = vec4(kd, 1);
+}
@@ -1,16 +1,13 @@
 #version 410
 
-layout(std140) uniform Material // Must match the GPUMaterial defined in src/mesh.h
-{
-    vec3 kd;
-	vec3 ks;
-	float shininess;
-	float transparency;
-};
+#include "material.glsl"
 
+// Variants are selected with defines injected by ShaderVariants (see ShaderFeature in src/application.cpp):
+//  HAS_TEXCOORDS: sample colorMap
+//  USE_MATERIAL:  output the diffuse material color for untextured meshes
+#ifdef HAS_TEXCOORDS
 uniform sampler2D colorMap;
-uniform bool hasTexCoords;
-uniform bool useMaterial;
+#endif
 
 in vec3 fragPosition;
 in vec3 fragNormal;
@@ -23,7 +20,11 @@ void main()
     vec3 normal = normalize(fragNormal);
 
 
-    if (hasTexCoords)       { fragColor = vec4(texture(colorMap, fragTexCoord).rgb, 1);}
-    else if (useMaterial)   { fragColor = vec4(kd, 1);}
-    else                    { fragColor = vec4(normal, 1); } // Output color value, change from (1, 0, 0) to something else
+#if defined(HAS_TEXCOORDS)
+    fragColor = vec4(texture(colorMap, fragTexCoord).rgb, 1);
+#elif defined(USE_MATERIAL)
+    fragColor = vec4(kd, 1);
+#else
+    fragColor = vec4(normal, 1); // Output color value, change from (1, 0, 0) to something else
+#endif
 }
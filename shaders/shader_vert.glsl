@@ -1,10 +1,13 @@
 #version 410
 
-uniform mat4 mvpMatrix;
-uniform mat4 modelMatrix;
-// Normals should be transformed differently than positions:
-// https://paroj.github.io/gltut/Illumination/Tut09%20Normal%20Transformation.html
-uniform mat3 normalModelMatrix;
+layout(std140) uniform DrawData // Must match the GPUDrawData defined in src/render_queue.h
+{
+    mat4 mvpMatrix;
+    mat4 modelMatrix;
+    // Normals should be transformed differently than positions:
+    // https://paroj.github.io/gltut/Illumination/Tut09%20Normal%20Transformation.html
+    mat3 normalModelMatrix;
+};
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
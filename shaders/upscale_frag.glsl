@@ -0,0 +1,34 @@
+#version 410
+
+uniform sampler2D sourceTexture;
+uniform vec2 uvMax; // Center of the last texel of the scene; the rest of the texture is not written.
+uniform vec2 texelSize;
+uniform float sharpness; // 0 is plain bilinear filtering.
+
+in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+vec3 source(vec2 texCoord)
+{
+    return texture(sourceTexture, min(texCoord, uvMax)).rgb;
+}
+
+void main()
+{
+    vec3 center = source(fragTexCoord);
+    if (sharpness <= 0) {
+        fragColor = vec4(center, 1);
+        return;
+    }
+
+    // Unsharp mask with the four neighbouring source texels, clamped to their range so that edges do not ring.
+    vec3 left = source(fragTexCoord - vec2(texelSize.x, 0));
+    vec3 right = source(fragTexCoord + vec2(texelSize.x, 0));
+    vec3 down = source(fragTexCoord - vec2(0, texelSize.y));
+    vec3 up = source(fragTexCoord + vec2(0, texelSize.y));
+    vec3 minColor = min(center, min(min(left, right), min(down, up)));
+    vec3 maxColor = max(center, max(max(left, right), max(down, up)));
+    vec3 sharpened = center + sharpness * (4 * center - left - right - down - up);
+    fragColor = vec4(clamp(sharpened, minColor, maxColor), 1);
+}
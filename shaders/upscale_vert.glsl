@@ -0,0 +1,14 @@
+#version 410
+
+// Scaled to the part of the render target that contains the scene.
+uniform vec2 uvScale;
+
+out vec2 fragTexCoord;
+
+void main()
+{
+    // A single triangle that covers the whole viewport; no vertex buffer needed.
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    fragTexCoord = position * uvScale;
+    gl_Position = vec4(position * 2 - 1, 0, 1);
+}
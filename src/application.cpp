@@ -1,10 +1,19 @@
 //#include "Image.h"
+#include "benchmark.h"
+#include "camera.h"
+#include "dynamic_resolution.h"
+#include "frustum_culler.h"
+#include "material_system.h"
 #include "mesh.h"
+#include "occlusion_culler.h"
+#include "render_queue.h"
+#include "render_target.h"
 #include "texture.h"
 // Always include window first (because it includes glfw, which includes GL which needs to be included AFTER glew).
 // Can't wait for modules to fix this stuff...
 #include <framework/disable_all_warnings.h>
 DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
 #include <glad/glad.h>
 // Include glad before glfw3
 #include <GLFW/glfw3.h>
@@ -15,18 +24,53 @@ DISABLE_WARNINGS_PUSH()
 #include <glm/mat4x4.hpp>
 #include <imgui/imgui.h>
 DISABLE_WARNINGS_POP()
+#include <framework/frame_allocator.h>
+#include <framework/frame_recorder.h>
+#include <framework/frame_scheduler.h>
+#include <framework/gpu_profiler.h>
+#include <framework/memory_tracker.h>
+#include <framework/profiler.h>
+#include <framework/render_thread.h>
 #include <framework/shader.h>
+#include <framework/shader_reloader.h>
+#include <framework/shader_variants.h>
 #include <framework/window.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <optional>
 #include <vector>
 
+// Feature bits of the default shader variants; bit i enables shaderFeatureDefines[i] in shaders/shader_frag.glsl.
+enum ShaderFeature : uint32_t {
+    ShaderFeatureTexCoords = 1 << 0,
+    ShaderFeatureMaterial = 1 << 1,
+};
+static const std::vector<std::string> shaderFeatureDefines { "HAS_TEXCOORDS", "USE_MATERIAL" };
+static constexpr uint32_t numShaderVariants = 1 << 2; // One per combination of ShaderFeature bits.
+// Only the largest meshes of the scene are rasterized by the occlusion culler, as simplified proxies of at most
+// maxOccluderTriangles triangles each.
+static constexpr size_t maxOccluders = 16;
+static constexpr size_t maxOccluderTriangles = 128;
+
 class Application {
 public:
-    Application()
-        : m_window("Final Project", glm::ivec2(1024, 1024), OpenGLVersion::GL41)
+    // Benchmarks and recordings render into an offscreen framebuffer of a hidden (or headless) window.
+    Application(const CommandLine& commandLine)
+        : m_window("Final Project", commandLine.resolution, OpenGLVersion::GL41, !commandLine.headless, !commandLine.benchmark && !commandLine.recording)
+        , m_useRenderThread(commandLine.renderThread)
+        , m_scene(commandLine.scene)
         , m_texture(RESOURCE_ROOT "resources/checkerboard.png")
+        , m_projectionMatrix(glm::perspective(glm::radians(80.0f), float(commandLine.resolution.x) / float(commandLine.resolution.y), 0.1f, m_farPlane))
     {
+        if (commandLine.dynamicResolutionTargetMs) {
+            m_dynamicResolutionSettings.enabled = true;
+            m_dynamicResolutionSettings.targetMs = *commandLine.dynamicResolutionTargetMs;
+        }
         m_window.registerKeyCallback([this](int key, int scancode, int action, int mods) {
             if (action == GLFW_PRESS)
                 onKeyPressed(key, mods);
@@ -41,18 +85,59 @@ public:
                 onMouseReleased(button, mods);
         });
 
-        m_meshes = GPUMesh::loadMeshGPU(RESOURCE_ROOT "resources/dragon.obj");
+        const std::vector<Mesh> cpuMeshes = loadMesh(m_scene);
+        AxisAlignedBox sceneBox { .lower = glm::vec3(std::numeric_limits<float>::max()), .upper = glm::vec3(std::numeric_limits<float>::lowest()) };
+        for (const Mesh& cpuMesh : cpuMeshes) {
+            m_meshes.emplace_back(cpuMesh, fmt::format("{}#{}", m_scene.filename().string(), m_meshes.size()));
+            m_meshMaterials.push_back(m_materialSystem.addMaterial(cpuMesh.material));
+
+            const AxisAlignedBox meshBox = transformBoundingBox(m_meshes.back().boundingBox(), m_modelMatrix);
+            sceneBox.lower = glm::min(sceneBox.lower, meshBox.lower);
+            sceneBox.upper = glm::max(sceneBox.upper, meshBox.upper);
+        }
+        addOccluders(cpuMeshes);
+        if (!m_meshes.empty()) {
+            m_sceneBounds = { .center = (sceneBox.lower + sceneBox.upper) * 0.5f, .radius = glm::distance(sceneBox.lower, sceneBox.upper) * 0.5f };
+            m_cameraSpeed = 0.5f * m_sceneBounds.radius;
+        }
+        m_materialSystem.upload();
+        m_renderBackend.setMaterialSystem(&m_materialSystem);
 
         try {
-            ShaderBuilder defaultBuilder;
-            defaultBuilder.addStage(GL_VERTEX_SHADER, RESOURCE_ROOT "shaders/shader_vert.glsl");
-            defaultBuilder.addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT "shaders/shader_frag.glsl");
-            m_defaultShader = defaultBuilder.build();
+            // Reuse linked programs from previous runs; they are recompiled when a shader source or the driver changes.
+            ShaderBuilder::setBinaryCacheDirectory(std::filesystem::temp_directory_path() / "Master_TechDemo_shader_cache");
+            // Refuse to build programs whose uniform blocks do not match the structs that are uploaded to them.
+            ShaderBuilder::registerUniformBlockLayout(GPUMaterial::uniformBlockLayout);
+            ShaderBuilder::registerUniformBlockLayout(GPUMaterialEntry::uniformBlockLayout);
+            ShaderBuilder::registerUniformBlockLayout(GPUDrawData::uniformBlockLayout);
 
-            ShaderBuilder shadowBuilder;
-            shadowBuilder.addStage(GL_VERTEX_SHADER, RESOURCE_ROOT "shaders/shadow_vert.glsl");
-            shadowBuilder.addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT "Shaders/shadow_frag.glsl");
-            m_shadowShader = shadowBuilder.build();
+            m_defaultShaders = ShaderVariants(
+                { { GL_VERTEX_SHADER, RESOURCE_ROOT "shaders/shader_vert.glsl" }, { GL_FRAGMENT_SHADER, RESOURCE_ROOT "shaders/shader_frag.glsl" } },
+                shaderFeatureDefines);
+            // Compile all variants in parallel (if supported by the driver) while the rest is set up.
+            for (uint32_t features = 0; features < numShaderVariants; ++features)
+                m_defaultShaders.prefetch(features);
+            m_defaultShaders.setReloader(&m_shaderReloader);
+
+            // The builders are kept by the reloader to rebuild the shaders when their source files change.
+            buildShader(m_shadowShader, []() {
+                ShaderBuilder builder;
+                builder.addStage(GL_VERTEX_SHADER, RESOURCE_ROOT "shaders/shadow_vert.glsl");
+                builder.addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT "shaders/shadow_frag.glsl");
+                return builder;
+            });
+            buildShader(m_materialShader, []() {
+                ShaderBuilder builder;
+                builder.addStage(GL_VERTEX_SHADER, RESOURCE_ROOT "shaders/shader_vert.glsl");
+                builder.addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT "shaders/material_frag.glsl");
+                return builder;
+            });
+            buildShader(m_upscaleShader, []() {
+                ShaderBuilder builder;
+                builder.addStage(GL_VERTEX_SHADER, RESOURCE_ROOT "shaders/upscale_vert.glsl");
+                builder.addStage(GL_FRAGMENT_SHADER, RESOURCE_ROOT "shaders/upscale_frag.glsl");
+                return builder;
+            });
 
             // Any new shaders can be added below in similar fashion.
             // ==> Don't forget to reconfigure CMake when you do!
@@ -66,112 +151,637 @@ public:
 
     void update()
     {
-        int dummyInteger = 0; // Initialized to 0
+        if (m_useRenderThread) {
+            updateWithRenderThread();
+            return;
+        }
+
         while (!m_window.shouldClose()) {
+            // Waits for the frame rate limit (if any) before input is polled.
+            const uint32_t numSimulationSteps = m_frameScheduler.beginFrame();
+            // Collect the zones of the previous frame before this frame's zone starts.
+            GpuProfiler::get().endFrame();
+            Profiler::get().endFrame();
+            PROFILE_SCOPE("Application::update");
+
             // This is your game loop
             // Put your real-time logic and rendering in here
             m_window.updateInput();
+            // Pick up edited shader files; the old programs stay in use until the new ones compiled successfully.
+            m_shaderReloader.update();
 
-            // Use ImGui for easy input/output of ints, floats, strings, etc...
-            ImGui::Begin("Window");
-            ImGui::InputInt("This is an integer input", &dummyInteger); // Use ImGui::DragInt or ImGui::DragFloat for larger range of numbers.
-            ImGui::Text("Value is: %i", dummyInteger); // Use C printf formatting rules (%i is a signed integer)
-            ImGui::Checkbox("Use material if no texture", &m_useMaterial);
-            ImGui::End();
+            // Animations advance in fixed steps and are rendered in between the last two steps.
+            for (uint32_t step = 0; step < numSimulationSteps; ++step)
+                simulate(float(m_frameScheduler.fixedTimestep()));
 
-            // Clear the screen
-            glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawUi();
+            updateCamera();
+            renderScene(m_window.getFramebuffer());
 
-            // ...
-            glEnable(GL_DEPTH_TEST);
-
-            const glm::mat4 mvpMatrix = m_projectionMatrix * m_viewMatrix * m_modelMatrix;
-            // Normals should be transformed differently than positions (ignoring translations + dealing with scaling):
-            // https://paroj.github.io/gltut/Illumination/Tut09%20Normal%20Transformation.html
-            const glm::mat3 normalModelMatrix = glm::inverseTranspose(glm::mat3(m_modelMatrix));
-
-            for (GPUMesh& mesh : m_meshes) {
-                m_defaultShader.bind();
-                glUniformMatrix4fv(m_defaultShader.getUniformLocation("mvpMatrix"), 1, GL_FALSE, glm::value_ptr(mvpMatrix));
-                //Uncomment this line when you use the modelMatrix (or fragmentPosition)
-                //glUniformMatrix4fv(m_defaultShader.getUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_modelMatrix));
-                glUniformMatrix3fv(m_defaultShader.getUniformLocation("normalModelMatrix"), 1, GL_FALSE, glm::value_ptr(normalModelMatrix));
-                if (mesh.hasTextureCoords()) {
-                    m_texture.bind(GL_TEXTURE0);
-                    glUniform1i(m_defaultShader.getUniformLocation("colorMap"), 0);
-                    glUniform1i(m_defaultShader.getUniformLocation("hasTexCoords"), GL_TRUE);
-                    glUniform1i(m_defaultShader.getUniformLocation("useMaterial"), GL_FALSE);
-                } else {
-                    glUniform1i(m_defaultShader.getUniformLocation("hasTexCoords"), GL_FALSE);
-                    glUniform1i(m_defaultShader.getUniformLocation("useMaterial"), m_useMaterial);
-                }
-                mesh.draw(m_defaultShader);
+            // Processes input and swaps the window buffer
+            m_window.swapBuffers();
+        }
+    }
+
+    // Render a fixed camera path offscreen with vsync disabled and write the frame time statistics to a JSON file.
+    // Returns false if the report could not be written.
+    bool runBenchmark(const BenchmarkSettings& settings)
+    {
+        m_window.setVsync(false);
+        RenderTarget renderTarget { m_window.getFrameBufferSize() };
+        // Do not measure asynchronous shader compilation; otherwise the first frames would skip meshes.
+        for (uint32_t features = 0; features < numShaderVariants; ++features)
+            (void)m_defaultShaders.get(features);
+
+        BenchmarkReport report {
+            .scene = m_scene.string(),
+            .resolution = renderTarget.size(),
+            .renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+            .numWarmupFrames = settings.numWarmupFrames
+        };
+        report.frameTimesMs.reserve(settings.numFrames);
+        float renderScaleSum = 0.0f;
+
+        // With a render thread the frame time is the time between two submitted frames, which includes waiting for
+        // the render thread, so it measures the throughput of the overlapped pipeline.
+        std::optional<RenderThread> renderThread;
+        if (m_useRenderThread) {
+            for (RenderPacket& packet : m_renderPackets)
+                refreshShaderTable(packet);
+            renderThread.emplace(m_window, [&](uint32_t packetIndex) {
+                GpuProfiler::get().endFrame();
+                PROFILE_SCOPE("Render thread");
+                RenderPacket& packet = m_renderPackets[packetIndex];
+                refreshShaderTable(packet);
+                renderFrame(packet, renderTarget.framebuffer());
+                glBindFramebuffer(GL_FRAMEBUFFER, m_window.getFramebuffer());
+                m_window.renderImGui(packet.ui.drawData());
+                m_window.present();
+                glFinish();
+            });
+        }
+
+        const uint32_t numFrames = settings.numWarmupFrames + settings.numFrames;
+        for (uint32_t frame = 0; frame < numFrames && !m_window.shouldClose(); ++frame) {
+            const auto start = std::chrono::steady_clock::now();
+            if (!renderThread)
+                GpuProfiler::get().endFrame();
+            Profiler::get().endFrame();
+            PROFILE_SCOPE("Application::runBenchmark");
+
+            RenderPacket& packet = m_renderPackets[renderThread ? renderThread->beginPacket() : 0];
+            if (renderThread)
+                m_feedback = packet.feedback;
+            m_window.updateInput();
+            // The warmup frames fly along the same path, so the measured run covers the whole path exactly once.
+            const uint32_t pathFrame = frame < settings.numWarmupFrames ? frame : frame - settings.numWarmupFrames;
+            const uint32_t pathLength = frame < settings.numWarmupFrames ? settings.numWarmupFrames : settings.numFrames;
+            m_viewMatrix = benchmarkCameraView(m_sceneBounds, float(pathFrame) / float(pathLength));
+
+            if (renderThread) {
+                prepareFrame(packet);
+                if (!m_window.isHeadless())
+                    packet.ui.capture();
+                renderThread->submitPacket();
+            } else {
+                renderScene(renderTarget.framebuffer());
+                glBindFramebuffer(GL_FRAMEBUFFER, m_window.getFramebuffer());
+                m_window.swapBuffers();
+                // Wait for the GPU so that the frame time covers all work of this frame and not of the frames before it.
+                glFinish();
             }
 
-            // Processes input and swaps the window buffer
+            const auto end = std::chrono::steady_clock::now();
+            if (frame >= settings.numWarmupFrames) {
+                report.frameTimesMs.push_back(std::chrono::duration<float, std::milli>(end - start).count());
+                renderScaleSum += m_feedback.renderScale;
+            }
+        }
+        // Hand the context back before the render target is destroyed.
+        renderThread.reset();
+        if (!report.frameTimesMs.empty())
+            report.meanRenderScale = renderScaleSum / float(report.frameTimesMs.size());
+
+        std::cout << fmt::format("{} frames at {}x{} on {}: {:.1f} fps, p50/p95/p99 = {:.3f}/{:.3f}/{:.3f} ms",
+            report.frameTimesMs.size(), report.resolution.x, report.resolution.y, report.renderer, report.framesPerSecond(),
+            report.percentileMs(50.0f), report.percentileMs(95.0f), report.percentileMs(99.0f))
+                  << (m_dynamicResolutionSettings.enabled ? fmt::format(", mean render scale {:.2f}", report.meanRenderScale) : "")
+                  << std::endl;
+        if (!report.writeJson(settings.outputFile)) {
+            std::cerr << "Could not write benchmark report to " << settings.outputFile << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Render the benchmark camera path at a fixed timestep and write every frame to disk (see FrameRecorder).
+    // Returns false if the output could not be created.
+    bool runRecording(const RecordingSettings& settings)
+    {
+        m_window.setVsync(false);
+        RenderTarget renderTarget { m_window.getFrameBufferSize() };
+        // Every frame must show all meshes, so do not start before all shader variants are compiled.
+        for (uint32_t features = 0; features < numShaderVariants; ++features)
+            (void)m_defaultShaders.get(features);
+
+        std::optional<FrameRecorder> recorder;
+        try {
+            recorder.emplace(settings.outputPath, renderTarget.size(), settings.frameRate, settings.imageFormat);
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+
+        const float duration = float(settings.numFrames) / float(settings.frameRate);
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < settings.numFrames && !m_window.shouldClose(); ++frame) {
+            GpuProfiler::get().endFrame();
+            Profiler::get().endFrame();
+            PROFILE_SCOPE("Application::runRecording");
+
+            m_window.updateInput();
+            // Simulation time only depends on the frame number, not on how long rendering and encoding take.
+            const float time = float(frame) / float(settings.frameRate);
+            m_viewMatrix = benchmarkCameraView(m_sceneBounds, time / duration);
+
+            renderScene(renderTarget.framebuffer());
+            recorder->captureFrame();
+            glBindFramebuffer(GL_FRAMEBUFFER, m_window.getFramebuffer());
             m_window.swapBuffers();
+            recorder->poll();
         }
+        recorder->finish();
+
+        const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        std::cout << fmt::format("Recorded {} frames at {}x{} to {} in {:.1f} s ({:.1f} fps), waited {:.0f} ms for the encoders",
+            recorder->numFramesCaptured(), renderTarget.size().x, renderTarget.size().y, settings.outputPath.string(), seconds,
+            float(recorder->numFramesCaptured()) / seconds, recorder->backpressureMs())
+                  << std::endl;
+        return true;
     }
 
     // In here you can handle key presses
     // key - Integer that corresponds to numbers in https://www.glfw.org/docs/latest/group__keys.html
     // mods - Any modifier keys pressed, like shift or control
-    void onKeyPressed(int key, int mods)
+    void onKeyPressed([[maybe_unused]] int key, [[maybe_unused]] int mods)
     {
-        std::cout << "Key pressed: " << key << std::endl;
     }
 
     // In here you can handle key releases
     // key - Integer that corresponds to numbers in https://www.glfw.org/docs/latest/group__keys.html
     // mods - Any modifier keys pressed, like shift or control
-    void onKeyReleased(int key, int mods)
+    void onKeyReleased([[maybe_unused]] int key, [[maybe_unused]] int mods)
     {
-        std::cout << "Key released: " << key << std::endl;
     }
 
-    // If the mouse is moved this function will be called with the x, y screen-coordinates of the mouse
-    void onMouseMove(const glm::dvec2& cursorPos)
+    // If the mouse is moved this function will be called with the x, y screen-coordinates of the mouse. Moves are
+    // coalesced by the window, so this is called at most once between other input events (usually once per frame);
+    // m_window.getInputState() has the total movement of the frame.
+    void onMouseMove([[maybe_unused]] const glm::dvec2& cursorPos)
     {
-        std::cout << "Mouse at position: " << cursorPos.x << " " << cursorPos.y << std::endl;
     }
 
     // If one of the mouse buttons is pressed this function will be called
     // button - Integer that corresponds to numbers in https://www.glfw.org/docs/latest/group__buttons.html
     // mods - Any modifier buttons pressed
-    void onMouseClicked(int button, int mods)
+    void onMouseClicked(int button, [[maybe_unused]] int mods)
     {
-        std::cout << "Pressed mouse button: " << button << std::endl;
+        // Look around while the right mouse button is held.
+        if (button == GLFW_MOUSE_BUTTON_RIGHT)
+            m_window.setMouseCapture(true);
     }
 
     // If one of the mouse buttons is released this function will be called
     // button - Integer that corresponds to numbers in https://www.glfw.org/docs/latest/group__buttons.html
     // mods - Any modifier buttons pressed
-    void onMouseReleased(int button, int mods)
+    void onMouseReleased(int button, [[maybe_unused]] int mods)
     {
-        std::cout << "Released mouse button: " << button << std::endl;
+        if (button == GLFW_MOUSE_BUTTON_RIGHT)
+            m_window.setMouseCapture(false);
+    }
+
+private:
+    // State of the GL side that the UI shows; copied because the objects it comes from live on the render thread.
+    struct RenderFeedback {
+        RenderStats renderStats;
+        size_t numCompiledVariants { 0 };
+        size_t numPendingVariants { 0 };
+        size_t numShaderReloads { 0 };
+        std::vector<ShaderReloader::Error> shaderErrors;
+        float renderScale { 1.0f };
+        glm::ivec2 renderSize { 0 };
+        std::optional<float> sceneGpuMs; // Smoothed, as used by the dynamic resolution controller.
+        bool materialShaderValid { false };
+    };
+
+    // Everything the render thread needs to draw one frame. The main thread fills a packet while the render thread
+    // draws the other one (see RenderThread); without a render thread only the first packet is used.
+    struct RenderPacket {
+        // Written by the main thread.
+        RenderQueue renderQueue;
+        glm::mat4 viewProjectionMatrix { 1.0f };
+        ImGuiDrawSnapshot ui;
+        // Pixels of the output framebuffer; queried on the main thread because GLFW only allows that there.
+        glm::ivec2 framebufferSize { 0 };
+        DynamicResolution::Settings dynamicResolution;
+
+        // Written by the render thread and read by the main thread when it fills the packet again.
+        std::array<const Shader*, numShaderVariants> shaderTable {}; // Compiled default shader variants, or null.
+        const Shader* pMaterialShader { nullptr }; // Null if the material shader failed to build.
+        RenderFeedback feedback;
+    };
+
+    // Main loop with all OpenGL work on a render thread, one frame behind simulation, culling and UI.
+    void updateWithRenderThread()
+    {
+        for (RenderPacket& packet : m_renderPackets)
+            refreshShaderTable(packet);
+        RenderThread renderThread { m_window, [this](uint32_t packetIndex) {
+            GpuProfiler::get().endFrame();
+            PROFILE_SCOPE("Render thread");
+            // Shader programs are GL objects, so they are reloaded on the render thread.
+            m_shaderReloader.update();
+
+            RenderPacket& packet = m_renderPackets[packetIndex];
+            refreshShaderTable(packet);
+            renderFrame(packet, m_window.getFramebuffer());
+            m_window.renderImGui(packet.ui.drawData());
+            m_window.present();
+        } };
+        m_pRenderThread = &renderThread;
+
+        while (!m_window.shouldClose()) {
+            const uint32_t numSimulationSteps = m_frameScheduler.beginFrame();
+            Profiler::get().endFrame();
+            PROFILE_SCOPE("Application::updateWithRenderThread");
+
+            // Waits until the render thread is done with the packet that it drew two frames ago.
+            RenderPacket& packet = m_renderPackets[renderThread.beginPacket()];
+            m_feedback = packet.feedback;
+
+            m_window.updateInput();
+            for (uint32_t step = 0; step < numSimulationSteps; ++step)
+                simulate(float(m_frameScheduler.fixedTimestep()));
+
+            drawUi();
+            updateCamera();
+            prepareFrame(packet);
+            packet.ui.capture();
+            renderThread.submitPacket();
+        }
+        m_pRenderThread = nullptr;
+    }
+
+    // Register simplified versions of the largest meshes (by world space bounding sphere) with the occlusion culler.
+    // Small meshes hide little and would only add triangles to rasterize. The simplification grid is made coarser
+    // until a proxy fits the triangle budget.
+    void addOccluders(const std::vector<Mesh>& cpuMeshes)
+    {
+        std::vector<size_t> meshIndices(m_meshes.size());
+        std::iota(std::begin(meshIndices), std::end(meshIndices), size_t(0));
+        const auto worldRadius = [&](size_t meshIndex) { return transformBoundingSphere(m_meshes[meshIndex].boundingSphere(), m_modelMatrix).radius; };
+        const size_t numOccluders = std::min(maxOccluders, meshIndices.size());
+        std::partial_sort(std::begin(meshIndices), std::begin(meshIndices) + std::ptrdiff_t(numOccluders), std::end(meshIndices),
+            [&](size_t lhs, size_t rhs) { return worldRadius(lhs) > worldRadius(rhs); });
+        for (size_t i = 0; i < numOccluders; ++i) {
+            const Mesh& mesh = cpuMeshes[meshIndices[i]];
+            Mesh proxy = simplifyOccluder(mesh, 16);
+            for (int gridResolution = 8; gridResolution >= 2 && proxy.triangles.size() > maxOccluderTriangles; gridResolution /= 2)
+                proxy = simplifyOccluder(mesh, gridResolution);
+            m_occlusionCuller.addOccluder(proxy, m_modelMatrix);
+        }
+    }
+
+    // Build a shader and rebuild it when its source files change. Failures are reported per shader, so that a broken
+    // shader does not keep the shaders after it from being built.
+    void buildShader(Shader& shader, const ShaderReloader::BuilderFactory& makeBuilder)
+    {
+        try {
+            shader = makeBuilder().build();
+            m_shaderReloader.add(shader, makeBuilder);
+        } catch (const ShaderLoadingException& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    // Advance all animations by one fixed timestep (see FrameScheduler).
+    void simulate(float timestep)
+    {
+        m_previousCameraOrbit = m_cameraOrbit;
+        if (!m_animateCamera)
+            return;
+        m_cameraOrbit += timestep / m_cameraOrbitPeriod;
+        // The camera path is periodic, so wrap both states to keep the precision of the orbit parameter.
+        if (m_cameraOrbit >= 1.0f) {
+            m_cameraOrbit -= 1.0f;
+            m_previousCameraOrbit -= 1.0f;
+        }
+    }
+
+    // Apply the camera input as late as possible, right before the view matrix is used for culling and rendering, so
+    // that input that arrived while the frame was being prepared is not shown a frame later than necessary.
+    void updateCamera()
+    {
+        if (m_animateCamera) {
+            m_viewMatrix = benchmarkCameraView(m_sceneBounds, glm::mix(m_previousCameraOrbit, m_cameraOrbit, m_frameScheduler.interpolationAlpha()));
+            return;
+        }
+
+        m_window.sampleInput();
+        const Window::MouseMotion mouseMotion = m_window.consumeMouseMotion();
+        if (m_window.isMouseCaptured())
+            m_camera.rotate(mouseMotion.delta);
+        m_camera.zoom(m_window.getInputState().scrollDelta.y);
+
+        if (!ImGui::GetIO().WantCaptureKeyboard) {
+            const auto axis = [&](int positiveKey, int negativeKey) {
+                return float(m_window.isKeyPressed(positiveKey)) - float(m_window.isKeyPressed(negativeKey));
+            };
+            const glm::vec3 direction { axis(GLFW_KEY_D, GLFW_KEY_A), axis(GLFW_KEY_E, GLFW_KEY_Q), axis(GLFW_KEY_W, GLFW_KEY_S) };
+            if (direction != glm::vec3(0.0f))
+                m_camera.move(glm::normalize(direction) * m_cameraSpeed * float(m_frameScheduler.deltaTime()));
+        }
+        m_viewMatrix = m_camera.viewMatrix();
+
+        m_numMouseSamples = mouseMotion.numSamples;
+        if (mouseMotion.numSamples > 0)
+            m_oldestMouseSampleMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - mouseMotion.firstSampleTime).count();
+    }
+
+    void drawUi()
+    {
+        // Use ImGui for easy input/output of ints, floats, strings, etc...
+        ImGui::Begin("Window");
+        ImGui::InputInt("This is an integer input", &m_dummyInteger); // Use ImGui::DragInt or ImGui::DragFloat for larger range of numbers.
+        ImGui::Text("Value is: %i", m_dummyInteger); // Use C printf formatting rules (%i is a signed integer)
+        ImGui::Checkbox("Use material if no texture", &m_useMaterial);
+        ImGui::Checkbox("Animate camera", &m_animateCamera);
+        if (!m_animateCamera) {
+            int cameraMode = int(m_camera.mode());
+            if (ImGui::Combo("Camera", &cameraMode, "First person\0Third person\0"))
+                m_camera.setMode(Camera::Mode(cameraMode));
+            ImGui::TextUnformatted("Hold the right mouse button to look around, WASD/QE to move.");
+            ImGui::Text("Mouse samples in the last frame: %u, oldest %.2f ms before use%s", m_numMouseSamples, double(m_oldestMouseSampleMs), m_window.usesRawMouseMotion() ? " (raw)" : "");
+        }
+        ImGui::Text("Shader variants compiled/pending: %zu/%zu", m_feedback.numCompiledVariants, m_feedback.numPendingVariants);
+        ImGui::Text("Shader reloads: %zu", m_feedback.numShaderReloads);
+        for (const ShaderReloader::Error& error : m_feedback.shaderErrors) {
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
+            ImGui::TextWrapped("%s", error.log.c_str());
+            ImGui::PopStyleColor();
+        }
+        ImGui::BeginDisabled(!m_feedback.materialShaderValid);
+        ImGui::Checkbox("Batched material system", &m_useMaterialSystem);
+        ImGui::EndDisabled();
+        if (!m_feedback.materialShaderValid)
+            ImGui::TextUnformatted("The material shader failed to build; see the console.");
+        else if (m_useMaterialSystem)
+            ImGui::Text("%zu materials in %zu texture arrays%s", m_materialSystem.numMaterials(), m_materialSystem.numTextureArrays(), m_materialSystem.usesBindlessTextures() ? " (bindless)" : "");
+        ImGui::Separator();
+        const RenderStats& renderStats = m_feedback.renderStats;
+        ImGui::Text("Draws: %u", renderStats.numDraws);
+        ImGui::Text("Binds (shader/material/texture/VAO): %u/%u/%u/%u", renderStats.shaderBinds, renderStats.materialBinds, renderStats.textureBinds, renderStats.vaoBinds);
+        ImGui::Text("State changes avoided: %u", renderStats.stateChangesAvoided());
+        ImGui::Text("Render queue sort: %.3f ms", double(m_lastSortTimeMs));
+        if (m_pRenderThread)
+            ImGui::Text("Render thread wait (main/render): %.2f/%.2f ms", double(m_pRenderThread->mainThreadWaitMs()), double(m_pRenderThread->renderThreadWaitMs()));
+        ImGui::Text("Input events received/dispatched: %u/%u", m_window.getInputState().numEvents, m_window.getInputState().numDispatchedEvents);
+        ImGui::Separator();
+        ImGui::Checkbox("Dynamic resolution", &m_dynamicResolutionSettings.enabled);
+        if (m_dynamicResolutionSettings.enabled) {
+            ImGui::SliderFloat("Target scene GPU time (ms)", &m_dynamicResolutionSettings.targetMs, 1.0f, 50.0f);
+            ImGui::SliderFloat("Minimum scale", &m_dynamicResolutionSettings.minScale, 0.25f, 1.0f);
+            ImGui::SliderFloat("Sharpness", &m_dynamicResolutionSettings.sharpness, 0.0f, 1.0f);
+            // The framebuffer is in pixels, so on HighDPI displays it is larger than the window; the UI is drawn at
+            // the full resolution after upscaling.
+            const glm::ivec2 outputSize = m_window.getFrameBufferSize();
+            ImGui::Text("Scene %dx%d of %dx%d pixels (%.0f%%), DPI scale %.2f", m_feedback.renderSize.x, m_feedback.renderSize.y,
+                outputSize.x, outputSize.y, 100.0 * double(m_feedback.renderScale), double(m_window.getDpiScalingFactor()));
+            if (m_feedback.sceneGpuMs)
+                ImGui::Text("Scene GPU time: %.2f ms", double(*m_feedback.sceneGpuMs));
+            else
+                ImGui::TextUnformatted("Scene GPU time: not measured yet");
+        }
+        ImGui::Separator();
+        ImGui::Checkbox("Frustum culling", &m_enableFrustumCulling);
+        if (m_enableFrustumCulling)
+            ImGui::Text("Visible/culled: %zu/%zu", m_frustumCuller.numVisible(), m_frustumCuller.numObjects() - m_frustumCuller.numVisible());
+        ImGui::Checkbox("Occlusion culling", &m_enableOcclusionCulling);
+        if (m_enableOcclusionCulling)
+            ImGui::Text("Occluded: %zu", m_numOccluded);
+        ImGui::End();
+        m_frameScheduler.drawImGui();
+        Profiler::get().drawImGui();
+        GpuProfiler::get().drawImGui();
+        MemoryTracker::get().drawImGui();
+        FrameAllocator::get().drawImGui();
+    }
+
+    // Cull, sort and draw the scene into the given framebuffer, which must have the size of the window's framebuffer.
+    void renderScene(GLuint framebuffer)
+    {
+        RenderPacket& packet = m_renderPackets[0];
+        refreshShaderTable(packet);
+        prepareFrame(packet);
+        renderFrame(packet, framebuffer);
+        m_feedback = packet.feedback;
+    }
+
+    // Look up which default shader variants have finished compiling; polls the driver, so only on the GL thread.
+    // Shaders are replaced by reloads on that thread as well.
+    void refreshShaderTable(RenderPacket& packet)
+    {
+        for (uint32_t features = 0; features < numShaderVariants; ++features)
+            packet.shaderTable[features] = m_defaultShaders.tryGet(features);
+        packet.pMaterialShader = m_materialShader.isValid() ? &m_materialShader : nullptr;
+    }
+
+    // Cull the scene and record the visible draws into the render queue of the packet. Makes no OpenGL calls.
+    void prepareFrame(RenderPacket& packet)
+    {
+        PROFILE_FUNCTION();
+        // Test the world space bounds of all meshes against the view frustum.
+        const glm::mat4 viewProjectionMatrix = m_projectionMatrix * m_viewMatrix;
+        packet.viewProjectionMatrix = viewProjectionMatrix;
+        packet.framebufferSize = m_window.getFrameBufferSize();
+        packet.dynamicResolution = m_dynamicResolutionSettings;
+        {
+            PROFILE_SCOPE("Frustum culling");
+            m_frustumCuller.clear();
+            for (const GPUMesh& mesh : m_meshes)
+                m_frustumCuller.add(transformBoundingBox(mesh.boundingBox(), m_modelMatrix), transformBoundingSphere(mesh.boundingSphere(), m_modelMatrix));
+            if (m_enableFrustumCulling)
+                m_frustumCuller.cull(viewProjectionMatrix);
+        }
+        // Rasterize the occluders into the CPU depth pyramid.
+        if (m_enableOcclusionCulling)
+            m_occlusionCuller.render(viewProjectionMatrix);
+        m_numOccluded = 0;
+
+        // Record all visible draws into the render queue; they are sorted by state and depth before submission.
+        const glm::vec3 cameraPosition = glm::inverse(m_viewMatrix)[3];
+        RenderQueue& renderQueue = packet.renderQueue;
+        renderQueue.clear();
+        for (size_t meshIndex = 0; meshIndex < m_meshes.size(); ++meshIndex) {
+            if (m_enableFrustumCulling && !m_frustumCuller.isVisible(meshIndex))
+                continue;
+
+            const GPUMesh& mesh = m_meshes[meshIndex];
+            if (m_enableOcclusionCulling && m_occlusionCuller.isOccluded(transformBoundingBox(mesh.boundingBox(), m_modelMatrix))) {
+                ++m_numOccluded;
+                continue;
+            }
+
+            DrawItem item {
+                .pMesh = &mesh,
+                .pTexture = mesh.hasTextureCoords() ? &m_texture : nullptr,
+                .modelMatrix = m_modelMatrix
+            };
+            // The default shader variants stand in for the material shader if that failed to build.
+            if (!m_useMaterialSystem || !packet.pMaterialShader) {
+                uint32_t features = 0;
+                if (item.pTexture)
+                    features |= ShaderFeatureTexCoords;
+                if (m_useMaterial)
+                    features |= ShaderFeatureMaterial;
+                // Meshes are skipped until their variant has finished compiling.
+                item.pShader = packet.shaderTable[features];
+                if (!item.pShader)
+                    continue;
+            } else {
+                // All materials and their textures are resident at once; only the material index changes per draw.
+                item.pShader = packet.pMaterialShader;
+                item.pTexture = nullptr;
+                item.materialIndex = m_meshMaterials[meshIndex];
+            }
+            const glm::vec3 worldCenter = m_modelMatrix * glm::vec4(mesh.boundingSphere().center, 1.0f);
+            const float depth = glm::distance(cameraPosition, worldCenter) / m_farPlane;
+            renderQueue.push(RenderPass::Opaque, item, depth);
+        }
+        renderQueue.sort();
+        m_lastSortTimeMs = renderQueue.lastSortTimeMs();
+    }
+
+    // Draw the render queue of the packet into the given framebuffer, at a lower resolution and upscaled if dynamic
+    // resolution is enabled. Leaves the framebuffer bound for the UI; GL thread only.
+    void renderFrame(RenderPacket& packet, GLuint framebuffer)
+    {
+        const glm::ivec2 outputSize = packet.framebufferSize;
+        const bool dynamicResolution = packet.dynamicResolution.enabled;
+        if (dynamicResolution) {
+            m_dynamicResolution.beginScene(packet.dynamicResolution, m_upscaleShader, framebuffer, outputSize);
+        } else {
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glViewport(0, 0, outputSize.x, outputSize.y);
+        }
+
+        // Clear the screen
+        {
+            GPU_PROFILE_SCOPE("Clear");
+            glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+
+        // ...
+        glEnable(GL_DEPTH_TEST);
+        {
+            GPU_PROFILE_SCOPE("Main pass");
+            m_renderBackend.submit(packet.renderQueue, packet.viewProjectionMatrix);
+        }
+
+        if (dynamicResolution)
+            m_dynamicResolution.endScene();
+
+        RenderFeedback& feedback = packet.feedback;
+        feedback.renderStats = m_renderBackend.stats();
+        feedback.numCompiledVariants = m_defaultShaders.numCompiledVariants();
+        feedback.numPendingVariants = m_defaultShaders.numPendingVariants();
+        feedback.numShaderReloads = m_shaderReloader.numReloads();
+        feedback.shaderErrors = m_shaderReloader.errors();
+        feedback.renderScale = dynamicResolution ? m_dynamicResolution.scale() : 1.0f;
+        feedback.renderSize = dynamicResolution ? m_dynamicResolution.renderSize() : outputSize;
+        feedback.sceneGpuMs = m_dynamicResolution.gpuTimeMs();
+        feedback.materialShaderValid = packet.pMaterialShader != nullptr;
     }
 
 private:
     Window m_window;
+    FrameScheduler m_frameScheduler { &m_window };
+    const bool m_useRenderThread;
+    const RenderThread* m_pRenderThread { nullptr }; // Set while the render thread is running.
+    // Declared before the shaders so that it is destroyed after them.
+    ShaderReloader m_shaderReloader;
 
-    // Shader for default rendering and for depth rendering
-    Shader m_defaultShader;
+    // Shader variants for default rendering (see ShaderFeature) and shader for depth rendering
+    ShaderVariants m_defaultShaders;
     Shader m_shadowShader;
+    // Shader that reads all materials from the material system
+    Shader m_materialShader;
+    // Upscales the scene when it is rendered at a lower resolution
+    Shader m_upscaleShader;
 
+    std::filesystem::path m_scene;
     std::vector<GPUMesh> m_meshes;
+    BoundingSphere m_sceneBounds;
     Texture m_texture;
     bool m_useMaterial { true };
 
+    MaterialSystem m_materialSystem;
+    std::vector<uint32_t> m_meshMaterials; // Material system index of each mesh
+    bool m_useMaterialSystem { false };
+
+    std::array<RenderPacket, RenderThread::numPackets> m_renderPackets;
+    RenderFeedback m_feedback; // Of the last rendered frame, for the UI.
+    float m_lastSortTimeMs { 0.0f };
+    RenderBackend m_renderBackend;
+    DynamicResolution m_dynamicResolution; // Only used on the GL thread.
+    DynamicResolution::Settings m_dynamicResolutionSettings;
+    FrustumCuller m_frustumCuller;
+    bool m_enableFrustumCulling { true };
+    OcclusionCuller m_occlusionCuller;
+    bool m_enableOcclusionCulling { true };
+    size_t m_numOccluded { 0 };
+
     // Projection and view matrices for you to fill in and use
-    glm::mat4 m_projectionMatrix = glm::perspective(glm::radians(80.0f), 1.0f, 0.1f, 30.0f);
+    float m_farPlane { 30.0f };
+    glm::mat4 m_projectionMatrix;
     glm::mat4 m_viewMatrix = glm::lookAt(glm::vec3(-1, 1, -1), glm::vec3(0), glm::vec3(0, 1, 0));
     glm::mat4 m_modelMatrix { 1.0f };
+
+    // Interactive camera, used when the camera is not animated.
+    Camera m_camera { glm::vec3(-1, 1, -1), glm::vec3(0) };
+    float m_cameraSpeed { 1.0f }; // Units per second.
+    uint32_t m_numMouseSamples { 0 };
+    float m_oldestMouseSampleMs { 0.0f };
+
+    // Orbit of the benchmark camera path (0 to 1) at the last two simulation steps.
+    bool m_animateCamera { false };
+    float m_cameraOrbitPeriod { 20.0f }; // Seconds
+    float m_cameraOrbit { 0.0f };
+    float m_previousCameraOrbit { 0.0f };
+
+    int m_dummyInteger { 0 };
 };
 
-int main()
+int main(int argc, char** argv)
 {
-    Application app;
+    CommandLine commandLine;
+    try {
+        commandLine = parseCommandLine(argc, argv);
+    } catch (const CommandLineException& e) {
+        std::cerr << e.what() << "\n\n" << commandLineUsage;
+        return 1;
+    }
+    if (commandLine.showHelp) {
+        std::cout << commandLineUsage;
+        return 0;
+    }
+
+    Application app { commandLine };
+    if (commandLine.benchmark)
+        return app.runBenchmark(*commandLine.benchmark) ? 0 : 1;
+    if (commandLine.recording)
+        return app.runRecording(*commandLine.recording) ? 0 : 1;
     app.update();
 
     return 0;
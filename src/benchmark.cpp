@@ -0,0 +1,204 @@
+#include "benchmark.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+
+const std::string_view commandLineUsage = R"(Usage: Master_TechDemo [options]
+  --scene <file.obj>      Mesh to load (default: resources/dragon.obj)
+  --resolution <WxH>      Window/framebuffer size (default: 1024x1024)
+  --benchmark             Render offscreen without vsync along a fixed camera path and exit
+  --frames <n>            Number of measured benchmark frames (default: 500)
+  --warmup <n>            Number of benchmark frames rendered before measuring (default: 30)
+  --output <file.json>    Benchmark report (default: benchmark.json)
+  --record <path>         Record every frame of the camera path to a directory of images or to a
+                          .mp4/.mkv/.mov/.webm video (requires ffmpeg) and exit
+  --record-frames <n>     Number of recorded frames (default: 600)
+  --fps <n>               Frame rate of the recording (default: 60)
+  --qoi                   Record QOI instead of PNG images (much faster to encode)
+  --headless              Benchmark/record without a display server (surfaceless EGL on Linux)
+  --render-thread         Submit OpenGL commands on a render thread, one frame behind the main thread
+  --dynamic-resolution <ms>
+                          Lower the render resolution to keep the GPU time of the scene below <ms>
+  --help                  Show this message
+)";
+
+static uint32_t parseUnsigned(std::string_view flag, std::string_view value)
+{
+    uint32_t result = 0;
+    const auto [pEnd, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (error != std::errc() || pEnd != value.data() + value.size())
+        throw CommandLineException(fmt::format("Invalid value \"{}\" for {}", value, flag));
+    return result;
+}
+
+static float parsePositiveFloat(std::string_view flag, std::string_view value)
+{
+    float result = 0.0f;
+    const auto [pEnd, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (error != std::errc() || pEnd != value.data() + value.size() || !(result > 0.0f))
+        throw CommandLineException(fmt::format("Invalid value \"{}\" for {}", value, flag));
+    return result;
+}
+
+static glm::ivec2 parseResolution(std::string_view value)
+{
+    const size_t separator = value.find('x');
+    if (separator == std::string_view::npos)
+        throw CommandLineException(fmt::format("Invalid resolution \"{}\", expected <width>x<height>", value));
+
+    const uint32_t width = parseUnsigned("--resolution", value.substr(0, separator));
+    const uint32_t height = parseUnsigned("--resolution", value.substr(separator + 1));
+    if (width == 0 || height == 0 || width > 16384 || height > 16384)
+        throw CommandLineException(fmt::format("Resolution {}x{} is out of range", width, height));
+    return glm::ivec2(width, height);
+}
+
+CommandLine parseCommandLine(int argc, const char* const* argv)
+{
+    CommandLine commandLine;
+    BenchmarkSettings benchmarkSettings;
+    bool benchmark = false;
+    RecordingSettings recordingSettings;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view flag = argv[i];
+        // All flags except the switches take exactly one value.
+        const auto value = [&]() -> std::string_view {
+            if (i + 1 >= argc)
+                throw CommandLineException(fmt::format("Missing value for {}", flag));
+            return argv[++i];
+        };
+
+        if (flag == "--help" || flag == "-h")
+            commandLine.showHelp = true;
+        else if (flag == "--benchmark")
+            benchmark = true;
+        else if (flag == "--headless")
+            commandLine.headless = true;
+        else if (flag == "--render-thread")
+            commandLine.renderThread = true;
+        else if (flag == "--scene")
+            commandLine.scene = value();
+        else if (flag == "--resolution")
+            commandLine.resolution = parseResolution(value());
+        else if (flag == "--dynamic-resolution")
+            commandLine.dynamicResolutionTargetMs = parsePositiveFloat(flag, value());
+        else if (flag == "--frames")
+            benchmarkSettings.numFrames = std::max(parseUnsigned(flag, value()), 1u);
+        else if (flag == "--warmup")
+            benchmarkSettings.numWarmupFrames = parseUnsigned(flag, value());
+        else if (flag == "--output")
+            benchmarkSettings.outputFile = value();
+        else if (flag == "--record")
+            recordingSettings.outputPath = value();
+        else if (flag == "--record-frames")
+            recordingSettings.numFrames = std::max(parseUnsigned(flag, value()), 1u);
+        else if (flag == "--fps")
+            recordingSettings.frameRate = std::max(parseUnsigned(flag, value()), 1u);
+        else if (flag == "--qoi")
+            recordingSettings.imageFormat = FrameRecorder::ImageFormat::Qoi;
+        else
+            throw CommandLineException(fmt::format("Unknown option {}", flag));
+    }
+
+    const bool record = !recordingSettings.outputPath.empty();
+    if (benchmark && record)
+        throw CommandLineException("--benchmark and --record can not be combined");
+    if (commandLine.headless && !benchmark && !record)
+        throw CommandLineException("--headless requires --benchmark or --record");
+    if (commandLine.renderThread && record)
+        throw CommandLineException("--render-thread can not be combined with --record");
+    if (benchmark)
+        commandLine.benchmark = benchmarkSettings;
+    if (record)
+        commandLine.recording = recordingSettings;
+    return commandLine;
+}
+
+glm::mat4 benchmarkCameraView(const BoundingSphere& sceneBounds, float t)
+{
+    // Only depends on t (not on the wall clock) so every run renders exactly the same frames.
+    const float angle = glm::two_pi<float>() * t;
+    const float radius = std::max(sceneBounds.radius, 0.01f);
+    const float distance = radius * (1.6f + 0.6f * std::cos(2.0f * angle));
+    const float height = radius * 0.5f * std::sin(3.0f * angle);
+    const glm::vec3 eye = sceneBounds.center + glm::vec3(distance * std::cos(angle), height, distance * std::sin(angle));
+    return glm::lookAt(eye, sceneBounds.center, glm::vec3(0, 1, 0));
+}
+
+float BenchmarkReport::percentileMs(float percentile) const
+{
+    if (frameTimesMs.empty())
+        return 0.0f;
+
+    // Nearest-rank percentile.
+    std::vector<float> sorted = frameTimesMs;
+    std::sort(std::begin(sorted), std::end(sorted));
+    const size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0f * float(sorted.size())));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+float BenchmarkReport::meanMs() const
+{
+    if (frameTimesMs.empty())
+        return 0.0f;
+    return std::accumulate(std::begin(frameTimesMs), std::end(frameTimesMs), 0.0f) / float(frameTimesMs.size());
+}
+
+float BenchmarkReport::framesPerSecond() const
+{
+    const float meanFrameTimeMs = meanMs();
+    return meanFrameTimeMs > 0.0f ? 1000.0f / meanFrameTimeMs : 0.0f;
+}
+
+static std::string escapeJson(std::string_view string)
+{
+    std::string escaped;
+    for (char c : string) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+bool BenchmarkReport::writeJson(const std::filesystem::path& filePath) const
+{
+    std::ofstream file { filePath };
+    if (!file)
+        return false;
+
+    const auto [minFrameTime, maxFrameTime] = std::minmax_element(std::begin(frameTimesMs), std::end(frameTimesMs));
+    file << "{\n";
+    file << fmt::format("  \"scene\": \"{}\",\n", escapeJson(scene));
+    file << fmt::format("  \"resolution\": [{}, {}],\n", resolution.x, resolution.y);
+    file << fmt::format("  \"renderer\": \"{}\",\n", escapeJson(renderer));
+    file << fmt::format("  \"warmup_frames\": {},\n", numWarmupFrames);
+    file << fmt::format("  \"frames\": {},\n", frameTimesMs.size());
+    file << fmt::format("  \"fps\": {:.2f},\n", framesPerSecond());
+    file << fmt::format("  \"megapixels_per_second\": {:.2f},\n", framesPerSecond() * float(resolution.x) * float(resolution.y) * 1e-6f);
+    file << fmt::format("  \"mean_render_scale\": {:.4f},\n", meanRenderScale);
+    file << "  \"frame_time_ms\": {\n";
+    if (!frameTimesMs.empty()) {
+        file << fmt::format("    \"min\": {:.4f},\n", *minFrameTime);
+        file << fmt::format("    \"max\": {:.4f},\n", *maxFrameTime);
+    }
+    file << fmt::format("    \"mean\": {:.4f},\n", meanMs());
+    file << fmt::format("    \"p50\": {:.4f},\n", percentileMs(50.0f));
+    file << fmt::format("    \"p95\": {:.4f},\n", percentileMs(95.0f));
+    file << fmt::format("    \"p99\": {:.4f}\n", percentileMs(99.0f));
+    file << "  },\n";
+    file << "  \"frame_times_ms\": [";
+    for (size_t i = 0; i < frameTimesMs.size(); ++i)
+        file << fmt::format("{}{:.4f}", i == 0 ? "" : ", ", frameTimesMs[i]);
+    file << "]\n}\n";
+    return static_cast<bool>(file);
+}
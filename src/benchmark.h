@@ -0,0 +1,77 @@
+#pragma once
+#include "bounding_volume.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+DISABLE_WARNINGS_POP()
+#include <framework/frame_recorder.h>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CommandLineException : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+struct BenchmarkSettings {
+    uint32_t numFrames { 500 };
+    // Frames rendered before measuring, to get past shader compilation, first-use allocations and driver warm up.
+    uint32_t numWarmupFrames { 30 };
+    std::filesystem::path outputFile { "benchmark.json" };
+};
+
+struct RecordingSettings {
+    // A directory for an image sequence or a video file (requires ffmpeg), see FrameRecorder.
+    std::filesystem::path outputPath;
+    uint32_t numFrames { 600 };
+    // Simulation time advances by exactly 1 / frameRate per recorded frame, independent of how long rendering takes.
+    uint32_t frameRate { 60 };
+    FrameRecorder::ImageFormat imageFormat { FrameRecorder::ImageFormat::Png };
+};
+
+struct CommandLine {
+    std::filesystem::path scene { RESOURCE_ROOT "resources/dragon.obj" };
+    glm::ivec2 resolution { 1024, 1024 };
+    // Run the benchmark instead of the interactive loop when set.
+    std::optional<BenchmarkSettings> benchmark;
+    // Record the camera path of the benchmark to disk instead of the interactive loop when set.
+    std::optional<RecordingSettings> recording;
+    // Render without a display server (see Window); only for benchmarks and recordings since there is no input or UI.
+    bool headless { false };
+    // Render on a separate thread that consumes the frames prepared by the main thread (interactive loop and benchmarks).
+    bool renderThread { false };
+    // Enable dynamic resolution scaling with this target GPU time of the scene in milliseconds.
+    std::optional<float> dynamicResolutionTargetMs;
+    bool showHelp { false };
+};
+
+extern const std::string_view commandLineUsage;
+
+// Throws CommandLineException on unknown flags or invalid values.
+[[nodiscard]] CommandLine parseCommandLine(int argc, const char* const* argv);
+
+// Deterministic camera path for benchmarks: one orbit around the scene with a slowly varying height and distance, so
+// that the amount of visible and occluded geometry changes over the run. t ranges from 0 to 1.
+[[nodiscard]] glm::mat4 benchmarkCameraView(const BoundingSphere& sceneBounds, float t);
+
+// Frame time statistics of a benchmark run.
+struct BenchmarkReport {
+    std::string scene;
+    glm::ivec2 resolution { 0 };
+    std::string renderer; // GL_RENDERER, e.g. "llvmpipe (LLVM 15.0.7, 256 bits)".
+    uint32_t numWarmupFrames { 0 };
+    std::vector<float> frameTimesMs {};
+    float meanRenderScale { 1.0f }; // Per axis; below 1 if dynamic resolution lowered the resolution.
+
+    [[nodiscard]] float percentileMs(float percentile) const;
+    [[nodiscard]] float meanMs() const;
+    [[nodiscard]] float framesPerSecond() const;
+
+    // Returns false if the file could not be written.
+    bool writeJson(const std::filesystem::path& filePath) const;
+};
@@ -0,0 +1,47 @@
+#include "bounding_volume.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <limits>
+
+AxisAlignedBox computeBoundingBox(const Mesh& mesh)
+{
+    if (mesh.vertices.empty())
+        return {};
+
+    AxisAlignedBox box { .lower = glm::vec3(std::numeric_limits<float>::max()), .upper = glm::vec3(std::numeric_limits<float>::lowest()) };
+    for (const Vertex& vertex : mesh.vertices) {
+        box.lower = glm::min(box.lower, vertex.position);
+        box.upper = glm::max(box.upper, vertex.position);
+    }
+    return box;
+}
+
+BoundingSphere computeBoundingSphere(const Mesh& mesh, const AxisAlignedBox& box)
+{
+    BoundingSphere sphere { .center = (box.lower + box.upper) * 0.5f, .radius = 0.0f };
+    for (const Vertex& vertex : mesh.vertices)
+        sphere.radius = std::max(sphere.radius, glm::distance(sphere.center, vertex.position));
+    return sphere;
+}
+
+AxisAlignedBox transformBoundingBox(const AxisAlignedBox& box, const glm::mat4& matrix)
+{
+    // Transform the center and project the extents onto the world axes (Arvo, Graphics Gems 1990).
+    const glm::vec3 center = (box.lower + box.upper) * 0.5f;
+    const glm::vec3 extent = (box.upper - box.lower) * 0.5f;
+    const glm::vec3 worldCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    const glm::mat3 absMatrix { glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])) };
+    const glm::vec3 worldExtent = absMatrix * extent;
+    return { .lower = worldCenter - worldExtent, .upper = worldCenter + worldExtent };
+}
+
+BoundingSphere transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& matrix)
+{
+    // Scale the radius by the largest axis scale so that non-uniform scaling stays conservative.
+    const float maxScale = std::max({ glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2])) });
+    return { .center = glm::vec3(matrix * glm::vec4(sphere.center, 1.0f)), .radius = sphere.radius * maxScale };
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+DISABLE_WARNINGS_POP()
+#include <framework/mesh.h>
+
+struct AxisAlignedBox {
+    glm::vec3 lower { 0.0f };
+    glm::vec3 upper { 0.0f };
+};
+
+struct BoundingSphere {
+    glm::vec3 center { 0.0f };
+    float radius { 0.0f };
+};
+
+// Bounds of the vertex positions of a mesh.
+[[nodiscard]] AxisAlignedBox computeBoundingBox(const Mesh& mesh);
+// Sphere around the center of the bounding box; not minimal but cheap and tight enough for culling.
+[[nodiscard]] BoundingSphere computeBoundingSphere(const Mesh& mesh, const AxisAlignedBox& box);
+
+// Conservative world space bounds of a transformed object.
+[[nodiscard]] AxisAlignedBox transformBoundingBox(const AxisAlignedBox& box, const glm::mat4& matrix);
+[[nodiscard]] BoundingSphere transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& matrix);
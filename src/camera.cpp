@@ -0,0 +1,81 @@
+#include "camera.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cmath>
+
+// Looking straight up or down makes the view matrix degenerate.
+static constexpr float maxPitch = glm::radians(89.0f);
+static constexpr float minDistance = 0.1f;
+static constexpr float zoomFactor = 0.9f; // Per scroll step.
+
+static const glm::vec3 worldUp { 0.0f, 1.0f, 0.0f };
+
+Camera::Camera(const glm::vec3& position, const glm::vec3& target)
+    : m_position(position)
+    , m_distance(std::max(glm::distance(position, target), minDistance))
+{
+    const glm::vec3 direction = (target - position) / m_distance;
+    m_yaw = std::atan2(direction.x, direction.z);
+    m_pitch = std::clamp(std::asin(std::clamp(direction.y, -1.0f, 1.0f)), -maxPitch, maxPitch);
+}
+
+void Camera::setMode(Mode mode)
+{
+    if (mode == m_mode)
+        return;
+    // Swap between the position of the camera and the position of the target.
+    if (mode == Mode::ThirdPerson)
+        m_position += forward() * m_distance;
+    else
+        m_position -= forward() * m_distance;
+    m_mode = mode;
+}
+
+Camera::Mode Camera::mode() const
+{
+    return m_mode;
+}
+
+void Camera::rotate(const glm::vec2& mouseDelta)
+{
+    m_yaw -= mouseDelta.x * mouseSensitivity;
+    m_pitch = std::clamp(m_pitch + mouseDelta.y * mouseSensitivity, -maxPitch, maxPitch);
+    // Keep the angle small so that it does not lose precision after many turns.
+    m_yaw = std::remainder(m_yaw, glm::two_pi<float>());
+}
+
+void Camera::move(const glm::vec3& offset)
+{
+    glm::vec3 forwardDirection = forward();
+    if (m_mode == Mode::ThirdPerson)
+        forwardDirection = glm::normalize(glm::vec3(forwardDirection.x, 0.0f, forwardDirection.z));
+    const glm::vec3 right = glm::normalize(glm::cross(forwardDirection, worldUp));
+    m_position += offset.x * right + offset.y * worldUp + offset.z * forwardDirection;
+}
+
+void Camera::zoom(float steps)
+{
+    if (m_mode == Mode::ThirdPerson)
+        m_distance = std::max(m_distance * std::pow(zoomFactor, steps), minDistance);
+}
+
+glm::vec3 Camera::position() const
+{
+    return m_mode == Mode::FirstPerson ? m_position : m_position - forward() * m_distance;
+}
+
+glm::vec3 Camera::forward() const
+{
+    return glm::vec3(std::cos(m_pitch) * std::sin(m_yaw), std::sin(m_pitch), std::cos(m_pitch) * std::cos(m_yaw));
+}
+
+glm::mat4 Camera::viewMatrix() const
+{
+    const glm::vec3 eye = position();
+    return glm::lookAt(eye, eye + forward(), worldUp);
+}
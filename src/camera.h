@@ -0,0 +1,43 @@
+#pragma once
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+DISABLE_WARNINGS_POP()
+
+// Mouse-look camera with a first person mode, in which the camera itself moves, and a third person mode, in which it
+// orbits a target that moves. Switching modes keeps the current view.
+class Camera {
+public:
+    enum class Mode {
+        FirstPerson,
+        ThirdPerson
+    };
+
+    Camera(const glm::vec3& position, const glm::vec3& target);
+
+    void setMode(Mode mode);
+    [[nodiscard]] Mode mode() const;
+
+    // Turn by a relative mouse movement in screen coordinates (positive is right/up).
+    void rotate(const glm::vec2& mouseDelta);
+    // Move by an offset in the camera's frame: x is right, y is up and z is forward. In third person mode the target
+    // moves and forward stays in the horizontal plane.
+    void move(const glm::vec3& offset);
+    // Change the distance to the target (third person only) by a number of scroll wheel steps.
+    void zoom(float steps);
+
+    [[nodiscard]] glm::vec3 position() const;
+    [[nodiscard]] glm::vec3 forward() const;
+    [[nodiscard]] glm::mat4 viewMatrix() const;
+
+    float mouseSensitivity { 0.003f }; // Radians per screen unit.
+
+private:
+    Mode m_mode { Mode::FirstPerson };
+    glm::vec3 m_position; // Of the camera in first person mode, of the target in third person mode.
+    float m_distance; // From the target.
+    float m_yaw; // Radians around the Y axis; 0 looks along +Z.
+    float m_pitch;
+};
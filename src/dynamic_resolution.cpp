@@ -0,0 +1,162 @@
+#include "dynamic_resolution.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/common.hpp>
+DISABLE_WARNINGS_POP()
+#include <framework/gpu_profiler.h>
+#include <algorithm>
+#include <cmath>
+
+static constexpr const char* gpuZoneName = "Dynamic resolution scene";
+static constexpr const char* upscaleZoneName = "Upscale";
+// Weight of a new measurement in the smoothed GPU time.
+static constexpr float smoothing = 0.3f;
+// The scale is changed when the GPU time leaves [headroom * target, target] and aims for the middle of that range.
+static constexpr float headroom = 0.85f;
+static constexpr float aim = 0.92f;
+// Largest change of the scale per measurement; it drops faster than it recovers.
+static constexpr float maxScaleDecrease = 0.8f;
+static constexpr float maxScaleIncrease = 1.1f;
+// The render size only changes in steps of 1/32 of the output size, so that small corrections do not change it every
+// frame and every change is large enough to show up in the timings.
+static constexpr float scaleStep = 1.0f / 32.0f;
+
+DynamicResolution::DynamicResolution()
+{
+    glGenVertexArrays(1, &m_emptyVao);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    glDeleteVertexArrays(1, &m_emptyVao);
+}
+
+void DynamicResolution::beginScene(const Settings& settings, const Shader& upscaleShader, GLuint outputFramebuffer, const glm::ivec2& outputSize)
+{
+    m_settings = settings;
+    m_pUpscaleShader = &upscaleShader;
+    m_outputFramebuffer = outputFramebuffer;
+    updateScale(settings);
+    // Without a working upscale pass the scaled scene could not be shown; it resumes scaling once the shader is fixed.
+    if (!upscaleShader.isValid())
+        m_scale = 1.0f;
+    const float quantizedScale = std::round(m_scale / scaleStep) * scaleStep;
+    const glm::ivec2 renderSize = glm::max(glm::ivec2(glm::round(glm::vec2(outputSize) * quantizedScale)), glm::ivec2(1));
+    if (renderSize != m_renderSize || outputSize != m_outputSize) {
+        // Timings of frames that are still in flight were rendered at the old size.
+        m_lastChangeFrame = GpuProfiler::get().currentFrame();
+        m_restartSmoothing = true;
+        if (outputSize != m_outputSize)
+            m_upscaleMs.reset();
+        m_renderSize = renderSize;
+        m_outputSize = outputSize;
+    }
+
+    GpuProfiler::get().beginZone(gpuZoneName);
+    if (m_renderSize == m_outputSize) {
+        // Upscaling would only cost a copy.
+        glBindFramebuffer(GL_FRAMEBUFFER, m_outputFramebuffer);
+        glViewport(0, 0, m_outputSize.x, m_outputSize.y);
+        return;
+    }
+
+    if (!m_renderTarget)
+        m_renderTarget.emplace(m_outputSize);
+    else
+        m_renderTarget->resize(m_outputSize);
+    m_renderTarget->bind();
+    glViewport(0, 0, m_renderSize.x, m_renderSize.y);
+    // Clears only touch the part of the render target that is used.
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, m_renderSize.x, m_renderSize.y);
+}
+
+void DynamicResolution::endScene()
+{
+    if (m_renderSize != m_outputSize) {
+        GpuProfiler::get().beginZone(upscaleZoneName);
+        upscale();
+        GpuProfiler::get().endZone();
+    }
+    GpuProfiler::get().endZone();
+}
+
+void DynamicResolution::upscale()
+{
+    const Shader& upscaleShader = *m_pUpscaleShader;
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_outputFramebuffer);
+    glViewport(0, 0, m_outputSize.x, m_outputSize.y);
+
+    upscaleShader.bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_renderTarget->colorTexture());
+    glUniform1i(upscaleShader.getUniformLocation("sourceTexture"), 0);
+    // Map the output to the used part of the render target; bilinear taps must not reach past its last texel.
+    const glm::vec2 texelSize = 1.0f / glm::vec2(m_renderTarget->size());
+    const glm::vec2 uvScale = glm::vec2(m_renderSize) * texelSize;
+    glUniform2f(upscaleShader.getUniformLocation("uvScale"), uvScale.x, uvScale.y);
+    glUniform2f(upscaleShader.getUniformLocation("uvMax"), uvScale.x - 0.5f * texelSize.x, uvScale.y - 0.5f * texelSize.y);
+    glUniform2f(upscaleShader.getUniformLocation("texelSize"), texelSize.x, texelSize.y);
+    glUniform1f(upscaleShader.getUniformLocation("sharpness"), m_settings.sharpness);
+
+    glBindVertexArray(m_emptyVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
+
+void DynamicResolution::updateScale(const Settings& settings)
+{
+    const GpuProfiler& profiler = GpuProfiler::get();
+    const uint64_t frame = profiler.lastCompletedFrame();
+    if (frame == m_lastMeasuredFrame || frame < m_lastChangeFrame)
+        return;
+    const std::optional<float> frameMs = profiler.lastZoneMs(gpuZoneName);
+    if (!frameMs)
+        return;
+    m_lastMeasuredFrame = frame;
+    m_gpuTimeMs = m_gpuTimeMs && !m_restartSmoothing ? glm::mix(*m_gpuTimeMs, *frameMs, smoothing) : *frameMs;
+    m_restartSmoothing = false;
+    // The upscale pass only depends on the output size, so its cost is remembered while rendering at full scale.
+    if (const std::optional<float> upscaleMs = profiler.lastZoneMs(upscaleZoneName))
+        m_upscaleMs = m_upscaleMs ? glm::mix(*m_upscaleMs, *upscaleMs, smoothing) : *upscaleMs;
+
+    if (*m_gpuTimeMs <= settings.targetMs && *m_gpuTimeMs >= headroom * settings.targetMs)
+        return;
+
+    // The scene time scales roughly with the number of pixels, i.e. with the square of the scale, while the upscale pass
+    // has a fixed cost that only applies below full scale. Until that cost has been measured it is assumed to be free.
+    const float upscaleMs = m_upscaleMs.value_or(0.0f);
+    const glm::vec2 relativeSize = glm::vec2(m_renderSize) / glm::vec2(m_outputSize);
+    const float area = relativeSize.x * relativeSize.y;
+    const float scaledPassMs = m_renderSize != m_outputSize ? upscaleMs : 0.0f;
+    const float fullSceneMs = std::max(*m_gpuTimeMs - scaledPassMs, 0.001f) / area;
+    const float aimMs = aim * settings.targetMs;
+    const float minScale = std::clamp(settings.minScale, scaleStep, 1.0f);
+    const float idealScale = fullSceneMs > aimMs ? std::sqrt(std::max(aimMs - upscaleMs, 0.0f) / fullSceneMs) : 1.0f;
+    const float bestScale = std::clamp(idealScale, minScale, 1.0f);
+    if (bestScale < 1.0f && upscaleMs + fullSceneMs * bestScale * bestScale >= fullSceneMs) {
+        // Even the best allowed scale would be slower than rendering directly at full scale (e.g. on software GL, where
+        // the full resolution upscale pass is expensive).
+        m_scale = 1.0f;
+        return;
+    }
+    m_scale = std::clamp(idealScale, m_scale * maxScaleDecrease, m_scale * maxScaleIncrease);
+    m_scale = std::clamp(m_scale, minScale, 1.0f);
+}
+
+float DynamicResolution::scale() const
+{
+    return float(m_renderSize.x) / float(std::max(m_outputSize.x, 1));
+}
+
+glm::ivec2 DynamicResolution::renderSize() const
+{
+    return m_renderSize;
+}
+
+std::optional<float> DynamicResolution::gpuTimeMs() const
+{
+    return m_gpuTimeMs;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "render_target.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/vec2.hpp>
+DISABLE_WARNINGS_POP()
+#include <framework/opengl_includes.h>
+#include <framework/shader.h>
+#include <cstdint>
+#include <optional>
+
+// Renders the scene at a lower resolution when the GPU can not keep up and upscales it to the output framebuffer.
+//
+// The GPU time of the scaled part of the frame (scene and upscale pass) is measured with the GpuProfiler. Its results
+// arrive a few frames late, so the controller only acts on frames that were rendered at the current scale, smooths them
+// and changes the scale in limited steps. The scale is lowered as soon as the target is exceeded and only raised again
+// once there is some headroom, so that it does not oscillate around the target. The upscale pass is timed separately:
+// when its fixed cost outweighs what the smaller scene saves, the scene is rendered at full scale instead.
+//
+// Below full scale the scene is drawn into the lower left corner of a render target of the full output size, so changing
+// the scale only changes the viewport and never reallocates. At full scale it is drawn directly into the output
+// framebuffer. All functions must be called on the thread that owns the GL context.
+class DynamicResolution {
+public:
+    struct Settings {
+        bool enabled { false };
+        float targetMs { 1000.0f / 60.0f }; // GPU time of the scene.
+        float minScale { 0.5f }; // Per axis.
+        float sharpness { 0.3f }; // Of the upscale pass; 0 is plain bilinear filtering.
+    };
+
+    DynamicResolution();
+    DynamicResolution(const DynamicResolution&) = delete;
+    ~DynamicResolution();
+
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // Update the scale from the latest GPU timings, then bind the framebuffer that the scene should be drawn into and
+    // set the viewport to the scaled size. outputSize is the size in pixels of the output framebuffer. The scene stays
+    // at full scale while upscaleShader is not valid (e.g. it failed to build); it must outlive endScene().
+    void beginScene(const Settings& settings, const Shader& upscaleShader, GLuint outputFramebuffer, const glm::ivec2& outputSize);
+    // Upscale the scene to the output framebuffer (if it was scaled) and leave that bound with a viewport of its size.
+    void endScene();
+
+    [[nodiscard]] float scale() const;
+    [[nodiscard]] glm::ivec2 renderSize() const;
+    // Smoothed GPU time of the scaled part of the frame, or nothing before the first measurement.
+    [[nodiscard]] std::optional<float> gpuTimeMs() const;
+
+private:
+    void updateScale(const Settings& settings);
+    void upscale();
+
+private:
+    std::optional<RenderTarget> m_renderTarget;
+    GLuint m_emptyVao { 0 }; // The upscale pass generates its vertices from gl_VertexID.
+    Settings m_settings;
+    const Shader* m_pUpscaleShader { nullptr }; // Of the current frame.
+    GLuint m_outputFramebuffer { 0 };
+
+    float m_scale { 1.0f };
+    glm::ivec2 m_outputSize { 0 };
+    glm::ivec2 m_renderSize { 0 };
+    std::optional<float> m_gpuTimeMs;
+    std::optional<float> m_upscaleMs; // Smoothed GPU time of the upscale pass at the current output size.
+    uint64_t m_lastMeasuredFrame { 0 };
+    uint64_t m_lastChangeFrame { 0 }; // First GPU profiler frame rendered at the current size.
+    bool m_restartSmoothing { false }; // Earlier measurements were of another size.
+};
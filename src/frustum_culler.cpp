@@ -0,0 +1,138 @@
+#include "frustum_culler.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/geometric.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cmath>
+#include <framework/jobs.h>
+#include <framework/profiler.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE 1
+#endif
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjectionMatrix)
+{
+    // glm matrices are column major; row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+    const auto row = [&](int i) { return glm::vec4(viewProjectionMatrix[0][i], viewProjectionMatrix[1][i], viewProjectionMatrix[2][i], viewProjectionMatrix[3][i]); };
+
+    Frustum frustum;
+    frustum.planes = {
+        row(3) + row(0), // Left
+        row(3) - row(0), // Right
+        row(3) + row(1), // Bottom
+        row(3) - row(1), // Top
+        row(3) + row(2), // Near
+        row(3) - row(2) // Far
+    };
+    // Normalize so that the plane equation returns distances, which is required for the sphere test.
+    for (glm::vec4& plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+void FrustumCuller::clear()
+{
+    for (auto* pArray : { &m_boxCenterX, &m_boxCenterY, &m_boxCenterZ, &m_boxExtentX, &m_boxExtentY, &m_boxExtentZ, &m_sphereX, &m_sphereY, &m_sphereZ, &m_sphereRadius })
+        pArray->clear();
+    m_visible.clear();
+    m_numVisible = 0;
+}
+
+void FrustumCuller::add(const AxisAlignedBox& worldBox, const BoundingSphere& worldSphere)
+{
+    const glm::vec3 center = (worldBox.lower + worldBox.upper) * 0.5f;
+    const glm::vec3 extent = (worldBox.upper - worldBox.lower) * 0.5f;
+    m_boxCenterX.push_back(center.x);
+    m_boxCenterY.push_back(center.y);
+    m_boxCenterZ.push_back(center.z);
+    m_boxExtentX.push_back(extent.x);
+    m_boxExtentY.push_back(extent.y);
+    m_boxExtentZ.push_back(extent.z);
+    m_sphereX.push_back(worldSphere.center.x);
+    m_sphereY.push_back(worldSphere.center.y);
+    m_sphereZ.push_back(worldSphere.center.z);
+    m_sphereRadius.push_back(worldSphere.radius);
+}
+
+void FrustumCuller::cull(const glm::mat4& viewProjectionMatrix)
+{
+    const Frustum frustum = Frustum::fromMatrix(viewProjectionMatrix);
+    const size_t numObjects = m_boxCenterX.size();
+    m_visible.resize(numObjects);
+
+    JobSystem::get().parallelFor(0, numObjects, grainSize, [&](size_t begin, size_t end) { cullRange(frustum, begin, end); });
+
+    m_numVisible = static_cast<size_t>(std::count(std::begin(m_visible), std::end(m_visible), uint8_t(1)));
+}
+
+void FrustumCuller::cullRange(const Frustum& frustum, size_t begin, size_t end)
+{
+    PROFILE_FUNCTION();
+    size_t i = begin;
+#ifdef FRUSTUM_CULLER_SSE
+    // Test four objects against all planes at once. An object is culled when either its sphere or its box
+    // lies completely on the negative side of any plane.
+    for (; i + 4 <= end; i += 4) {
+        const __m128 boxCenterX = _mm_loadu_ps(&m_boxCenterX[i]);
+        const __m128 boxCenterY = _mm_loadu_ps(&m_boxCenterY[i]);
+        const __m128 boxCenterZ = _mm_loadu_ps(&m_boxCenterZ[i]);
+        const __m128 boxExtentX = _mm_loadu_ps(&m_boxExtentX[i]);
+        const __m128 boxExtentY = _mm_loadu_ps(&m_boxExtentY[i]);
+        const __m128 boxExtentZ = _mm_loadu_ps(&m_boxExtentZ[i]);
+        const __m128 sphereX = _mm_loadu_ps(&m_sphereX[i]);
+        const __m128 sphereY = _mm_loadu_ps(&m_sphereY[i]);
+        const __m128 sphereZ = _mm_loadu_ps(&m_sphereZ[i]);
+        const __m128 negSphereRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_sphereRadius[i]));
+
+        __m128 outside = _mm_setzero_ps();
+        for (const glm::vec4& plane : frustum.planes) {
+            const __m128 planeX = _mm_set1_ps(plane.x);
+            const __m128 planeY = _mm_set1_ps(plane.y);
+            const __m128 planeZ = _mm_set1_ps(plane.z);
+            const __m128 planeW = _mm_set1_ps(plane.w);
+
+            // Signed distance of the sphere center.
+            const __m128 sphereDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX, sphereX), _mm_mul_ps(planeY, sphereY)), _mm_add_ps(_mm_mul_ps(planeZ, sphereZ), planeW));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(sphereDistance, negSphereRadius));
+
+            // Signed distance of the box center versus the projected radius of the box onto the plane normal.
+            const __m128 boxDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX, boxCenterX), _mm_mul_ps(planeY, boxCenterY)), _mm_add_ps(_mm_mul_ps(planeZ, boxCenterZ), planeW));
+            const __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), boxExtentX), _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), boxExtentY)), _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), boxExtentZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(boxDistance, boxRadius), _mm_setzero_ps()));
+        }
+
+        const unsigned outsideMask = static_cast<unsigned>(_mm_movemask_ps(outside));
+        for (size_t lane = 0; lane < 4; ++lane)
+            m_visible[i + lane] = (outsideMask & (1u << lane)) ? 0 : 1;
+    }
+#endif
+
+    // Scalar path for the remaining objects (or all objects when SSE is not available).
+    for (; i < end; ++i) {
+        bool outside = false;
+        for (const glm::vec4& plane : frustum.planes) {
+            const float sphereDistance = plane.x * m_sphereX[i] + plane.y * m_sphereY[i] + plane.z * m_sphereZ[i] + plane.w;
+            const float boxDistance = plane.x * m_boxCenterX[i] + plane.y * m_boxCenterY[i] + plane.z * m_boxCenterZ[i] + plane.w;
+            const float boxRadius = std::abs(plane.x) * m_boxExtentX[i] + std::abs(plane.y) * m_boxExtentY[i] + std::abs(plane.z) * m_boxExtentZ[i];
+            outside |= sphereDistance < -m_sphereRadius[i] || boxDistance + boxRadius < 0.0f;
+        }
+        m_visible[i] = outside ? 0 : 1;
+    }
+}
+
+size_t FrustumCuller::numObjects() const
+{
+    return m_boxCenterX.size();
+}
+
+size_t FrustumCuller::numVisible() const
+{
+    return m_numVisible;
+}
+
+bool FrustumCuller::isVisible(size_t objectIndex) const
+{
+    return m_visible[objectIndex] != 0;
+}
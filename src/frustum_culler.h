@@ -0,0 +1,51 @@
+#pragma once
+#include "bounding_volume.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+DISABLE_WARNINGS_POP()
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// The six planes of a view frustum in world space; points inside satisfy dot(plane.xyz, p) + plane.w >= 0.
+struct Frustum {
+    std::array<glm::vec4, 6> planes;
+
+    // Gribb/Hartmann plane extraction from a (projection * view) matrix with OpenGL [-1, 1] clip space depth.
+    static Frustum fromMatrix(const glm::mat4& viewProjectionMatrix);
+};
+
+// Tests the world space bounds of many objects against a view frustum.
+// Bounds are stored as a structure-of-arrays so that four objects are tested at once with SSE;
+// large object counts are additionally split over multiple threads.
+class FrustumCuller {
+public:
+    // Remove all objects; keeps the allocated memory for the next frame.
+    void clear();
+    // Add the world space bounds of an object. Objects are identified by the order in which they are added.
+    void add(const AxisAlignedBox& worldBox, const BoundingSphere& worldSphere);
+
+    void cull(const glm::mat4& viewProjectionMatrix);
+
+    [[nodiscard]] size_t numObjects() const;
+    [[nodiscard]] size_t numVisible() const;
+    // Only valid after cull().
+    [[nodiscard]] bool isVisible(size_t objectIndex) const;
+
+private:
+    void cullRange(const Frustum& frustum, size_t begin, size_t end);
+
+private:
+    // Objects culled per job (see JobSystem); a multiple of the SIMD width. Smaller scenes are culled on the calling thread.
+    static constexpr size_t grainSize = 4096;
+
+    // Box center/extents and sphere center/radius, one array per component.
+    std::vector<float> m_boxCenterX, m_boxCenterY, m_boxCenterZ;
+    std::vector<float> m_boxExtentX, m_boxExtentY, m_boxExtentZ;
+    std::vector<float> m_sphereX, m_sphereY, m_sphereZ, m_sphereRadius;
+
+    std::vector<uint8_t> m_visible;
+    size_t m_numVisible { 0 };
+};
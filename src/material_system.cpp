@@ -0,0 +1,197 @@
+#include "material_system.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <framework/window.h>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+
+// GL_ARB_bindless_texture is not part of the glad loader that ships with the framework, so load it manually.
+using GetTextureHandleARB = GLuint64(APIENTRY*)(GLuint texture);
+using MakeTextureHandleResidentARB = void(APIENTRY*)(GLuint64 handle);
+static GetTextureHandleARB pGetTextureHandleARB = nullptr;
+static MakeTextureHandleResidentARB pMakeTextureHandleResidentARB = nullptr;
+static MakeTextureHandleResidentARB pMakeTextureHandleNonResidentARB = nullptr;
+
+static bool hasExtension(std::string_view extension)
+{
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions; ++i) {
+        if (extension == reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i))))
+            return true;
+    }
+    return false;
+}
+
+static bool loadBindlessTextureFunctions()
+{
+    if (!hasExtension("GL_ARB_bindless_texture"))
+        return false;
+
+    pGetTextureHandleARB = reinterpret_cast<GetTextureHandleARB>(Window::getProcAddress("glGetTextureHandleARB"));
+    pMakeTextureHandleResidentARB = reinterpret_cast<MakeTextureHandleResidentARB>(Window::getProcAddress("glMakeTextureHandleResidentARB"));
+    pMakeTextureHandleNonResidentARB = reinterpret_cast<MakeTextureHandleResidentARB>(Window::getProcAddress("glMakeTextureHandleNonResidentARB"));
+    return pGetTextureHandleARB && pMakeTextureHandleResidentARB && pMakeTextureHandleNonResidentARB;
+}
+
+MaterialSystem::~MaterialSystem()
+{
+    for (const TextureBucket& bucket : m_buckets) {
+        if (bucket.bindlessHandle)
+            pMakeTextureHandleNonResidentARB(bucket.bindlessHandle);
+        if (bucket.texture)
+            glDeleteTextures(1, &bucket.texture);
+    }
+    if (m_materialBuffer)
+        glDeleteBuffers(1, &m_materialBuffer);
+}
+
+uint32_t MaterialSystem::addMaterial(const Material& material)
+{
+    assert(!m_uploaded);
+    if (m_materials.size() >= maxMaterials)
+        throw std::runtime_error(fmt::format("Material system supports at most {} materials", maxMaterials));
+
+    GPUMaterialEntry& entry = m_materials.emplace_back();
+    entry.kd = material.kd;
+    entry.ks = material.ks;
+    entry.shininess = material.shininess;
+    entry.transparency = material.transparency;
+
+    if (const auto& pImage = material.kdTexture) {
+        // Textures that are shared between materials are only stored once.
+        auto iter = m_textureLocations.find(pImage.get());
+        if (iter == std::end(m_textureLocations)) {
+            const BucketKey key { pImage->width, pImage->height, pImage->channels };
+            auto bucketIter = std::find_if(std::begin(m_buckets), std::end(m_buckets), [&](const TextureBucket& bucket) { return bucket.key == key; });
+            if (bucketIter == std::end(m_buckets)) {
+                if (m_buckets.size() >= maxTextureArrays)
+                    throw std::runtime_error(fmt::format("Material system supports at most {} different texture sizes/formats", maxTextureArrays));
+                bucketIter = m_buckets.insert(std::end(m_buckets), TextureBucket { .key = key, .layers = {} });
+            }
+
+            bucketIter->layers.push_back(pImage.get());
+            m_images.push_back(pImage);
+            const auto bucketIndex = static_cast<int32_t>(std::distance(std::begin(m_buckets), bucketIter));
+            iter = m_textureLocations.emplace(pImage.get(), std::pair { bucketIndex, static_cast<int32_t>(bucketIter->layers.size() - 1) }).first;
+        }
+        std::tie(entry.textureArray, entry.textureLayer) = iter->second;
+    }
+
+    return static_cast<uint32_t>(m_materials.size() - 1);
+}
+
+void MaterialSystem::upload()
+{
+    assert(!m_uploaded);
+    m_bindless = loadBindlessTextureFunctions();
+
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    // Image rows are tightly packed, which matters for RGB textures with a width that is not a multiple of 4.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (TextureBucket& bucket : m_buckets) {
+        const auto [width, height, channels] = bucket.key;
+        if (static_cast<GLint>(bucket.layers.size()) > maxLayers)
+            throw std::runtime_error(fmt::format("Too many {}x{} textures for a single texture array", width, height));
+
+        GLenum format, internalFormat;
+        switch (channels) {
+        case 1:
+            format = GL_RED;
+            internalFormat = GL_R8;
+            break;
+        case 3:
+            format = GL_RGB;
+            internalFormat = GL_RGB8;
+            break;
+        case 4:
+            format = GL_RGBA;
+            internalFormat = GL_RGBA8;
+            break;
+        default:
+            std::cerr << "Number of channels read for texture is not supported" << std::endl;
+            throw std::exception();
+        }
+
+        glGenTextures(1, &bucket.texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, bucket.texture);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, static_cast<GLint>(internalFormat), width, height, static_cast<GLsizei>(bucket.layers.size()), 0, format, GL_UNSIGNED_BYTE, nullptr);
+        for (size_t layer = 0; layer < bucket.layers.size(); ++layer)
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer), width, height, 1, format, GL_UNSIGNED_BYTE, bucket.layers[layer]->get_data());
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        bucket.memory = TrackedMemory(MemoryCategory::GpuTexture, fmt::format("material texture array {}x{}x{}", width, height, channels),
+            mipChainBytes(width, height, static_cast<int>(bucket.layers.size()), channels));
+
+        // A texture becomes immutable once a handle is created for it, so only do this after uploading all layers.
+        if (m_bindless) {
+            bucket.bindlessHandle = pGetTextureHandleARB(bucket.texture);
+            pMakeTextureHandleResidentARB(bucket.bindlessHandle);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    for (GPUMaterialEntry& entry : m_materials) {
+        if (entry.textureArray >= 0) {
+            const GLuint64 handle = m_buckets[static_cast<size_t>(entry.textureArray)].bindlessHandle;
+            entry.textureHandle[0] = static_cast<uint32_t>(handle & 0xFFFFFFFF);
+            entry.textureHandle[1] = static_cast<uint32_t>(handle >> 32);
+        }
+    }
+
+    // The shader declares an array of maxMaterials entries; the unused tail of the buffer is never read.
+    glGenBuffers(1, &m_materialBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(maxMaterials * sizeof(GPUMaterialEntry)), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(m_materials.size() * sizeof(GPUMaterialEntry)), m_materials.data());
+    m_materialBufferMemory = TrackedMemory(MemoryCategory::GpuBuffer, "material buffer", maxMaterials * sizeof(GPUMaterialEntry));
+
+    // The pixels now live on the GPU.
+    m_images.clear();
+    for (TextureBucket& bucket : m_buckets)
+        bucket.layers.clear();
+    m_uploaded = true;
+}
+
+void MaterialSystem::bind(const Shader& shader) const
+{
+    assert(m_uploaded);
+    shader.bindUniformBlock("Materials", materialBufferBinding, m_materialBuffer);
+    if (m_bindless)
+        return;
+
+    std::array<GLint, maxTextureArrays> textureUnits;
+    std::iota(std::begin(textureUnits), std::end(textureUnits), 0);
+    for (size_t i = 0; i < m_buckets.size(); ++i) {
+        glActiveTexture(static_cast<GLenum>(GL_TEXTURE0 + i));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_buckets[i].texture);
+    }
+    glUniform1iv(shader.getUniformLocation("materialTextures"), static_cast<GLsizei>(textureUnits.size()), textureUnits.data());
+}
+
+size_t MaterialSystem::numMaterials() const
+{
+    return m_materials.size();
+}
+
+size_t MaterialSystem::numTextureArrays() const
+{
+    return m_buckets.size();
+}
+
+bool MaterialSystem::usesBindlessTextures() const
+{
+    return m_bindless;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/vec3.hpp>
+DISABLE_WARNINGS_POP()
+#include <cstddef>
+#include <cstdint>
+#include <framework/memory_tracker.h>
+#include <framework/mesh.h>
+#include <framework/opengl_includes.h>
+#include <framework/shader.h>
+#include <map>
+#include <tuple>
+#include <vector>
+
+// Alignment directives are to comply with std140 alignment requirements (https://www.khronos.org/opengl/wiki/Interface_Block_(GLSL)#Memory_layout)
+// Must match the MaterialEntry struct defined in shaders/material_frag.glsl
+struct GPUMaterialEntry {
+    alignas(16) glm::vec3 kd { 1.0f };
+    float shininess { 1.0f };
+    alignas(16) glm::vec3 ks { 0.0f };
+    float transparency { 1.0f };
+    int32_t textureArray { -1 }; // Index of the texture array holding the diffuse texture; -1 if untextured.
+    int32_t textureLayer { 0 };
+    uint32_t textureHandle[2] { 0, 0 }; // Bindless handle of the texture array (GL_ARB_bindless_texture only).
+
+    static const UniformBlockLayout uniformBlockLayout;
+};
+
+// Stores all materials of a scene in a single uniform buffer and all of their textures in a few texture arrays,
+// so that drawing with a different material only requires changing the material index uniform.
+//
+// Textures are bucketed by resolution and channel count; each bucket becomes one GL_TEXTURE_2D_ARRAY. When the driver
+// supports GL_ARB_bindless_texture the arrays are accessed through handles stored in the material buffer, otherwise
+// they are bound to consecutive texture units.
+class MaterialSystem {
+public:
+    MaterialSystem() = default;
+    MaterialSystem(const MaterialSystem&) = delete;
+    ~MaterialSystem();
+
+    MaterialSystem& operator=(const MaterialSystem&) = delete;
+
+    // Register a material and return the index that selects it in the shader. Must be called before upload().
+    uint32_t addMaterial(const Material& material);
+    // Create the texture arrays and the material buffer on the GPU.
+    void upload();
+
+    // Bind the texture arrays and the material buffer to the "Materials" block of the given shader.
+    void bind(const Shader& shader) const;
+
+    [[nodiscard]] size_t numMaterials() const;
+    [[nodiscard]] size_t numTextureArrays() const;
+    [[nodiscard]] bool usesBindlessTextures() const;
+
+    // Must match the defines in shaders/material_frag.glsl
+    static constexpr uint32_t maxMaterials = 256;
+    static constexpr uint32_t maxTextureArrays = 8;
+    static constexpr GLuint materialBufferBinding = 1;
+
+private:
+    // Textures with the same resolution and number of channels share a texture array.
+    using BucketKey = std::tuple<int, int, int>;
+    struct TextureBucket {
+        BucketKey key;
+        std::vector<Image*> layers;
+        GLuint texture { 0 };
+        GLuint64 bindlessHandle { 0 };
+        TrackedMemory memory {};
+    };
+
+private:
+    std::vector<GPUMaterialEntry> m_materials;
+    std::vector<TextureBucket> m_buckets;
+    std::map<const Image*, std::pair<int32_t, int32_t>> m_textureLocations; // Image => (bucket, layer)
+    std::vector<std::shared_ptr<Image>> m_images; // Keep images alive until they are uploaded.
+
+    GLuint m_materialBuffer { 0 };
+    TrackedMemory m_materialBufferMemory;
+    bool m_bindless { false };
+    bool m_uploaded { false };
+};
+
+inline const UniformBlockLayout GPUMaterialEntry::uniformBlockLayout {
+    .blockName = "Materials",
+    .size = sizeof(GPUMaterialEntry),
+    .arraySize = MaterialSystem::maxMaterials,
+    .members = {
+        { "materials[0].kd", offsetof(GPUMaterialEntry, kd), GL_FLOAT_VEC3 },
+        { "materials[0].shininess", offsetof(GPUMaterialEntry, shininess), GL_FLOAT },
+        { "materials[0].ks", offsetof(GPUMaterialEntry, ks), GL_FLOAT_VEC3 },
+        { "materials[0].transparency", offsetof(GPUMaterialEntry, transparency), GL_FLOAT },
+        { "materials[0].textureArray", offsetof(GPUMaterialEntry, textureArray), GL_INT },
+        { "materials[0].textureLayer", offsetof(GPUMaterialEntry, textureLayer), GL_INT },
+        { "materials[0].textureHandle", offsetof(GPUMaterialEntry, textureHandle), GL_UNSIGNED_INT_VEC2 } }
+};
@@ -13,7 +13,7 @@ GPUMaterial::GPUMaterial(const Material& material) :
     transparency(material.transparency)
 {}
 
-GPUMesh::GPUMesh(const Mesh& cpuMesh)
+GPUMesh::GPUMesh(const Mesh& cpuMesh, std::string name)
 {
     // Create uniform buffer to store mesh material (https://learnopengl.com/Advanced-OpenGL/Advanced-GLSL)
     GPUMaterial gpuMaterial(cpuMesh.material);
@@ -24,6 +24,10 @@ GPUMesh::GPUMesh(const Mesh& cpuMesh)
     // Figure out if this mesh has texture coordinates
     m_hasTextureCoords = static_cast<bool>(cpuMesh.material.kdTexture);
 
+    // Bounding volumes for visibility culling
+    m_boundingBox = computeBoundingBox(cpuMesh);
+    m_boundingSphere = computeBoundingSphere(cpuMesh, m_boundingBox);
+
     // Create VAO and bind it so subsequent creations of VBO and IBO are bound to this VAO
     glGenVertexArrays(1, &m_vao);
     glBindVertexArray(m_vao);
@@ -53,6 +57,9 @@ GPUMesh::GPUMesh(const Mesh& cpuMesh)
 
     // Each triangle has 3 vertices.
     m_numIndices = static_cast<GLsizei>(3 * cpuMesh.triangles.size());
+
+    const size_t bufferBytes = sizeof(GPUMaterial) + cpuMesh.vertices.size() * sizeof(Vertex) + cpuMesh.triangles.size() * sizeof(glm::uvec3);
+    m_bufferMemory = TrackedMemory(MemoryCategory::GpuBuffer, std::move(name), bufferBytes);
 }
 
 GPUMesh::GPUMesh(GPUMesh&& other)
@@ -78,7 +85,8 @@ std::vector<GPUMesh> GPUMesh::loadMeshGPU(std::filesystem::path filePath, bool n
     // Generate GPU-side meshes for all sub-meshes
     std::vector<Mesh> subMeshes = loadMesh(filePath, { .normalizeVertexPositions = normalize });
     std::vector<GPUMesh> gpuMeshes;
-    for (const Mesh& mesh : subMeshes) { gpuMeshes.emplace_back(mesh); }
+    for (size_t i = 0; i < subMeshes.size(); ++i)
+        gpuMeshes.emplace_back(subMeshes[i], fmt::format("{}#{}", filePath.filename().string(), i));
     
     return gpuMeshes;
 }
@@ -88,14 +96,39 @@ bool GPUMesh::hasTextureCoords() const
     return m_hasTextureCoords;
 }
 
+const AxisAlignedBox& GPUMesh::boundingBox() const
+{
+    return m_boundingBox;
+}
+
+const BoundingSphere& GPUMesh::boundingSphere() const
+{
+    return m_boundingSphere;
+}
+
 void GPUMesh::draw(const Shader& drawingShader)
+{
+    bindMaterial(drawingShader);
+    
+    // Draw the mesh's triangles
+    bindVertexArray();
+    drawElements();
+}
+
+void GPUMesh::bindMaterial(const Shader& drawingShader) const
 {
     // Bind material data uniform (we assume that the uniform buffer objects is always called 'Material')
     // Yes, we could define the binding inside the shader itself, but that would break on OpenGL versions below 4.2
     drawingShader.bindUniformBlock("Material", 0, m_uboMaterial);
-    
-    // Draw the mesh's triangles
+}
+
+void GPUMesh::bindVertexArray() const
+{
     glBindVertexArray(m_vao);
+}
+
+void GPUMesh::drawElements() const
+{
     glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, nullptr);
 }
 
@@ -104,10 +137,13 @@ void GPUMesh::moveInto(GPUMesh&& other)
     freeGpuMemory();
     m_numIndices = other.m_numIndices;
     m_hasTextureCoords = other.m_hasTextureCoords;
+    m_boundingBox = other.m_boundingBox;
+    m_boundingSphere = other.m_boundingSphere;
     m_ibo = other.m_ibo;
     m_vbo = other.m_vbo;
     m_vao = other.m_vao;
     m_uboMaterial = other.m_uboMaterial;
+    m_bufferMemory = std::move(other.m_bufferMemory);
 
     other.m_numIndices = 0;
     other.m_hasTextureCoords = other.m_hasTextureCoords;
@@ -127,4 +163,5 @@ void GPUMesh::freeGpuMemory()
         glDeleteBuffers(1, &m_ibo);
     if (m_uboMaterial != INVALID)
         glDeleteBuffers(1, &m_uboMaterial);
+    m_bufferMemory = {};
 }
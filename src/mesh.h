@@ -1,12 +1,15 @@
 #pragma once
 
+#include "bounding_volume.h"
 #include <framework/disable_all_warnings.h>
+#include <framework/memory_tracker.h>
 #include <framework/mesh.h>
 #include <framework/shader.h>
 DISABLE_WARNINGS_PUSH()
 #include <glm/vec3.hpp>
 DISABLE_WARNINGS_POP()
 
+#include <cstddef>
 #include <exception>
 #include <filesystem>
 #include <framework/opengl_includes.h>
@@ -16,6 +19,7 @@ struct MeshLoadingException : public std::runtime_error {
 };
 
 // Alignment directives are to comply with std140 alignment requirements (https://www.khronos.org/opengl/wiki/Interface_Block_(GLSL)#Memory_layout)
+// Must match the Material block defined in shaders/material.glsl
 struct GPUMaterial {
     GPUMaterial(const Material& material);
 
@@ -23,11 +27,25 @@ struct GPUMaterial {
 	alignas(16) glm::vec3 ks{ 0.0f };
 	float shininess{ 1.0f };
 	float transparency{ 1.0f };
+
+    // Checked against the Material block of every program (registered by the application).
+    static const UniformBlockLayout uniformBlockLayout;
+};
+
+inline const UniformBlockLayout GPUMaterial::uniformBlockLayout {
+    .blockName = "Material",
+    .size = sizeof(GPUMaterial),
+    .members = {
+        { "kd", offsetof(GPUMaterial, kd), GL_FLOAT_VEC3 },
+        { "ks", offsetof(GPUMaterial, ks), GL_FLOAT_VEC3 },
+        { "shininess", offsetof(GPUMaterial, shininess), GL_FLOAT },
+        { "transparency", offsetof(GPUMaterial, transparency), GL_FLOAT } }
 };
 
 class GPUMesh {
 public:
-    GPUMesh(const Mesh& cpuMesh);
+    // The name identifies the mesh in the MemoryTracker.
+    GPUMesh(const Mesh& cpuMesh, std::string name = "unnamed mesh");
     // Cannot copy a GPU mesh because it would require reference counting of GPU resources.
     GPUMesh(const GPUMesh&) = delete;
     GPUMesh(GPUMesh&&);
@@ -43,9 +61,18 @@ public:
 
     bool hasTextureCoords() const;
 
+    // Object space bounds of the vertices, computed when the mesh is loaded.
+    const AxisAlignedBox& boundingBox() const;
+    const BoundingSphere& boundingSphere() const;
+
     // Bind VAO and call glDrawElements.
     void draw(const Shader& drawingShader);
 
+    // The separate steps of draw() so that a render backend can skip redundant binds between draws.
+    void bindMaterial(const Shader& drawingShader) const;
+    void bindVertexArray() const;
+    void drawElements() const; // Assumes bindVertexArray() was called.
+
 private:
     void moveInto(GPUMesh&&);
     void freeGpuMemory();
@@ -55,8 +82,11 @@ private:
 
     GLsizei m_numIndices { 0 };
     bool m_hasTextureCoords { false };
+    AxisAlignedBox m_boundingBox;
+    BoundingSphere m_boundingSphere;
     GLuint m_ibo { INVALID };
     GLuint m_vbo { INVALID };
     GLuint m_vao { INVALID };
     GLuint m_uboMaterial { INVALID };
+    TrackedMemory m_bufferMemory; // Vertex, index and material buffers
 };
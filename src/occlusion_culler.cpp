@@ -0,0 +1,338 @@
+#include "occlusion_culler.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <framework/frame_allocator.h>
+#include <framework/jobs.h>
+#include <framework/profiler.h>
+#include <limits>
+#include <tuple>
+#include <memory_resource>
+#include <unordered_map>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE 1
+#endif
+
+// Vertices closer than this (in clip space w) are considered to intersect the near plane.
+static constexpr float nearEpsilon = 1e-5f;
+// Each rasterization job handles at least this many rows of the depth buffer.
+static constexpr int minRowsPerJob = 8;
+
+OcclusionCuller::OcclusionCuller(const glm::ivec2& resolution)
+    : m_resolution(resolution)
+{
+    assert(resolution.x > 0 && resolution.y > 0);
+
+    // Allocate the depth pyramid; each level has half the resolution (rounded up) of the previous one.
+    glm::ivec2 levelResolution = resolution;
+    while (true) {
+        m_mipResolutions.push_back(levelResolution);
+        m_depthPyramid.emplace_back(static_cast<size_t>(levelResolution.x * levelResolution.y), 1.0f);
+        if (levelResolution == glm::ivec2(1))
+            break;
+        levelResolution = glm::max((levelResolution + 1) / 2, glm::ivec2(1));
+    }
+}
+
+size_t OcclusionCuller::addOccluder(const Mesh& mesh, const glm::mat4& modelMatrix)
+{
+    Occluder& occluder = m_occluders.emplace_back();
+    occluder.positions.reserve(mesh.vertices.size());
+    for (const Vertex& vertex : mesh.vertices)
+        occluder.positions.push_back(vertex.position);
+    occluder.triangles.assign(std::begin(mesh.triangles), std::end(mesh.triangles));
+    occluder.modelMatrix = modelMatrix;
+    return m_occluders.size() - 1;
+}
+
+void OcclusionCuller::setOccluderTransform(size_t occluderIndex, const glm::mat4& modelMatrix)
+{
+    m_occluders[occluderIndex].modelMatrix = modelMatrix;
+}
+
+void OcclusionCuller::clearOccluders()
+{
+    m_occluders.clear();
+}
+
+void OcclusionCuller::render(const glm::mat4& viewProjectionMatrix)
+{
+    PROFILE_FUNCTION();
+    m_viewProjectionMatrix = viewProjectionMatrix;
+    setupTriangles(viewProjectionMatrix);
+
+    // Every job rasterizes all triangles but only into its own band of rows, so no synchronization is needed.
+    JobSystem& jobSystem = JobSystem::get();
+    const int rowsPerJob = std::max(minRowsPerJob, (m_resolution.y + int(jobSystem.numThreads()) - 1) / int(jobSystem.numThreads()));
+    jobSystem.parallelFor(0, size_t(m_resolution.y), size_t(rowsPerJob), [this](size_t beginRow, size_t endRow) {
+        rasterizeRows(int(beginRow), int(endRow));
+    });
+
+    buildPyramid();
+}
+
+void OcclusionCuller::setupTriangles(const glm::mat4& viewProjectionMatrix)
+{
+    m_screenTriangles.clear();
+
+    const glm::vec2 resolution { m_resolution };
+    std::pmr::vector<glm::vec4> clipPositions { FrameAllocator::resource() };
+    for (const Occluder& occluder : m_occluders) {
+        const glm::mat4 mvpMatrix = viewProjectionMatrix * occluder.modelMatrix;
+        clipPositions.resize(occluder.positions.size());
+        std::transform(std::begin(occluder.positions), std::end(occluder.positions), std::begin(clipPositions),
+            [&](const glm::vec3& position) { return mvpMatrix * glm::vec4(position, 1.0f); });
+
+        for (const glm::uvec3& triangle : occluder.triangles) {
+            const glm::vec4 clip[3] = { clipPositions[triangle.x], clipPositions[triangle.y], clipPositions[triangle.z] };
+            // Skip triangles that intersect the near plane instead of clipping them. Dropping (part of) an occluder
+            // can only make the culling less effective, never incorrect.
+            if (clip[0].w < nearEpsilon || clip[1].w < nearEpsilon || clip[2].w < nearEpsilon)
+                continue;
+            if (clip[0].z < -clip[0].w || clip[1].z < -clip[1].w || clip[2].z < -clip[2].w)
+                continue;
+
+            // Trivially reject triangles that are completely outside one of the side planes.
+            bool outside = false;
+            for (int axis = 0; axis < 2; ++axis) {
+                outside |= clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w;
+                outside |= clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w;
+            }
+            if (outside)
+                continue;
+
+            ScreenTriangle screenTriangle;
+            glm::vec3* screenVertices[3] = { &screenTriangle.v0, &screenTriangle.v1, &screenTriangle.v2 };
+            for (int i = 0; i < 3; ++i) {
+                const glm::vec3 ndc = glm::vec3(clip[i]) / clip[i].w;
+                *screenVertices[i] = glm::vec3((glm::vec2(ndc) * 0.5f + 0.5f) * resolution, ndc.z * 0.5f + 0.5f);
+            }
+
+            // Occluders are rendered double sided; make all triangles counter clockwise so the edge tests are the same.
+            const glm::vec2 e01 = glm::vec2(screenTriangle.v1 - screenTriangle.v0);
+            const glm::vec2 e02 = glm::vec2(screenTriangle.v2 - screenTriangle.v0);
+            const float area = e01.x * e02.y - e01.y * e02.x;
+            if (std::abs(area) < 1e-8f)
+                continue;
+            if (area < 0.0f)
+                std::swap(screenTriangle.v1, screenTriangle.v2);
+            m_screenTriangles.push_back(screenTriangle);
+        }
+    }
+}
+
+void OcclusionCuller::rasterizeRows(int beginRow, int endRow)
+{
+    PROFILE_FUNCTION();
+    std::vector<float>& depthBuffer = m_depthPyramid[0];
+    std::fill(std::begin(depthBuffer) + beginRow * m_resolution.x, std::begin(depthBuffer) + endRow * m_resolution.x, 1.0f);
+
+    for (const ScreenTriangle& triangle : m_screenTriangles) {
+        const glm::vec3& v0 = triangle.v0;
+        const glm::vec3& v1 = triangle.v1;
+        const glm::vec3& v2 = triangle.v2;
+
+        const int minX = std::max(int(std::floor(std::min({ v0.x, v1.x, v2.x }))), 0);
+        const int maxX = std::min(int(std::ceil(std::max({ v0.x, v1.x, v2.x }))), m_resolution.x - 1);
+        const int minY = std::max(int(std::floor(std::min({ v0.y, v1.y, v2.y }))), beginRow);
+        const int maxY = std::min(int(std::ceil(std::max({ v0.y, v1.y, v2.y }))), endRow - 1);
+        if (minX > maxX || minY > maxY)
+            continue;
+
+        // Edge functions: w0 is the (unnormalized) barycentric weight of v0 and is zero on the edge v1-v2, etc.
+        const auto edge = [](const glm::vec3& a, const glm::vec3& b, const glm::vec2& p) {
+            return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+        };
+        const float area = edge(v0, v1, v2);
+        const float invArea = 1.0f / area;
+        // Pixel centers that lie exactly on an edge shared by two triangles may be rejected by both because of
+        // rounding, which would leave holes in the farthest-depth pyramid. Allow samples up to 1/1000th of a pixel outside.
+        const float bias0 = -1e-3f * glm::length(glm::vec2(v2 - v1));
+        const float bias1 = -1e-3f * glm::length(glm::vec2(v0 - v2));
+        const float bias2 = -1e-3f * glm::length(glm::vec2(v1 - v0));
+        // Change of each edge function when stepping one pixel in x.
+        const float stepX0 = -(v2.y - v1.y), stepX1 = -(v0.y - v2.y), stepX2 = -(v1.y - v0.y);
+        // Depth is linear in screen space; express it as a function of the weights of v1 and v2.
+        const float depthStep1 = (v1.z - v0.z) * invArea;
+        const float depthStep2 = (v2.z - v0.z) * invArea;
+
+        for (int y = minY; y <= maxY; ++y) {
+            const glm::vec2 rowStart { float(minX) + 0.5f, float(y) + 0.5f };
+            const float w0Row = edge(v1, v2, rowStart);
+            const float w1Row = edge(v2, v0, rowStart);
+            const float w2Row = edge(v0, v1, rowStart);
+            float* pDepthRow = &depthBuffer[static_cast<size_t>(y * m_resolution.x)];
+
+            int x = minX;
+#ifdef OCCLUSION_CULLER_SSE
+            const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+            for (; x + 3 <= maxX; x += 4) {
+                const __m128 offset = _mm_add_ps(_mm_set1_ps(float(x - minX)), lanes);
+                const __m128 w0 = _mm_add_ps(_mm_set1_ps(w0Row), _mm_mul_ps(offset, _mm_set1_ps(stepX0)));
+                const __m128 w1 = _mm_add_ps(_mm_set1_ps(w1Row), _mm_mul_ps(offset, _mm_set1_ps(stepX1)));
+                const __m128 w2 = _mm_add_ps(_mm_set1_ps(w2Row), _mm_mul_ps(offset, _mm_set1_ps(stepX2)));
+                const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, _mm_set1_ps(bias0)), _mm_cmpge_ps(w1, _mm_set1_ps(bias1))), _mm_cmpge_ps(w2, _mm_set1_ps(bias2)));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                const __m128 depth = _mm_add_ps(_mm_set1_ps(v0.z), _mm_add_ps(_mm_mul_ps(w1, _mm_set1_ps(depthStep1)), _mm_mul_ps(w2, _mm_set1_ps(depthStep2))));
+                const __m128 oldDepth = _mm_loadu_ps(pDepthRow + x);
+                const __m128 newDepth = _mm_min_ps(oldDepth, depth);
+                _mm_storeu_ps(pDepthRow + x, _mm_or_ps(_mm_and_ps(inside, newDepth), _mm_andnot_ps(inside, oldDepth)));
+            }
+#endif
+            for (; x <= maxX; ++x) {
+                const float offset = float(x - minX);
+                const float w0 = w0Row + offset * stepX0;
+                const float w1 = w1Row + offset * stepX1;
+                const float w2 = w2Row + offset * stepX2;
+                if (w0 < bias0 || w1 < bias1 || w2 < bias2)
+                    continue;
+
+                const float depth = v0.z + w1 * depthStep1 + w2 * depthStep2;
+                pDepthRow[x] = std::min(pDepthRow[x], depth);
+            }
+        }
+    }
+}
+
+void OcclusionCuller::buildPyramid()
+{
+    // Each texel stores the farthest depth of the (up to) 2x2 texels below it, so that a single read gives
+    // a conservative bound on the occluder depth over its whole footprint.
+    for (size_t level = 1; level < m_depthPyramid.size(); ++level) {
+        const glm::ivec2 srcResolution = m_mipResolutions[level - 1];
+        const glm::ivec2 dstResolution = m_mipResolutions[level];
+        const std::vector<float>& src = m_depthPyramid[level - 1];
+        std::vector<float>& dst = m_depthPyramid[level];
+
+        for (int y = 0; y < dstResolution.y; ++y) {
+            const int y0 = 2 * y, y1 = std::min(2 * y + 1, srcResolution.y - 1);
+            for (int x = 0; x < dstResolution.x; ++x) {
+                const int x0 = 2 * x, x1 = std::min(2 * x + 1, srcResolution.x - 1);
+                dst[static_cast<size_t>(y * dstResolution.x + x)] = std::max({ src[static_cast<size_t>(y0 * srcResolution.x + x0)], src[static_cast<size_t>(y0 * srcResolution.x + x1)],
+                    src[static_cast<size_t>(y1 * srcResolution.x + x0)], src[static_cast<size_t>(y1 * srcResolution.x + x1)] });
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isOccluded(const AxisAlignedBox& worldBox) const
+{
+    // Project the corners of the box to find its screen space rectangle and its nearest depth.
+    glm::vec2 screenMin { std::numeric_limits<float>::max() };
+    glm::vec2 screenMax { std::numeric_limits<float>::lowest() };
+    float minDepth = std::numeric_limits<float>::max();
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec3 position {
+            (corner & 1) ? worldBox.upper.x : worldBox.lower.x,
+            (corner & 2) ? worldBox.upper.y : worldBox.lower.y,
+            (corner & 4) ? worldBox.upper.z : worldBox.lower.z
+        };
+        const glm::vec4 clip = m_viewProjectionMatrix * glm::vec4(position, 1.0f);
+        if (clip.w < nearEpsilon || clip.z < -clip.w)
+            return false;
+
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        const glm::vec2 screen = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(m_resolution);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= float(m_resolution.x) || screenMin.y >= float(m_resolution.y))
+        return false;
+    const glm::ivec2 pixelMin = glm::clamp(glm::ivec2(glm::floor(screenMin)), glm::ivec2(0), m_resolution - 1);
+    const glm::ivec2 pixelMax = glm::clamp(glm::ivec2(glm::floor(screenMax)), glm::ivec2(0), m_resolution - 1);
+
+    // Pick the finest mip level at which the rectangle covers at most 4x4 texels. Coarser levels need fewer reads
+    // but their texels extend further beyond the edges of the occluders, which makes the test less effective.
+    size_t level = 0;
+    while (level + 1 < m_depthPyramid.size() && ((pixelMax.x >> level) - (pixelMin.x >> level) > 3 || (pixelMax.y >> level) - (pixelMin.y >> level) > 3))
+        ++level;
+
+    const std::vector<float>& depthLevel = m_depthPyramid[level];
+    const int levelWidth = m_mipResolutions[level].x;
+    for (int y = pixelMin.y >> level; y <= (pixelMax.y >> level); ++y) {
+        for (int x = pixelMin.x >> level; x <= (pixelMax.x >> level); ++x) {
+            if (minDepth <= depthLevel[static_cast<size_t>(y * levelWidth + x)])
+                return false;
+        }
+    }
+    return true;
+}
+
+glm::ivec2 OcclusionCuller::resolution() const
+{
+    return m_resolution;
+}
+
+size_t OcclusionCuller::numMipLevels() const
+{
+    return m_depthPyramid.size();
+}
+
+const std::vector<float>& OcclusionCuller::depthMipLevel(size_t level) const
+{
+    return m_depthPyramid[level];
+}
+
+glm::ivec2 OcclusionCuller::mipLevelResolution(size_t level) const
+{
+    return m_mipResolutions[level];
+}
+
+Mesh simplifyOccluder(const Mesh& mesh, int gridResolution)
+{
+    assert(gridResolution > 0);
+    const AxisAlignedBox box = computeBoundingBox(mesh);
+    // Flat meshes (e.g. walls) have a zero extent along one axis; all their vertices fall into the first layer of cells.
+    const glm::vec3 cellsPerUnit = float(gridResolution) / glm::max(box.upper - box.lower, glm::vec3(1e-6f));
+
+    struct Cluster {
+        glm::vec3 positionSum { 0.0f };
+        uint32_t numVertices { 0 };
+        uint32_t index { 0 };
+    };
+    std::unordered_map<uint64_t, Cluster> clusters;
+    std::vector<uint32_t> clusterIndices;
+    clusterIndices.reserve(mesh.vertices.size());
+    for (const Vertex& vertex : mesh.vertices) {
+        const glm::uvec3 cell { glm::clamp(glm::ivec3((vertex.position - box.lower) * cellsPerUnit), glm::ivec3(0), glm::ivec3(gridResolution - 1)) };
+        const uint64_t key = (uint64_t(cell.z) * uint64_t(gridResolution) + cell.y) * uint64_t(gridResolution) + cell.x;
+        const auto [iter, inserted] = clusters.try_emplace(key, Cluster { .index = static_cast<uint32_t>(clusters.size()) });
+        iter->second.positionSum += vertex.position;
+        ++iter->second.numVertices;
+        clusterIndices.push_back(iter->second.index);
+    }
+
+    Mesh simplified;
+    simplified.vertices.resize(clusters.size());
+    for (const auto& [key, cluster] : clusters)
+        simplified.vertices[cluster.index].position = cluster.positionSum / float(cluster.numVertices);
+
+    // Triangles whose vertices merged into fewer than three clusters have no area. Occluders are rendered double
+    // sided, so triangles with the same clusters in any order are duplicates.
+    std::vector<glm::uvec3> triangles;
+    triangles.reserve(mesh.triangles.size());
+    for (const glm::uvec3& triangle : mesh.triangles) {
+        glm::uvec3 remapped { clusterIndices[triangle.x], clusterIndices[triangle.y], clusterIndices[triangle.z] };
+        if (remapped.x == remapped.y || remapped.y == remapped.z || remapped.z == remapped.x)
+            continue;
+        std::sort(&remapped.x, &remapped.x + 3);
+        triangles.push_back(remapped);
+    }
+    const auto lexicographicLess = [](const glm::uvec3& lhs, const glm::uvec3& rhs) {
+        return std::tie(lhs.x, lhs.y, lhs.z) < std::tie(rhs.x, rhs.y, rhs.z);
+    };
+    std::sort(std::begin(triangles), std::end(triangles), lexicographicLess);
+    triangles.erase(std::unique(std::begin(triangles), std::end(triangles)), std::end(triangles));
+    simplified.triangles.assign(std::begin(triangles), std::end(triangles));
+    return simplified;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "bounding_volume.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+DISABLE_WARNINGS_POP()
+#include <framework/mesh.h>
+#include <vector>
+
+// Software occlusion culling with a hierarchical depth buffer.
+//
+// A small set of occluders (ideally simplified meshes that lie inside the geometry they represent, see
+// simplifyOccluder()) is rasterized into a low resolution depth buffer on the CPU. A mip pyramid storing the farthest depth of each texel is then
+// built on top of it so that the bounding box of an object can be tested with only a handful of texel reads.
+// The culler does not depend on OpenGL.
+class OcclusionCuller {
+public:
+    OcclusionCuller(const glm::ivec2& resolution = glm::ivec2(256, 128));
+
+    // Occluder geometry is stored in object space; returns an index to update its transform with.
+    size_t addOccluder(const Mesh& mesh, const glm::mat4& modelMatrix = glm::mat4(1.0f));
+    void setOccluderTransform(size_t occluderIndex, const glm::mat4& modelMatrix);
+    void clearOccluders();
+
+    // Rasterize all occluders from the given viewpoint and build the depth pyramid.
+    void render(const glm::mat4& viewProjectionMatrix);
+
+    // Returns true when the box is certainly hidden behind the occluders rendered by the last call to render().
+    // Boxes that intersect the near plane or lie outside of the screen are never reported as occluded.
+    [[nodiscard]] bool isOccluded(const AxisAlignedBox& worldBox) const;
+
+    [[nodiscard]] glm::ivec2 resolution() const;
+    [[nodiscard]] size_t numMipLevels() const;
+    // Normalized depth ([0, 1], 1 = far plane) of the given mip level; level 0 is the rasterized depth buffer.
+    [[nodiscard]] const std::vector<float>& depthMipLevel(size_t level) const;
+    [[nodiscard]] glm::ivec2 mipLevelResolution(size_t level) const;
+
+private:
+    struct Occluder {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::uvec3> triangles;
+        glm::mat4 modelMatrix;
+    };
+
+    // Triangle in screen space ready for rasterization: x/y in pixels and z as normalized depth.
+    struct ScreenTriangle {
+        glm::vec3 v0, v1, v2;
+    };
+
+    void setupTriangles(const glm::mat4& viewProjectionMatrix);
+    void rasterizeRows(int beginRow, int endRow);
+    void buildPyramid();
+
+private:
+    glm::ivec2 m_resolution;
+    std::vector<Occluder> m_occluders;
+    std::vector<ScreenTriangle> m_screenTriangles;
+
+    glm::mat4 m_viewProjectionMatrix { 1.0f };
+    std::vector<std::vector<float>> m_depthPyramid;
+    std::vector<glm::ivec2> m_mipResolutions;
+};
+
+// Simplify a mesh for use as an occluder by vertex clustering: its bounding box is divided into a grid of
+// gridResolution^3 cells, all vertices in a cell are merged into their average and triangles that collapse are dropped.
+// Only the positions of the result are set. The merged vertices are averages of surface points, so the proxy of a convex
+// mesh lies inside of it; other meshes may be overestimated by up to the size of a cell.
+[[nodiscard]] Mesh simplifyOccluder(const Mesh& mesh, int gridResolution);
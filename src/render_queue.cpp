@@ -0,0 +1,245 @@
+#include "render_queue.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/gtc/matrix_inverse.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <framework/frame_allocator.h>
+#include <framework/profiler.h>
+#include <memory_resource>
+
+static constexpr uint32_t shaderBits = 10;
+static constexpr uint32_t materialBits = 14;
+static constexpr uint32_t textureBits = 12;
+static constexpr uint32_t depthBits = 24;
+static constexpr uint32_t stateBits = shaderBits + materialBits + textureBits;
+
+static constexpr uint64_t bitMask(uint32_t numBits)
+{
+    return (uint64_t(1) << numBits) - 1;
+}
+
+uint64_t RenderQueue::makeSortKey(RenderPass pass, uint32_t shaderId, uint32_t materialId, uint32_t textureId, float depth)
+{
+    // Ids that do not fit into their field wrap around; this only affects the quality of the sort, not correctness.
+    const uint64_t state = ((uint64_t(shaderId) & bitMask(shaderBits)) << (materialBits + textureBits))
+        | ((uint64_t(materialId) & bitMask(materialBits)) << textureBits)
+        | (uint64_t(textureId) & bitMask(textureBits));
+    const uint64_t quantizedDepth = uint64_t(std::clamp(depth, 0.0f, 1.0f) * float(bitMask(depthBits))) & bitMask(depthBits);
+
+    const uint64_t passKey = uint64_t(pass) << (stateBits + depthBits);
+    if (pass == RenderPass::Transparent) {
+        // Back-to-front: depth takes priority over state changes to get correct blending.
+        return passKey | ((bitMask(depthBits) - quantizedDepth) << stateBits) | state;
+    } else {
+        return passKey | (state << depthBits) | quantizedDepth;
+    }
+}
+
+uint32_t RenderQueue::ResourceIds::get(const void* pResource)
+{
+    // Consecutive pushes usually share the same resources; skip the hash map lookup in that case.
+    if (pResource == pLastResource)
+        return lastId;
+
+    auto iter = ids.find(pResource);
+    if (iter == std::end(ids))
+        iter = ids.emplace(pResource, static_cast<uint32_t>(ids.size())).first;
+
+    pLastResource = pResource;
+    lastId = iter->second;
+    return lastId;
+}
+
+void RenderQueue::push(RenderPass pass, const DrawItem& item, float depth)
+{
+    const uint32_t shaderId = m_shaderIds.get(item.pShader);
+    // Draws that use the material system are grouped by material index so the index uniform changes less often.
+    const uint32_t materialId = item.materialIndex != DrawItem::noMaterialIndex ? item.materialIndex : m_materialIds.get(item.pMesh);
+    const uint32_t textureId = m_textureIds.get(item.pTexture);
+
+    m_keys.push_back({ makeSortKey(pass, shaderId, materialId, textureId, depth), static_cast<uint32_t>(m_items.size()) });
+    m_items.push_back(item);
+}
+
+void RenderQueue::clear()
+{
+    m_items.clear();
+    m_keys.clear();
+}
+
+void RenderQueue::sort()
+{
+    PROFILE_FUNCTION();
+    const auto start = std::chrono::steady_clock::now();
+
+    // LSD radix sort with 8 passes of 8 bits. The histograms of all digits are computed in a single sweep.
+    constexpr size_t numDigits = sizeof(uint64_t);
+    std::array<std::array<uint32_t, 256>, numDigits> histograms {};
+    for (const KeyIndex& keyIndex : m_keys) {
+        for (size_t digit = 0; digit < numDigits; ++digit)
+            ++histograms[digit][(keyIndex.key >> (8 * digit)) & 0xFF];
+    }
+
+    m_sortScratch.resize(m_keys.size());
+    for (size_t digit = 0; digit < numDigits; ++digit) {
+        auto& histogram = histograms[digit];
+        // Skip digits that are equal for all keys (e.g. the pass bits or unused ids); they do not change the order.
+        if (std::any_of(std::begin(histogram), std::end(histogram), [&](uint32_t count) { return count == m_keys.size(); }))
+            continue;
+
+        // Exclusive prefix sum gives the output offset of each bucket.
+        uint32_t offset = 0;
+        for (uint32_t& count : histogram) {
+            const uint32_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+
+        for (const KeyIndex& keyIndex : m_keys)
+            m_sortScratch[histogram[(keyIndex.key >> (8 * digit)) & 0xFF]++] = keyIndex;
+        std::swap(m_keys, m_sortScratch);
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    m_lastSortTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+size_t RenderQueue::size() const
+{
+    return m_items.size();
+}
+
+const DrawItem& RenderQueue::sortedItem(size_t i) const
+{
+    return m_items[m_keys[i].index];
+}
+
+uint64_t RenderQueue::sortedKey(size_t i) const
+{
+    return m_keys[i].key;
+}
+
+float RenderQueue::lastSortTimeMs() const
+{
+    return m_lastSortTimeMs;
+}
+
+uint32_t RenderStats::stateChangesAvoided() const
+{
+    return 4 * numDraws - (shaderBinds + materialBinds + textureBinds + vaoBinds);
+}
+
+RenderBackend::RenderBackend()
+    : m_drawData(GL_UNIFORM_BUFFER, 1024 * 256)
+{
+    // Every draw binds its own range of the buffer, so each entry must start at a valid uniform buffer offset.
+    GLint offsetAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    m_drawDataStride = (static_cast<GLsizeiptr>(sizeof(GPUDrawData)) + offsetAlignment - 1) / offsetAlignment * offsetAlignment;
+}
+
+void RenderBackend::submit(const RenderQueue& queue, const glm::mat4& viewProjectionMatrix)
+{
+    PROFILE_FUNCTION();
+    m_stats = {};
+
+    // Write the transforms of all draws in submission order; on the fallback path this is a single upload.
+    m_drawData.beginFrame(static_cast<GLsizeiptr>(queue.size()) * m_drawDataStride);
+    std::pmr::vector<GLintptr> drawDataOffsets(queue.size(), FrameAllocator::resource());
+    for (size_t i = 0; i < queue.size(); ++i) {
+        const DrawItem& item = queue.sortedItem(i);
+        const StreamBuffer::Allocation allocation = m_drawData.allocate(static_cast<GLsizeiptr>(sizeof(GPUDrawData)), m_drawDataStride);
+        GPUDrawData* pDrawData = reinterpret_cast<GPUDrawData*>(allocation.pData);
+        pDrawData->mvpMatrix = viewProjectionMatrix * item.modelMatrix;
+        pDrawData->modelMatrix = item.modelMatrix;
+        // Normals should be transformed differently than positions (ignoring translations + dealing with scaling):
+        // https://paroj.github.io/gltut/Illumination/Tut09%20Normal%20Transformation.html
+        pDrawData->normalModelMatrix = glm::mat3x4(glm::inverseTranspose(glm::mat3(item.modelMatrix)));
+        drawDataOffsets[i] = allocation.offset;
+    }
+    m_drawData.flush();
+
+    // Other code (e.g. ImGui) may have changed the GL state since the last submit, so start without any cached state.
+    const Shader* pCurrentShader = nullptr;
+    const GPUMesh* pCurrentMaterial = nullptr;
+    uint32_t currentMaterialIndex = DrawItem::noMaterialIndex;
+    const GPUMesh* pCurrentVao = nullptr;
+    const Texture* pCurrentTexture = nullptr;
+    bool textureBound = false;
+    bool shaderUsesMaterial = false;
+    UniformLocations uniforms;
+
+    for (size_t i = 0; i < queue.size(); ++i) {
+        const DrawItem& item = queue.sortedItem(i);
+        assert(item.pShader && item.pMesh);
+        // All draws with the same shader either use the material system or the per-mesh materials.
+        const bool useMaterialSystem = item.materialIndex != DrawItem::noMaterialIndex;
+        assert(!useMaterialSystem || m_pMaterialSystem);
+
+        if (item.pShader != pCurrentShader) {
+            item.pShader->bind();
+            uniforms = {};
+            item.pShader->bindUniformBlock("DrawData", drawDataBinding, m_drawData.buffer());
+            if (useMaterialSystem) {
+                uniforms.materialIndex = item.pShader->getUniformLocation("materialIndex");
+                // Binds the material buffer and all texture arrays at once; they stay bound for the whole batch.
+                m_pMaterialSystem->bind(*item.pShader);
+                // The material system uses the texture units that the per-mesh textures are bound to.
+                textureBound = false;
+            } else {
+                // Shader variants that do not read the material have no Material block (e.g. textured variants).
+                shaderUsesMaterial = item.pShader->hasUniformBlock("Material");
+            }
+            pCurrentShader = item.pShader;
+            // Uniform block bindings and uniform values are per program.
+            pCurrentMaterial = nullptr;
+            currentMaterialIndex = DrawItem::noMaterialIndex;
+            ++m_stats.shaderBinds;
+        }
+        if (useMaterialSystem) {
+            if (item.materialIndex != currentMaterialIndex) {
+                glUniform1i(uniforms.materialIndex, static_cast<GLint>(item.materialIndex));
+                currentMaterialIndex = item.materialIndex;
+                ++m_stats.materialBinds;
+            }
+        } else {
+            if (shaderUsesMaterial && item.pMesh != pCurrentMaterial) {
+                item.pMesh->bindMaterial(*item.pShader);
+                pCurrentMaterial = item.pMesh;
+                ++m_stats.materialBinds;
+            }
+            if (item.pTexture && (!textureBound || item.pTexture != pCurrentTexture)) {
+                // Texture bindings are context state and survive shader switches. Samplers default to unit 0.
+                item.pTexture->bind(GL_TEXTURE0);
+                pCurrentTexture = item.pTexture;
+                textureBound = true;
+                ++m_stats.textureBinds;
+            }
+        }
+        if (item.pMesh != pCurrentVao) {
+            item.pMesh->bindVertexArray();
+            pCurrentVao = item.pMesh;
+            ++m_stats.vaoBinds;
+        }
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, drawDataBinding, m_drawData.buffer(), drawDataOffsets[i], static_cast<GLsizeiptr>(sizeof(GPUDrawData)));
+
+        item.pMesh->drawElements();
+        ++m_stats.numDraws;
+    }
+    m_drawData.endFrame();
+}
+
+void RenderBackend::setMaterialSystem(const MaterialSystem* pMaterialSystem)
+{
+    m_pMaterialSystem = pMaterialSystem;
+}
+
+const RenderStats& RenderBackend::stats() const
+{
+    return m_stats;
+}
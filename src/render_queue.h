@@ -0,0 +1,147 @@
+#pragma once
+#include "material_system.h"
+#include "mesh.h"
+#include "stream_buffer.h"
+#include "texture.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/mat3x4.hpp>
+#include <glm/mat4x4.hpp>
+DISABLE_WARNINGS_POP()
+#include <cstddef>
+#include <cstdint>
+#include <framework/shader.h>
+#include <unordered_map>
+#include <vector>
+
+// Passes are the most significant part of the sort key, so all draws of a pass are submitted before the next pass.
+enum class RenderPass : uint8_t {
+    Shadow = 0,
+    Opaque = 1,
+    Transparent = 2
+};
+
+// A single draw call as recorded into the render queue.
+// The sort key is generated by RenderQueue::push() from the pass, the GPU resources and the depth.
+struct DrawItem {
+    static constexpr uint32_t noMaterialIndex = 0xFFFFFFFF;
+
+    const Shader* pShader { nullptr };
+    const GPUMesh* pMesh { nullptr }; // Provides the VAO and (without material index) the material uniform buffer.
+    const Texture* pTexture { nullptr }; // nullptr when the mesh is not textured.
+    glm::mat4 modelMatrix { 1.0f };
+    // Index into the MaterialSystem of the backend; when set, the mesh material and pTexture are ignored.
+    uint32_t materialIndex { noMaterialIndex };
+};
+
+// Collects draw items for one frame and sorts them by a 64-bit key to minimize state changes.
+//
+// Key layout (most significant bit first):
+//  opaque/shadow: | pass (4) | shader (10) | material (14) | texture (12) | depth (24) |
+//  transparent:   | pass (4) | inverted depth (24) | shader (10) | material (14) | texture (12) |
+// Opaque draws are grouped by state and then sorted front-to-back; transparent draws are sorted back-to-front.
+class RenderQueue {
+public:
+    // Depth is the normalized view distance ([0, 1], 0 = at the camera); values outside are clamped.
+    void push(RenderPass pass, const DrawItem& item, float depth);
+    // Remove all items; keeps the allocated memory and the resource ids for the next frame.
+    void clear();
+
+    // Radix sort the items by their sort key.
+    void sort();
+
+    [[nodiscard]] size_t size() const;
+    // Items in submission order; only valid after sort().
+    [[nodiscard]] const DrawItem& sortedItem(size_t i) const;
+    [[nodiscard]] uint64_t sortedKey(size_t i) const;
+
+    // Wall clock time spent in the last call to sort().
+    [[nodiscard]] float lastSortTimeMs() const;
+
+    static uint64_t makeSortKey(RenderPass pass, uint32_t shaderId, uint32_t materialId, uint32_t textureId, float depth);
+
+private:
+    // Maps a resource to a small dense integer so that it fits into its sort key field.
+    struct ResourceIds {
+        uint32_t get(const void* pResource);
+
+        std::unordered_map<const void*, uint32_t> ids;
+        const void* pLastResource { nullptr };
+        uint32_t lastId { 0 };
+    };
+
+    struct KeyIndex {
+        uint64_t key;
+        uint32_t index;
+    };
+
+private:
+    std::vector<DrawItem> m_items;
+    std::vector<KeyIndex> m_keys;
+    std::vector<KeyIndex> m_sortScratch;
+
+    ResourceIds m_shaderIds;
+    ResourceIds m_materialIds;
+    ResourceIds m_textureIds;
+
+    float m_lastSortTimeMs { 0.0f };
+};
+
+// Per-draw transforms, streamed to the GPU every frame.
+// Must match the DrawData block defined in shaders/shader_vert.glsl
+struct GPUDrawData {
+    glm::mat4 mvpMatrix;
+    glm::mat4 modelMatrix;
+    glm::mat3x4 normalModelMatrix; // std140 stores every column of a mat3 as a vec4.
+
+    static const UniformBlockLayout uniformBlockLayout;
+};
+
+inline const UniformBlockLayout GPUDrawData::uniformBlockLayout {
+    .blockName = "DrawData",
+    .size = sizeof(GPUDrawData),
+    .members = {
+        { "mvpMatrix", offsetof(GPUDrawData, mvpMatrix), GL_FLOAT_MAT4 },
+        { "modelMatrix", offsetof(GPUDrawData, modelMatrix), GL_FLOAT_MAT4 },
+        { "normalModelMatrix", offsetof(GPUDrawData, normalModelMatrix), GL_FLOAT_MAT3 } }
+};
+
+// Number of state changes issued by the backend versus the number that a naive loop would have issued.
+struct RenderStats {
+    uint32_t numDraws { 0 };
+    uint32_t shaderBinds { 0 };
+    uint32_t materialBinds { 0 };
+    uint32_t textureBinds { 0 };
+    uint32_t vaoBinds { 0 };
+
+    // A naive loop binds the shader, material, texture and VAO for every draw.
+    [[nodiscard]] uint32_t stateChangesAvoided() const;
+};
+
+// Submits a sorted render queue while skipping redundant glUseProgram, texture, material and VAO binds.
+class RenderBackend {
+public:
+    RenderBackend();
+
+    // Material system used by draw items that have a material index.
+    void setMaterialSystem(const MaterialSystem* pMaterialSystem);
+
+    void submit(const RenderQueue& queue, const glm::mat4& viewProjectionMatrix);
+
+    [[nodiscard]] const RenderStats& stats() const;
+
+private:
+    // Uniform locations are looked up once per shader switch instead of once per draw.
+    struct UniformLocations {
+        GLint materialIndex { -1 };
+    };
+
+    static constexpr GLuint drawDataBinding = 2;
+
+private:
+    const MaterialSystem* m_pMaterialSystem { nullptr };
+    // Draw data of all items is written up front and bound per draw with glBindBufferRange.
+    StreamBuffer m_drawData;
+    GLsizeiptr m_drawDataStride;
+    RenderStats m_stats;
+};
@@ -0,0 +1,85 @@
+#include "render_target.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+DISABLE_WARNINGS_POP()
+#include <stdexcept>
+
+RenderTarget::RenderTarget(const glm::ivec2& size)
+    : m_size(size)
+{
+    glGenFramebuffers(1, &m_framebuffer);
+    createAttachments();
+}
+
+RenderTarget::~RenderTarget()
+{
+    destroyAttachments();
+    glDeleteFramebuffers(1, &m_framebuffer);
+}
+
+void RenderTarget::resize(const glm::ivec2& size)
+{
+    if (size == m_size)
+        return;
+
+    m_size = size;
+    destroyAttachments();
+    createAttachments();
+}
+
+void RenderTarget::createAttachments()
+{
+    // The color attachment is a texture so that later passes (e.g. upscaling) can sample from it.
+    glGenTextures(1, &m_colorTexture);
+    glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_size.x, m_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenRenderbuffers(1, &m_depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_size.x, m_size.y);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+    // RGBA8 color and 24-bit depth (stored as 32 bits by most drivers).
+    m_memory = TrackedMemory(MemoryCategory::GpuTexture, "render target", size_t(m_size.x) * size_t(m_size.y) * (4 + 4));
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+        throw std::runtime_error(fmt::format("Render target of {}x{} is incomplete (status 0x{:X})", m_size.x, m_size.y, status));
+}
+
+void RenderTarget::destroyAttachments()
+{
+    glDeleteTextures(1, &m_colorTexture);
+    glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+    m_colorTexture = 0;
+    m_depthRenderbuffer = 0;
+    m_memory = {};
+}
+
+void RenderTarget::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_size.x, m_size.y);
+}
+
+glm::ivec2 RenderTarget::size() const
+{
+    return m_size;
+}
+
+GLuint RenderTarget::framebuffer() const
+{
+    return m_framebuffer;
+}
+
+GLuint RenderTarget::colorTexture() const
+{
+    return m_colorTexture;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <glm/vec2.hpp>
+DISABLE_WARNINGS_POP()
+#include <framework/memory_tracker.h>
+#include <framework/opengl_includes.h>
+
+// Offscreen framebuffer with an RGBA8 color and a 24-bit depth attachment.
+class RenderTarget {
+public:
+    explicit RenderTarget(const glm::ivec2& size);
+    RenderTarget(const RenderTarget&) = delete;
+    ~RenderTarget();
+
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    // Reallocate the attachments; does nothing if the size did not change.
+    void resize(const glm::ivec2& size);
+
+    // Bind as draw and read framebuffer and set the viewport to cover it.
+    void bind() const;
+
+    [[nodiscard]] glm::ivec2 size() const;
+    [[nodiscard]] GLuint framebuffer() const;
+    [[nodiscard]] GLuint colorTexture() const;
+
+private:
+    void createAttachments();
+    void destroyAttachments();
+
+private:
+    glm::ivec2 m_size;
+    GLuint m_framebuffer { 0 };
+    GLuint m_colorTexture { 0 };
+    GLuint m_depthRenderbuffer { 0 };
+    TrackedMemory m_memory;
+};
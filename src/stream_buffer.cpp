@@ -0,0 +1,136 @@
+#include "stream_buffer.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <fmt/format.h>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr frameCapacity, uint32_t numFrames)
+    : m_target(target)
+    , m_frameCapacity(frameCapacity)
+    , m_numFrames(numFrames)
+    , m_persistent(GLAD_GL_VERSION_4_4 != 0)
+{
+    assert(numFrames > 0 && numFrames <= maxFramesInFlight);
+    createBuffer();
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    destroyBuffer();
+}
+
+void StreamBuffer::createBuffer()
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(m_target, m_buffer);
+    if (m_persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr totalSize = m_frameCapacity * static_cast<GLsizeiptr>(m_numFrames);
+        glBufferStorage(m_target, totalSize, nullptr, flags);
+        m_pMapped = static_cast<std::byte*>(glMapBufferRange(m_target, 0, totalSize, flags));
+        m_memory = TrackedMemory(MemoryCategory::GpuBuffer, "stream buffers", static_cast<size_t>(totalSize));
+    } else {
+        glBufferData(m_target, m_frameCapacity, nullptr, GL_STREAM_DRAW);
+        m_staging.resize(static_cast<size_t>(m_frameCapacity));
+        m_memory = TrackedMemory(MemoryCategory::GpuBuffer, "stream buffers", static_cast<size_t>(m_frameCapacity));
+    }
+}
+
+void StreamBuffer::destroyBuffer()
+{
+    for (uint32_t region = 0; region < m_numFrames; ++region)
+        waitForRegion(region);
+
+    if (m_buffer) {
+        if (m_pMapped) {
+            glBindBuffer(m_target, m_buffer);
+            glUnmapBuffer(m_target);
+            m_pMapped = nullptr;
+        }
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        m_memory = {};
+    }
+}
+
+void StreamBuffer::waitForRegion(uint32_t region)
+{
+    GLsync& fence = m_fences[region];
+    if (!fence)
+        return;
+
+    // Flush on the first wait so that the fence is guaranteed to signal eventually.
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (glClientWaitSync(fence, waitFlags, 1'000'000) == GL_TIMEOUT_EXPIRED)
+        waitFlags = 0;
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::beginFrame(GLsizeiptr requiredCapacity)
+{
+    if (requiredCapacity > m_frameCapacity) {
+        // Grow geometrically so that a slowly increasing load does not stall every frame.
+        destroyBuffer();
+        m_frameCapacity = std::max(requiredCapacity, 2 * m_frameCapacity);
+        createBuffer();
+    }
+
+    m_offset = 0;
+    m_flushedOffset = 0;
+    if (m_persistent) {
+        m_region = (m_region + 1) % m_numFrames;
+        waitForRegion(m_region);
+    } else {
+        // Orphan the buffer: the driver hands out fresh storage while the GPU keeps reading the old one.
+        glBindBuffer(m_target, m_buffer);
+        glBufferData(m_target, m_frameCapacity, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    const GLsizeiptr alignedOffset = (m_offset + alignment - 1) / alignment * alignment;
+    if (alignedOffset + size > m_frameCapacity)
+        throw std::runtime_error(fmt::format("Stream buffer allocation of {} bytes exceeds the frame capacity of {} bytes", size, m_frameCapacity));
+    m_offset = alignedOffset + size;
+
+    if (m_persistent) {
+        const GLintptr regionStart = static_cast<GLintptr>(m_region) * m_frameCapacity;
+        return { m_pMapped + regionStart + alignedOffset, regionStart + alignedOffset, size };
+    } else {
+        return { m_staging.data() + alignedOffset, alignedOffset, size };
+    }
+}
+
+void StreamBuffer::flush()
+{
+    // Persistently mapped memory is coherent; writes are visible to commands issued after them.
+    if (m_persistent || m_flushedOffset == m_offset)
+        return;
+
+    glBindBuffer(m_target, m_buffer);
+    glBufferSubData(m_target, m_flushedOffset, m_offset - m_flushedOffset, m_staging.data() + m_flushedOffset);
+    m_flushedOffset = m_offset;
+}
+
+void StreamBuffer::endFrame()
+{
+    if (m_persistent) {
+        assert(!m_fences[m_region]);
+        m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+GLuint StreamBuffer::buffer() const
+{
+    return m_buffer;
+}
+
+bool StreamBuffer::isPersistentlyMapped() const
+{
+    return m_persistent;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <framework/memory_tracker.h>
+#include <framework/opengl_includes.h>
+#include <vector>
+
+// Ring buffer for data that is rewritten every frame (transforms, particles, skinning palettes, ...).
+//
+// On OpenGL 4.4+ the buffer is allocated with glBufferStorage and persistently mapped (coherent); it is split into
+// one region per frame in flight and a fence guards each region, so the CPU only waits when it gets more than
+// numFrames ahead of the GPU. On older contexts (e.g. macOS, OpenGL 4.1) writes go to CPU memory and are uploaded
+// with glBufferSubData after orphaning the buffer at the start of every frame.
+class StreamBuffer {
+public:
+    struct Allocation {
+        std::byte* pData; // CPU pointer to write the data to.
+        GLintptr offset; // Offset of the data in buffer().
+        GLsizeiptr size;
+    };
+
+    StreamBuffer(GLenum target, GLsizeiptr frameCapacity, uint32_t numFrames = 3);
+    StreamBuffer(const StreamBuffer&) = delete;
+    ~StreamBuffer();
+
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Start writing the next frame. Grows the buffer (stalling once) when a frame needs more than the current capacity.
+    void beginFrame(GLsizeiptr requiredCapacity = 0);
+    // Sub-allocate from the current frame; throws when the frame capacity is exceeded.
+    Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+    // Make everything allocated so far visible to the GPU. Only does work on the glBufferSubData fallback.
+    void flush();
+    // Must be called after the last draw that reads from this frame's data.
+    void endFrame();
+
+    [[nodiscard]] GLuint buffer() const;
+    [[nodiscard]] bool isPersistentlyMapped() const;
+
+    static constexpr uint32_t maxFramesInFlight = 4;
+
+private:
+    void createBuffer();
+    void destroyBuffer();
+    void waitForRegion(uint32_t region);
+
+private:
+    GLenum m_target;
+    GLsizeiptr m_frameCapacity;
+    uint32_t m_numFrames;
+    bool m_persistent;
+
+    GLuint m_buffer { 0 };
+    TrackedMemory m_memory;
+    std::byte* m_pMapped { nullptr }; // Persistent path: start of the mapped buffer.
+    std::vector<std::byte> m_staging; // Fallback path: CPU copy of the current frame.
+    std::array<GLsync, maxFramesInFlight> m_fences {};
+
+    uint32_t m_region { 0 };
+    GLsizeiptr m_offset { 0 };
+    GLsizeiptr m_flushedOffset { 0 };
+};
@@ -6,6 +6,7 @@ DISABLE_WARNINGS_POP()
 #include <framework/image.h>
 
 #include <iostream>
+#include <utility>
 
 Texture::Texture(std::filesystem::path filePath)
 {
@@ -43,10 +44,12 @@ Texture::Texture(std::filesystem::path filePath)
 
     // Generate mip-maps
     glGenerateMipmap(GL_TEXTURE_2D);
+    m_memory = TrackedMemory(MemoryCategory::GpuTexture, filePath.filename().string(), mipChainBytes(cpuTexture.width, cpuTexture.height, 1, cpuTexture.channels));
 }
 
 Texture::Texture(Texture&& other)
     : m_texture(other.m_texture)
+    , m_memory(std::move(other.m_memory))
 {
     other.m_texture = INVALID;
 }
@@ -57,7 +60,16 @@ Texture::~Texture()
         glDeleteTextures(1, &m_texture);
 }
 
-void Texture::bind(GLint textureSlot)
+Texture& Texture::operator=(Texture&& other)
+{
+    if (m_texture != INVALID)
+        glDeleteTextures(1, &m_texture);
+    m_texture = std::exchange(other.m_texture, INVALID);
+    m_memory = std::move(other.m_memory);
+    return *this;
+}
+
+void Texture::bind(GLint textureSlot) const
 {
     glActiveTexture(textureSlot);
     glBindTexture(GL_TEXTURE_2D, m_texture);
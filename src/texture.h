@@ -5,6 +5,7 @@ DISABLE_WARNINGS_PUSH()
 DISABLE_WARNINGS_POP()
 #include <exception>
 #include <filesystem>
+#include <framework/memory_tracker.h>
 #include <framework/opengl_includes.h>
 
 struct ImageLoadingException : public std::runtime_error {
@@ -19,11 +20,12 @@ public:
     ~Texture();
 
     Texture& operator=(const Texture&) = delete;
-    Texture& operator=(Texture&&) = default;
+    Texture& operator=(Texture&&);
 
-    void bind(GLint textureSlot);
+    void bind(GLint textureSlot) const;
 
 private:
     static constexpr GLuint INVALID = 0xFFFFFFFF;
     GLuint m_texture { INVALID };
+    TrackedMemory m_memory;
 };
@@ -0,0 +1,201 @@
+#include "occlusion_culler.h"
+#include <framework/disable_all_warnings.h>
+DISABLE_WARNINGS_PUSH()
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+DISABLE_WARNINGS_POP()
+#include <algorithm>
+#include <cmath>
+#include <framework/mesh.h>
+#include <vector>
+
+// Camera at z = 5 looking down -Z with a 2:1 aspect ratio like the default culler resolution.
+static const glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 2.0f, 0.1f, 100.0f);
+static const glm::mat4 viewMatrix = glm::lookAt(glm::vec3(0, 0, 5), glm::vec3(0), glm::vec3(0, 1, 0));
+static const glm::mat4 viewProjectionMatrix = projectionMatrix * viewMatrix;
+
+// Two triangles spanning [lower, upper] in the plane z = lower.z (or y = lower.y when the box is flat in y).
+static Mesh makeQuad(const glm::vec3& lower, const glm::vec3& upper)
+{
+    Mesh mesh;
+    if (lower.y == upper.y) {
+        mesh.vertices = { { .position = { lower.x, lower.y, lower.z } }, { .position = { upper.x, lower.y, lower.z } },
+            { .position = { upper.x, lower.y, upper.z } }, { .position = { lower.x, lower.y, upper.z } } };
+    } else {
+        mesh.vertices = { { .position = { lower.x, lower.y, lower.z } }, { .position = { upper.x, lower.y, lower.z } },
+            { .position = { upper.x, upper.y, lower.z } }, { .position = { lower.x, upper.y, lower.z } } };
+    }
+    mesh.triangles = { { 0, 1, 2 }, { 0, 2, 3 } };
+    return mesh;
+}
+
+// UV sphere with the given number of segments around and between the poles.
+static Mesh makeSphere(const glm::vec3& center, float radius, uint32_t numSegments, uint32_t numRings)
+{
+    Mesh mesh;
+    for (uint32_t ring = 0; ring <= numRings; ++ring) {
+        const float theta = glm::pi<float>() * float(ring) / float(numRings);
+        for (uint32_t segment = 0; segment <= numSegments; ++segment) {
+            const float phi = glm::two_pi<float>() * float(segment) / float(numSegments);
+            const glm::vec3 direction { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+            mesh.vertices.push_back({ .position = center + radius * direction });
+        }
+    }
+    for (uint32_t ring = 0; ring < numRings; ++ring) {
+        for (uint32_t segment = 0; segment < numSegments; ++segment) {
+            const uint32_t v00 = ring * (numSegments + 1) + segment, v01 = v00 + 1;
+            const uint32_t v10 = v00 + numSegments + 1, v11 = v10 + 1;
+            mesh.triangles.push_back({ v00, v10, v11 });
+            mesh.triangles.push_back({ v00, v11, v01 });
+        }
+    }
+    return mesh;
+}
+
+TEST_CASE("OcclusionCuller tests boxes against a wall", "[occlusion_culler]")
+{
+    OcclusionCuller culler;
+    culler.addOccluder(makeQuad({ -2, -2, 0 }, { 2, 2, 0 }));
+    culler.render(viewProjectionMatrix);
+
+    SECTION("Fully occluded")
+    {
+        REQUIRE(culler.isOccluded({ .lower = { -0.5f, -0.5f, -3.5f }, .upper = { 0.5f, 0.5f, -2.5f } }));
+        // Touching the silhouette from behind, but still completely covered.
+        REQUIRE(culler.isOccluded({ .lower = { -1.0f, -1.0f, -0.5f }, .upper = { 1.0f, 1.0f, -0.1f } }));
+    }
+    SECTION("In front of the occluder")
+    {
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { -0.5f, -0.5f, 1.0f }, .upper = { 0.5f, 0.5f, 2.0f } }));
+        // Behind in parts, but its nearest corner is in front.
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { -0.5f, -0.5f, -1.0f }, .upper = { 0.5f, 0.5f, 1.0f } }));
+    }
+    SECTION("Partially visible")
+    {
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { 1.5f, -0.5f, -3.5f }, .upper = { 6.0f, 0.5f, -2.5f } }));
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { -0.5f, 1.0f, -1.0f }, .upper = { 0.5f, 3.0f, -0.5f } }));
+    }
+    SECTION("Outside of the screen")
+    {
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { 100.0f, -0.5f, -3.5f }, .upper = { 101.0f, 0.5f, -2.5f } }));
+    }
+    SECTION("Crossing the near plane")
+    {
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { -0.5f, -0.5f, 4.5f }, .upper = { 0.5f, 0.5f, 5.5f } }));
+        // Behind the camera.
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { -0.5f, -0.5f, 6.0f }, .upper = { 0.5f, 0.5f, 7.0f } }));
+    }
+}
+
+TEST_CASE("OcclusionCuller skips occluders that cross the near plane", "[occlusion_culler]")
+{
+    // A floor below the camera that extends behind it; without clipping none of it can be rasterized safely.
+    OcclusionCuller culler;
+    culler.addOccluder(makeQuad({ -50, -1, -50 }, { 50, -1, 50 }));
+    culler.render(viewProjectionMatrix);
+
+    const std::vector<float>& depthBuffer = culler.depthMipLevel(0);
+    REQUIRE(std::all_of(std::begin(depthBuffer), std::end(depthBuffer), [](float depth) { return depth == 1.0f; }));
+    REQUIRE_FALSE(culler.isOccluded({ .lower = { -0.5f, -2.0f, -3.5f }, .upper = { 0.5f, -1.5f, -2.5f } }));
+}
+
+TEST_CASE("OcclusionCuller rasterizes occluder depth", "[occlusion_culler]")
+{
+    OcclusionCuller culler;
+    culler.addOccluder(makeQuad({ -2, -2, 0 }, { 2, 2, 0 }));
+    culler.render(viewProjectionMatrix);
+
+    const glm::vec4 clip = viewProjectionMatrix * glm::vec4(0, 0, 0, 1);
+    const float expectedDepth = clip.z / clip.w * 0.5f + 0.5f;
+    const glm::ivec2 resolution = culler.resolution();
+    const std::vector<float>& depthBuffer = culler.depthMipLevel(0);
+    REQUIRE(depthBuffer[static_cast<size_t>(resolution.y / 2 * resolution.x + resolution.x / 2)] == Catch::Approx(expectedDepth).margin(1e-5));
+    // The corners of the screen are not covered.
+    REQUIRE(depthBuffer.front() == 1.0f);
+    REQUIRE(depthBuffer.back() == 1.0f);
+}
+
+TEST_CASE("OcclusionCuller depth pyramid stores the farthest depth", "[occlusion_culler]")
+{
+    // Odd sizes, so that the last row and column of a level only have one texel above them.
+    OcclusionCuller culler { glm::ivec2(37, 19) };
+    culler.addOccluder(makeQuad({ -2, -2, 0 }, { 2, 2, 0 }));
+    culler.addOccluder(makeQuad({ -3, -1, -2 }, { 0, 3, -2 }));
+    culler.render(viewProjectionMatrix);
+
+    // 37x19, 19x10, 10x5, 5x3, 3x2, 2x1, 1x1
+    REQUIRE(culler.numMipLevels() == 7);
+    REQUIRE(culler.mipLevelResolution(culler.numMipLevels() - 1) == glm::ivec2(1));
+
+    for (size_t level = 1; level < culler.numMipLevels(); ++level) {
+        const glm::ivec2 srcResolution = culler.mipLevelResolution(level - 1);
+        const glm::ivec2 dstResolution = culler.mipLevelResolution(level);
+        REQUIRE(dstResolution == (srcResolution + 1) / 2);
+
+        const std::vector<float>& src = culler.depthMipLevel(level - 1);
+        const std::vector<float>& dst = culler.depthMipLevel(level);
+        for (int y = 0; y < dstResolution.y; ++y) {
+            for (int x = 0; x < dstResolution.x; ++x) {
+                float farthest = 0.0f;
+                for (int srcY = 2 * y; srcY < std::min(2 * y + 2, srcResolution.y); ++srcY) {
+                    for (int srcX = 2 * x; srcX < std::min(2 * x + 2, srcResolution.x); ++srcX)
+                        farthest = std::max(farthest, src[static_cast<size_t>(srcY * srcResolution.x + srcX)]);
+                }
+                REQUIRE(dst[static_cast<size_t>(y * dstResolution.x + x)] == farthest);
+            }
+        }
+    }
+
+    // The whole screen is not covered, so the top level is the far plane.
+    const std::vector<float>& depthBuffer = culler.depthMipLevel(0);
+    REQUIRE(culler.depthMipLevel(culler.numMipLevels() - 1)[0] == *std::max_element(std::begin(depthBuffer), std::end(depthBuffer)));
+}
+
+TEST_CASE("Simplified occluders still cull", "[occlusion_culler]")
+{
+    SECTION("Tessellated wall")
+    {
+        // 32x32 quads in the plane z = 0; the simplified wall keeps its outline.
+        Mesh wall;
+        for (uint32_t y = 0; y <= 32; ++y) {
+            for (uint32_t x = 0; x <= 32; ++x)
+                wall.vertices.push_back({ .position = { -2.0f + 0.125f * float(x), -2.0f + 0.125f * float(y), 0.0f } });
+        }
+        for (uint32_t y = 0; y < 32; ++y) {
+            for (uint32_t x = 0; x < 32; ++x) {
+                const uint32_t v00 = y * 33 + x, v01 = v00 + 1, v10 = v00 + 33, v11 = v10 + 1;
+                wall.triangles.push_back({ v00, v01, v11 });
+                wall.triangles.push_back({ v00, v11, v10 });
+            }
+        }
+        const Mesh simplified = simplifyOccluder(wall, 4);
+        REQUIRE(simplified.triangles.size() < wall.triangles.size() / 16);
+
+        OcclusionCuller culler;
+        culler.addOccluder(simplified);
+        culler.render(viewProjectionMatrix);
+        REQUIRE(culler.isOccluded({ .lower = { -0.5f, -0.5f, -3.5f }, .upper = { 0.5f, 0.5f, -2.5f } }));
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { -0.5f, -0.5f, 1.0f }, .upper = { 0.5f, 0.5f, 2.0f } }));
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { 2.5f, -0.5f, -3.5f }, .upper = { 3.5f, 0.5f, -2.5f } }));
+    }
+    SECTION("Sphere")
+    {
+        const Mesh sphere = makeSphere(glm::vec3(0.0f), 1.5f, 64, 32);
+        const Mesh simplified = simplifyOccluder(sphere, 8);
+        REQUIRE(!simplified.triangles.empty());
+        REQUIRE(simplified.triangles.size() < sphere.triangles.size() / 4);
+        // Merged vertices stay within one cell of the surface.
+        const float cellDiagonal = std::sqrt(3.0f) * 3.0f / 8.0f;
+        for (const Vertex& vertex : simplified.vertices)
+            REQUIRE(std::abs(glm::length(vertex.position) - 1.5f) <= cellDiagonal);
+
+        OcclusionCuller culler;
+        culler.addOccluder(simplified);
+        culler.render(viewProjectionMatrix);
+        REQUIRE(culler.isOccluded({ .lower = { -0.3f, -0.3f, -3.0f }, .upper = { 0.3f, 0.3f, -2.5f } }));
+        REQUIRE_FALSE(culler.isOccluded({ .lower = { 2.5f, -0.3f, -3.0f }, .upper = { 3.1f, 0.3f, -2.5f } }));
+    }
+}